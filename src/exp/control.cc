@@ -3,7 +3,7 @@
 
 
 ExpControl::ExpControl(Log& log, int e)
-  : log_(log), experiment_(e)
+  : log_(log), experiment_(e), worlds_(1)
 {
   if (!e) {
     return;
@@ -271,7 +271,7 @@ ExpControl::next4_first(Control& c)
 
   if (1 == c.tick_ && 0.0001f > c.dpe_) {
     if (41 == e || 42 == e) {
-      if (1 < ex.exp_4_count_) {
+      if (this->worlds_ < ex.exp_4_count_) { // not the first instance
         std::cout << "\n";
       }
       std::cout << ex.exp_4_count_ << ":" << std::flush;
@@ -292,10 +292,10 @@ ExpControl::next4_iterate(Control& c)
     std::cout << ";";
   }
   if (0.1001f < c.dpe_) {
-    ++ex.exp_4_count_;
+    ex.exp_4_count_ += this->worlds_;
     c.dpe_ = 0.0f;
   }
-  if (10 < ex.exp_4_count_) { // * 10 separate instances
+  if (this->replicates() < ex.exp_4_count_) { // * 10 separate instances
     c.quit();
     return false;
   }
@@ -338,7 +338,7 @@ ExpControl::next5_first(Control& c)
 
   if (54 == e || 55 == e || 56 == e) {
     if (1 == c.tick_ && 0.0001f > c.state_.noise_) {
-      if (1 < ex.exp_5_count_) {
+      if (this->worlds_ < ex.exp_5_count_) { // not the first instance
         std::cout << "\n";
       }
       std::cout << ex.exp_5_count_ << ":" << std::flush;
@@ -358,20 +358,20 @@ ExpControl::next5_iterate(Control& c)
   float noise = 0.0f;
 
   if (51 == e || 52 == e || 53 == e) {
-    ++ex.exp_5_count_;
-    if (100 < ex.exp_5_count_) { // * 10 separate instances
+    ex.exp_5_count_ += this->worlds_;
+    if (this->replicates() < ex.exp_5_count_) { // * 10 separate instances
       c.quit();
       return -1.0f;
     }
   } else if (54 == e || 55 == e || 56 == e) {
     noise = Util::rad_to_deg(s.noise_);
     if (90.0f <= Util::rad_to_deg(s.noise_)) {
-      ++ex.exp_5_count_;
+      ex.exp_5_count_ += this->worlds_;
       noise = -5.0f; // will reset noise to 0
     } else {
       std::cout << ";";
     }
-    if (100 < ex.exp_5_count_) { // * 10 separate instances
+    if (this->replicates() < ex.exp_5_count_) { // * 10 separate instances
       c.quit();
       return -1.0f;
     }
@@ -453,3 +453,18 @@ ExpControl::next6_change(Control& c)
   c.gui_change_ = true; // let UiState reflect true State
 }
 
+
+
+unsigned int
+ExpControl::replicates() const
+{
+  if (!this->experiment_) {
+    return 0;
+  }
+
+  int eg = this->experiment_group_;
+
+  if (4 == eg) { return 10; }
+  if (5 == eg) { return 100; }
+  return 0;
+}
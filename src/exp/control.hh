@@ -60,8 +60,14 @@ class ExpControl
   bool next6_iterate(Control& c);
   void next6_change(Control& c);
 
+  /// replicates(): Number of separate instances of the experiment, after
+  ///               which it ends (0 if it is not replicated).
+  /// \returns  number of instances
+  unsigned int replicates() const;
+
   int experiment_group_; // experiment being perfomed
   int experiment_;       // specific experiment being perfomed
+  unsigned int worlds_;  // instances run side by side, see Ensemble
 
  private:
   Log& log_;
@@ -1,4 +1,5 @@
 #include "exp.hh"
+#include "../proc/tally.hh"
 #include "../util/common.hh"
 #include "../util/util.hh"
 #include <algorithm>
@@ -382,75 +383,98 @@ Exp::Exp(Log& log, ExpControl& expctrl, State& state, Proc& proc, bool no_cl)
 }
 
 
+// colors of the original scheme by type, as red, green, blue and alpha
+static const float TINTS[][4] = {
+  {0.4f, 0.6f, 0.0f, 0.5f}, // (none) as nutrient
+  {0.4f, 0.2f, 0.1f, 1.0f}, // premature spore, brown
+  {0.8f, 0.2f, 0.4f, 1.0f}, // mature spore, magenta
+  {0.4f, 0.6f, 0.0f, 0.5f}, // ring as nutrient
+  {0.4f, 0.6f, 0.0f, 0.5f}, // premature cell as nutrient
+  {0.4f, 0.6f, 0.0f, 0.5f}, // triangle cell as nutrient
+  {0.4f, 0.6f, 0.0f, 0.5f}, // square cell as nutrient
+  {0.4f, 0.6f, 0.0f, 0.5f}, // pentagon cell as nutrient
+  {0.4f, 0.6f, 0.0f, 0.5f}, // nutrient, green
+  {0.2f, 0.4f, 0.8f, 1.0f}, // cell hull, blue
+  {0.8f, 0.8f, 0.0f, 1.0f}  // cell core, yellow
+};
+
+
+// defined before use, so that the passes over all particles inline it
+inline Type
+Exp::classify(unsigned int n, unsigned int an)
+{
+  // arithmetic rather than a chain of branches, which mispredict as much as
+  // neighborhoods vary: nutrient, less 7 if premature spore, plus 1 if cell
+  // hull or 2 if cell core, and mature spore over all
+  int big = 15 < n;
+  int core = 35 < n;
+  int premature = 13 <= n && !big;
+  int mature = big && 15 < an;
+  int type = static_cast<int>(Type::Nutrient) - 7 * premature
+             + big * (1 + core);
+
+  return static_cast<Type>(type + mature * (2 - type));
+}
+
+
 void
 Exp::type()
 {
   State& state = this->state_;
-  bool cl = !this->no_cl_;
   std::vector<Type>& pt = state.pt_;
   std::vector<unsigned int>& pn = state.pn_;
-  float ascope = state.ascope_squared_;
-  this->magentas_ = 0;
-  this->blues_ = 0;
-  this->yellows_ = 0;
-  this->browns_ = 0;
-  this->greens_ = 0;
-  unsigned int n;
-
-  // cl
   std::vector<unsigned int>& pan = state.pan_;
+  unsigned int counts[sizeof(TINTS) / sizeof(TINTS[0])] = {};
 
-  // non-cl
-  std::vector<float>& pld = state.pld_;
-  std::vector<float>& prd = state.prd_;
-  unsigned int n_stride = state.n_stride_;
-
+  // the alternative N is counted by either seek
   for (unsigned int p = 0; p < state.num_; ++p) {
-    n = pn[p];
-
-#if 1 == CL_ENABLED
-
-    if (cl) {
-      if (15 <  n && 15 < pan[p]) {
-        pt[p] = Type::MatureSpore;
-        ++this->magentas_;
-        continue;
-      }
-    } else {
-
-#endif
-
-      if (15 < n && 15 < plain_alt_neighborhood(pld, prd, p, n_stride, ascope))
-      {
-        pt[p] = Type::MatureSpore;
-        ++this->magentas_;
-        continue;
-      }
-
-#if 1 == CL_ENABLED
+    pt[p] = Exp::classify(pn[p], pan[p]);
+    ++counts[static_cast<int>(pt[p])];
+  }
+  this->magentas_ = counts[static_cast<int>(Type::MatureSpore)];
+  this->blues_ = counts[static_cast<int>(Type::CellHull)];
+  this->yellows_ = counts[static_cast<int>(Type::CellCore)];
+  this->browns_ = counts[static_cast<int>(Type::PrematureSpore)];
+  this->greens_ = counts[static_cast<int>(Type::Nutrient)];
+}
 
-    }
 
-#endif
+void
+Exp::type_color()
+{
+  State& state = this->state_;
+  unsigned int num = state.num_;
+  std::vector<Type>& pt = state.pt_;
+  std::vector<unsigned int>& pn = state.pn_;
+  std::vector<unsigned int>& pl = state.pl_;
+  std::vector<unsigned int>& pr = state.pr_;
+  std::vector<unsigned int>& pan = state.pan_;
+  std::vector<float>& xr = state.xr_;
+  std::vector<float>& xg = state.xg_;
+  std::vector<float>& xb = state.xb_;
+  std::vector<float>& xa = state.xa_;
+  unsigned int counts[sizeof(TINTS) / sizeof(TINTS[0])] = {};
+  int type;
 
-    if (15 < n && n <= 35) {
-      pt[p] = Type::CellHull;
-      ++this->blues_;
-      continue;
-    }
-    if (35 < n) {
-      pt[p] = Type::CellCore;
-      ++this->yellows_;
-      continue;
-    }
-    if (13 <= n && n <= 15) {
-      pt[p] = Type::PrematureSpore;
-      ++this->browns_;
-      continue;
-    }
-    pt[p] = Type::Nutrient;
-    ++this->greens_;
+  // the counts are final here, and read for the last time until the next seek
+  for (unsigned int p = 0; p < num; ++p) {
+    pt[p] = Exp::classify(pn[p], pan[p]);
+    type = static_cast<int>(pt[p]);
+    ++counts[type];
+    xr[p] = TINTS[type][0];
+    xg[p] = TINTS[type][1];
+    xb[p] = TINTS[type][2];
+    xa[p] = TINTS[type][3];
+    pn[p] = 0;
+    pl[p] = 0;
+    pr[p] = 0;
+    pan[p] = 0;
   }
+  this->magentas_ = counts[static_cast<int>(Type::MatureSpore)];
+  this->blues_ = counts[static_cast<int>(Type::CellHull)];
+  this->yellows_ = counts[static_cast<int>(Type::CellCore)];
+  this->browns_ = counts[static_cast<int>(Type::PrematureSpore)];
+  this->greens_ = counts[static_cast<int>(Type::Nutrient)];
 }
 
 
@@ -504,46 +528,15 @@ Exp::color(Coloring scheme)
   std::vector<float>& xg = state.xg_;
   std::vector<float>& xb = state.xb_;
   std::vector<float>& xa = state.xa_;
+  int type;
 
   if (Coloring::Original == scheme) {
     for (unsigned int p = 0; p < num; ++p) {
-      if (Type::MatureSpore == pt[p]) {
-        // magenta
-        xr[p] = 0.8f;
-        xg[p] = 0.2f;
-        xb[p] = 0.4f;
-        xa[p] = 1.0f;
-        continue;
-      }
-      if (Type::CellHull == pt[p]) {
-        // blue
-        xr[p] = 0.2f;
-        xg[p] = 0.4f;
-        xb[p] = 0.8f;
-        xa[p] = 1.0f;
-        continue;
-      }
-      if (Type::CellCore == pt[p]) {
-        // yellow
-        xr[p] = 0.8f;
-        xg[p] = 0.8f;
-        xb[p] = 0.0f;
-        xa[p] = 1.0f;
-        continue;
-      }
-      if (Type::PrematureSpore == pt[p]) {
-        // brown
-        xr[p] = 0.4f;
-        xg[p] = 0.2f;
-        xb[p] = 0.1f;
-        xa[p] = 1.0f;
-        continue;
-      }
-      // green (nutrient)
-      xr[p] = 0.4f;
-      xg[p] = 0.6f;
-      xb[p] = 0.0f;
-      xa[p] = 0.5f;
+      type = static_cast<int>(pt[p]);
+      xr[p] = TINTS[type][0];
+      xg[p] = TINTS[type][1];
+      xb[p] = TINTS[type][2];
+      xa[p] = TINTS[type][3];
     }
     return;
   }
@@ -580,7 +573,8 @@ Exp::color(Coloring scheme)
       //}
       ++this->palette_index_;
       color = this->palette_sample();
-      for (int p : c) {
+      for (int id : c) {
+        int p = this->state_.pidx_[id];
         xr[p] = color[0];
         xg[p] = color[1];
         xb[p] = color[2];
@@ -597,7 +591,8 @@ Exp::color(Coloring scheme)
       xb[p] = 0.4f;
       xa[p] = 0.5f;
     }
-    for (int p : this->inspect_) {
+    for (int id : this->inspect_) {
+      int p = this->state_.pidx_[id];
       xr[p] = 1.0f;
       xg[p] = 1.0f;
       xb[p] = 1.0f;
@@ -644,6 +639,7 @@ Exp::cluster(float radius, unsigned int minpts)
   this->dbscan_categorise(radius, minpts);
   this->dbscan_collect();
   this->type_clusters();
+  this->dbscan_identify();
 }
 
 
@@ -677,19 +673,16 @@ Exp::inject(Type type, bool greater)
   }
   float w = static_cast<float>(state.width_);
   float h = static_cast<float>(state.height_);
-  unsigned int n_stride = state.n_stride_;
   unsigned int size = sprite.size();
   float dist_x = Util::distr(0.0f, w);
   float dist_y = Util::distr(0.0f, h);
   float x;
   float y;
   unsigned int si = 0;
-  unsigned int i_stride;
 
   for (int i = state.num_; i < state.num_ + size; ++i) {
     SpritePt& p = sprite[si];
     ++si;
-    i_stride = n_stride * si;
     x = std::get<0>(p) + dist_x; if (w <= x) { x -= w; }
     y = std::get<1>(p) + dist_y; if (h <= y) { y -= h; }
     state.px_.push_back(x);
@@ -701,15 +694,15 @@ Exp::inject(Type type, bool greater)
     state.pl_.push_back(0);
     state.pr_.push_back(0);
     state.pan_.push_back(0);
-    for (int j = 0; j < n_stride; ++j) { state.pls_.push_back(-1); }
-    for (int j = 0; j < n_stride; ++j) { state.prs_.push_back(-1); }
-    for (int j = 0; j < n_stride; ++j) { state.pld_.push_back(-1.0f); }
-    for (int j = 0; j < n_stride; ++j) { state.prd_.push_back(-1.0f); }
+    state.plo_.push_back(state.plo_.back());
+    state.pro_.push_back(state.pro_.back());
     state.pt_.push_back(type);
     state.xr_.push_back(1.0f);
     state.xg_.push_back(1.0f);
     state.xb_.push_back(1.0f);
     state.xa_.push_back(1.0f);
+    state.pid_.push_back(i);
+    state.pidx_.push_back(i);
     this->injected_.push_back(i);
   }
   state.num_ += size;
@@ -718,38 +711,6 @@ Exp::inject(Type type, bool greater)
 }
 
 
-unsigned int
-Exp::plain_alt_neighborhood(std::vector<float>& pld, std::vector<float>& prd,
-                            unsigned int p, unsigned int n_stride,
-                            float ascope)
-{
-  unsigned int pstride = n_stride * p;
-  unsigned int count = 0;
-  float dist;
-
-  for (int i = 0; i < n_stride; ++i) {
-    dist = pld[pstride + i];
-    if (0 > dist) {
-      break;
-    }
-    if (ascope >= dist) {
-      ++count;
-    }
-  }
-  for (int i = 0; i < n_stride; ++i) {
-    dist = prd[pstride + i];
-    if (0 > dist) {
-      break;
-    }
-    if (ascope >= dist) {
-      ++count;
-    }
-  }
-
-  return count;
-}
-
-
 std::vector<float>
 Exp::palette_sample()
 {
@@ -797,11 +758,15 @@ Exp::record_types()
 {
   State& state = this->state_;
   std::vector<Type>& pt = state.pt_;
+  std::vector<unsigned int>& pid = state.pid_;
   std::vector<std::vector<Type>>& history = this->type_history_;
+  unsigned int id;
 
+  history.resize(state.num_);
   for (int p = 0; p < state.num_; ++p) {
-    if (history[p].empty() || pt[p] != history[p].back()) {
-      history[p].push_back(pt[p]);
+    id = pid[p]; // history is kept by particle ID, which survives reorder
+    if (history[id].empty() || pt[p] != history[id].back()) {
+      history[id].push_back(pt[p]);
     }
   }
 }
@@ -813,13 +778,11 @@ Exp::dbscan_categorise(float radius, unsigned int minpts)
   std::unordered_map<int,std::vector<int>>& ns = this->proc_.neighbors_sets_;
   std::vector<int>& cores = this->cores_;
   std::vector<int>& vague = this->vague_;
-  auto grid = std::vector<int>();
   int cols;
   int rows;
-  unsigned int stride;
 
-  this->proc_.plain_seek(radius, grid, cols, rows, stride,
-                         &Proc::tally_neighbors);
+  this->proc_.plain_seek(radius, this->grid_, this->grid_start_, cols, rows,
+                         TallyNeighbors(this->proc_));
 
   auto it = ns.begin();
   while (it != ns.end()) {
@@ -887,6 +850,37 @@ Exp::type_clusters() {
 }
 
 
+void
+Exp::dbscan_identify()
+{
+  std::vector<unsigned int>& pid = this->state_.pid_;
+  std::unordered_map<int,std::vector<int>>& ns = this->proc_.neighbors_sets_;
+  std::unordered_map<int,std::vector<int>> ids;
+
+  for (int& p : this->cores_) {
+    p = pid[p];
+  }
+  for (int& p : this->vague_) {
+    p = pid[p];
+  }
+  for (std::set<int>& cluster : this->clusters_) {
+    std::set<int> members;
+    for (int p : cluster) {
+      members.insert(pid[p]);
+    }
+    cluster.swap(members);
+  }
+  // for districts()
+  for (auto& n : ns) {
+    std::vector<int>& neighbors = ids[pid[n.first]];
+    for (int q : n.second) {
+      neighbors.push_back(pid[q]);
+    }
+  }
+  ns.swap(ids);
+}
+
+
 int
 Exp::type_of_cluster(std::set<int>& cluster)
 {
@@ -943,76 +937,38 @@ Exp::dhi()
   State& state = this->state_;
   unsigned int width = state.width_;
   unsigned int height = state.height_;
-  std::vector<float>& px = state.px_;
-  std::vector<float>& py = state.py_;
   float scope = state.scope_;
   float scopesq = scope * scope;
   float dx;
   float dy;
   std::vector<std::vector<int>> pixels(width, std::vector<int>(height, 0));
-
-  auto grid = std::vector<int>();
+  std::vector<int>& grid = this->grid_;
+  std::vector<int>& gstart = this->grid_start_;
+  Halo& halo = this->halo_;
   int cols;
   int rows;
-  unsigned int gstride;
 
-  this->proc_.plot(scope, grid, cols, rows, gstride);
+  this->proc_.plot(scope, grid, gstart, cols, rows);
+  this->proc_.halo(grid, gstart, cols, rows, halo);
 
   unsigned int uw = width / cols;
   unsigned int uh = height / rows;
   unsigned int ux;
   unsigned int uy;
-  int c;
-  int cc;
-  int r;
-  int rr;
-  bool cunder;
-  bool cover;
-  bool runder;
-  bool rover;
-  unsigned int stride;
-  int p;
+  unsigned int unit;
 
   for (int col = 0; col < cols; ++col) {
-    c = col - 1;
-    cc = col + 1;
-    cunder = false;
-    cover = false;
-    if      (col == 0)        { cunder = true; c = cols - 1; }
-    else if (col == cols - 1) { cover  = true; cc = 0; }
     for (int row = 0; row < rows; ++row) {
-      r = row - 1;
-      rr = row + 1;
-      runder = false;
-      rover = false;
-      if      (row == 0)        { runder = true; r = rows - 1; }
-      else if (row == rows - 1) { rover  = true; rr = 0; }
-      int vic[54] = {/* sw */ c,   r,   cunder, false, runder, false,
-                     /* s  */ col, r,   false,  false, runder, false,
-                     /* se */ cc,  r,   false,  cover, runder, false,
-                     /* w  */ c,   row, cunder, false, false,  false,
-                     /* c  */ col, row, false,  false, false,  false,
-                     /* e  */ cc,  row, false,  cover, false,  false,
-                     /* nw */ c,   rr,  cunder, false, false,  rover,
-                     /* n  */ col, rr,  false,  false, false,  rover,
-                     /* ne */ cc,  rr,  false,  cover, false,  rover};
       for (int i = 0; i < uw; ++i) {
         for (int j = 0; j < uh; ++j) {
           ux = col * uw + j;
           uy = row * uh + i;
-          for (unsigned int v = 0; v < 54; v += 6) {
-            stride = (cols * (vic[v + 1] * gstride)) + (vic[v] * gstride);
-            for (unsigned int gi = 0; gi < gstride; ++gi) {
-              p = grid[stride + gi];
-              if (0 > p) {
-                break;
-              }
-              dx = px[p] - ux;
-              if      (vic[v + 2]) { dx -= width; }
-              else if (vic[v + 3]) { dx += width; }
-              dy = py[p] - uy;
-              if      (vic[v + 4]) { dy -= height; }
-              else if (vic[v + 5]) { dy += height; }
+          // the vicinity, see Proc::plain_seek_vicinity()
+          unit = (halo.cols * row) + col;
+          for (unsigned int r = 0; r < 3; ++r, unit += halo.cols) {
+            for (int p = halo.start[unit]; p < halo.start[unit + 3]; ++p) {
+              dx = (halo.x[p] - ux) + halo.offx[p];
+              dy = (halo.y[p] - uy) + halo.offy[p];
               if (scopesq >= (dx * dx + dy * dy)) {
                 ++pixels[uy][ux];
               }
@@ -1160,22 +1116,26 @@ Exp::do_exp_3(unsigned int tick) {
   std::vector<Type>& pt = state.pt_;
   std::vector<unsigned int>& pl = state.pl_;
   std::vector<unsigned int>& pr = state.pr_;
+  std::vector<unsigned int>& pidx = state.pidx_;
   unsigned int num = this->injected_.size();
+  unsigned int id;
   unsigned int p;
   Type type;
   char t = 'x';
 
+  this->proc_.sync(); // L and R may still be on the OpenCL device
   std::cout << tick << ":";
   for (int i = 0; i < num; ++i) {
     // TODO: something's not right
-    p = this->injected_[i];
+    id = this->injected_[i];
+    p = pidx[id];
     type = pt[p];
     if      (Type::Nutrient       == type) { t = 'g'; }
     else if (Type::PrematureSpore == type) { t = 'w'; }
     else if (Type::MatureSpore    == type) { t = 'm'; }
     else if (Type::CellHull       == type) { t = 'b'; }
     else if (Type::CellCore       == type) { t = 'y'; }
-    std::cout << " " << p << " " << t << " " << pl[p] << " " << pr[p];
+    std::cout << " " << id << " " << t << " " << pl[p] << " " << pr[p];
     if (num - 1 > i) {
       std::cout << ",";
     }
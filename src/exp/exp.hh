@@ -11,6 +11,7 @@
 #pragma once
 
 #include "control.hh"
+#include "../proc/halo.hh"
 #include "../proc/proc.hh"
 #include "../state/state.hh"
 #include <set>
@@ -64,6 +65,12 @@ class Exp
   /// type(): Assign type to particle.
   void type();
 
+  /// type_color(): Assign type to particle, color it as color() does for
+  ///               Coloring::Original and clear its counts as Proc::clear()
+  ///               does, all in one pass over the particles instead of three.
+  ///               Used by the fused pipeline, see Control::next().
+  void type_color();
+
   /// reset_exp(): Clear out all experimentation data structures.
   void reset_exp();
 
@@ -81,10 +88,12 @@ class Exp
   void color(Coloring scheme);
 
   /// highlight(): Color specified particles brightly.
-  /// \param particles  list of particle indices to highlight.
+  /// \param particles  list of particle IDs (see State::pid_) to highlight.
   void highlight(std::vector<unsigned int>& particles);
 
-  /// cluster(): Detect particle clusters.
+  /// cluster(): Detect particle clusters. The particles of cores_, vague_,
+  ///            clusters_ and districts_ are kept by ID (see State::pid_),
+  ///            so that they survive Proc::reorder().
   /// \param radius  DBSCAN neighborhood radius ("epsilon" in literature)
   /// \param minpts  DBSCAN minimum number of neighbors to be considered "core"
   void cluster(float radius, unsigned int minpts);
@@ -136,37 +145,22 @@ class Exp
   unsigned int browns_;   // number of premature spore particles
   unsigned int greens_;   // number of nutrient particles
   std::vector<float>             nearest_neighbor_dists_; // nn distances
-  std::vector<std::vector<Type>> type_history_;           // type changes
+  std::vector<std::vector<Type>> type_history_;           // type changes by ID
   // clustering
-  std::vector<int>           cores_;          // "core" particles
-  std::vector<int>           vague_;          // "border" or "noise" pts
-  std::vector<std::set<int>> clusters_;       // set of clusters
+  std::vector<int>           cores_;          // "core" particle IDs
+  std::vector<int>           vague_;          // "border" or "noise" IDs
+  std::vector<std::set<int>> clusters_;       // set of clusters (by ID)
   std::unordered_set<int>    cell_clusters_;  // set of cell cluster indices
   std::unordered_set<int>    spore_clusters_; // set of spore cluster indices
-  std::vector<std::set<int>> districts_;      // set of greater clusters
+  std::vector<std::set<int>> districts_;      // greater clusters (by ID)
   // injection
   std::unordered_map<Type,SpritePts> sprites_;         // sprites definition
   std::unordered_map<Type,SpritePts> greater_sprites_; // greater sprites def
   float                              sprite_x_;        // sprite x placement
   float                              sprite_y_;        // sprite y placement
-  std::vector<unsigned int>          injected_;        // injected particles
+  std::vector<unsigned int>          injected_;        // injected particle IDs
 
  private:
-  /// plain_alt_neighborhood(): Non-OpenCL version of alternative neighborhood
-  ///                           gathering.
-  ///                           Count neighbors in an alternative radius.
-  ///                           Used for coloring spores.
-  /// \param pld  left neighbor distances
-  /// \param prd  right neighbor distances
-  /// \param p  particle index
-  /// \param n_stride  neighbor list stride
-  /// \param alt_scope  alternative radius squared
-  /// \returns  number of neighbors within alternative radius
-  unsigned int plain_alt_neighborhood(std::vector<float>& pld,
-                                      std::vector<float>& prd,
-                                      unsigned int p, unsigned int n_stride,
-                                      float alt_scope);
-
   /// palette_sample(): Generate stack (cache) of random colors for clusters.
   /// \returns  set of random colors
   std::vector<float> palette_sample();
@@ -191,6 +185,10 @@ class Exp
   /// type_clusters(): Assign type to particle cluster.
   void type_clusters();
 
+  /// dbscan_identify(): Replace the particle indices of cores_, vague_,
+  ///                    clusters_ and the neighborhoods of Proc by IDs.
+  void dbscan_identify();
+
   /// type_of_cluster(): Determine type of specified particle cluster.
   /// \param cluster  particle cluster
   /// \returns  -1 if mature spore, 1 if cell, 0 otherwise
@@ -217,6 +215,12 @@ class Exp
   /// \returns  dhi
   float dhi();
 
+  /// classify(): Determine the type of a particle from its neighborhood.
+  /// \param n  number of neighbors within the vicinity (N)
+  /// \param an  number of neighbors within the alternative vicinity
+  /// \returns  particle type
+  static Type classify(unsigned int n, unsigned int an);
+
   ExpControl& expctrl_;
   Log&        log_;
   Proc&       proc_;
@@ -224,6 +228,9 @@ class Exp
   bool                            no_cl_;
   std::vector<std::vector<float>> palette_;  // cluster color cache
   unsigned int                    palette_index_;
-  std::vector<unsigned int>       inspect_;  // particles under inspection
+  std::vector<unsigned int>       inspect_;  // IDs under inspection
+  std::vector<int>                grid_;       // cell list for dhi, dbscan
+  std::vector<int>                grid_start_; // offsets into grid_
+  Halo                            halo_;       // grid_ with a halo for dhi
 };
 
@@ -2,10 +2,15 @@
 
 #include "util/common.hh"
 #include "util/log.hh"
+#include "util/rng.hh"
 #include "exp/exp.hh"
+#include "proc/ensemble.hh"
 #include "view/view.hh"
 #include <fstream>
 #include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include <unistd.h> // getopt, optarg, optopt
 
 
@@ -43,6 +48,43 @@ main(int argc, char* argv[])
   bool gui_on = opts["nogui"].empty();
   bool pause = !opts["pause"].empty();
   bool three = !opts["three"].empty();
+  unsigned int threads = 1;
+  if (!opts["threads"].empty()) {
+    threads = std::stoi(opts["threads"]);
+  }
+  unsigned int reorder = 0;
+  if (!opts["reorder"].empty()) {
+    reorder = std::stoi(opts["reorder"]);
+  }
+  float skin = 0.0f;
+  if (!opts["skin"].empty()) {
+    skin = std::stof(opts["skin"]);
+  }
+  bool fast_move = !opts["fastmove"].empty();
+  bool each_noise = !opts["eachnoise"].empty();
+  bool fused = !opts["fused"].empty();
+  unsigned int inflight = 0;
+  if (!opts["inflight"].empty()) {
+    inflight = std::stoi(opts["inflight"]);
+  }
+  std::string timings = opts["timings"];
+  unsigned int worlds = 1;
+  if (!opts["worlds"].empty()) {
+    worlds = std::stoi(opts["worlds"]);
+  }
+  std::vector<std::string> devices;
+  std::istringstream device_list(opts["device"]);
+  std::string device;
+  while (std::getline(device_list, device, ',')) {
+    devices.push_back(device);
+  }
+  if (devices.empty()) {
+    devices.push_back("");
+  }
+  if (!opts["seed"].empty()) {
+    Rng::seed(std::stoull(opts["seed"]));
+  }
+  log.add(Attn::O, "Seed: " + std::to_string(Rng::seed()), !headless);
 
   /* dependency & observation graph
    * ----------   ...........
@@ -58,10 +100,56 @@ main(int argc, char* argv[])
   // system objects
   auto expctrl = ExpControl(log, experiment);
   auto state = State(log, expctrl);
-  auto cl = Cl(log); // stub object if OpenCL is unavailable
-  auto proc = Proc(log, state, cl, no_cl);
+  auto cl = Cl(log, devices.front()); // stub object if OpenCL is unavailable
+  if (1 < worlds && 0 < expctrl.replicates()) {
+    // replicates of the experiment side by side, without views
+    if (0 < inflight) {
+      log.add(Attn::O, "Ignoring -a, as the worlds are ticked together.");
+    }
+    if (!init.empty() || pause) {
+      log.add(Attn::O, "Ignoring -i and -p, as the worlds start afresh.");
+    }
+    Ensemble ensemble(log, expctrl, cl, worlds, no_cl, threads, reorder,
+                      skin, fast_move, each_noise, fused);
+    bool timed = !timings.empty() && ensemble.timing(true);
+    if (timed) {
+      log.add(Attn::O, "Timing OpenCL commands.");
+    }
+    expctrl.message();
+    while (!ensemble.quit_) {
+      ensemble.next();
+    }
+    if (timed) {
+      if (!ensemble.save_timings(timings)) {
+        log.add(Attn::E, "unwritable file: " + timings);
+        return -1;
+      }
+      log.add(Attn::O, "Saved OpenCL timings to " + timings + ".");
+    }
+    return 0;
+  }
+  if (1 < worlds) {
+    log.add(Attn::O, "Ignoring -w, as the experiment has no instances to"
+            " run side by side.");
+  }
+  auto proc = Proc(log, state, cl, no_cl, threads, reorder, skin,
+                   fast_move, each_noise);
+  std::vector<std::unique_ptr<Cl>> strip_cls; // further devices, if split
+  std::vector<Cl*> strip_ptrs;
+  for (size_t i = 1; i < devices.size(); ++i) {
+    strip_cls.emplace_back(new Cl(log, devices[i]));
+    strip_ptrs.push_back(strip_cls.back().get());
+  }
+  if (proc.split(strip_ptrs)) {
+    log.add(Attn::O, "Splitting the world into strips across "
+            + std::to_string(devices.size()) + " OpenCL devices.");
+  }
   auto exp = Exp(log, expctrl, state, proc, no_cl);
-  auto ctrl = Control(log, state, proc, expctrl, exp, init, pause);
+  auto ctrl = Control(log, state, proc, expctrl, exp, init, pause, fused,
+                      inflight);
+  if (!timings.empty() && ctrl.timing(true)) {
+    log.add(Attn::O, "Timing OpenCL commands.");
+  }
   auto uistate = UiState(ctrl);
   std::unique_ptr<View> view = View::init(log, ctrl, uistate,
                                           headless, gui_on, three);
@@ -73,6 +161,9 @@ main(int argc, char* argv[])
   while (!ctrl.quit_) {
     ctrl.next();
   }
+  if (ctrl.timing_ && !ctrl.save_timings(timings)) {
+    return -1;
+  }
 
   return 0;
 }
@@ -85,7 +176,8 @@ usage()
   std::string me = ME;
   me[0] = tolower(me[0]);
   std::cout << "Usage: " << me
-            << " -(?h|3|c|e NUM|g|i FILE|p|q|v|x)"
+            << " -(?h|3|a NUM|c|d DEV|e NUM|f|g|i FILE|k NUM|l NUM|m|n"
+            << "|o FILE|p|q|s NUM|t NUM|v|w NUM|x)"
             << std::endl;
 }
 
@@ -99,7 +191,11 @@ help()
             << "Options:\n"
             << "  -?|-h    show this help\n"
             << "  -v       show version\n"
+            << "  -a NUM   let OpenCL run up to NUM ticks ahead of the host\n"
             << "  -c       disable OpenCL\n"
+            << "  -d DEV   use OpenCL device DEV (P:D, gpu, cpu or list them)\n"
+            << "             several (eg. 0:0,1:0) split the world in strips,\n"
+            << "             trading crossing particles and halo rows\n"
             << "  -e NUM   do an experiment\n"
             << "             occupancy:    [11, 12], [13, 14], [15]\n"
             << "             population:   [2]\n"
@@ -108,9 +204,20 @@ help()
             << "             size & noise: [51, 52, 53], [54, 55, 56]\n"
             << "             param sweep:  [6]\n"
             << "             performance:  [71, 72, 73, 74]\n"
+            << "  -f       type, color and clear particles in a single pass\n"
             << "  -i FILE  supply an initial state\n"
+            << "  -k NUM   sort particles in memory every NUM ticks\n"
+            << "  -l NUM   reuse neighbor lists with a skin radius of NUM\n"
+            << "  -m       move with approximate sine and cosine (faster)\n"
+            << "  -n       draw heading noise for each particle separately\n"
+            << "  -o FILE  time OpenCL commands, saving percentiles to FILE\n"
             << "  -p       start paused\n"
             << "  -q       suppress (non-experimental) logging to stdout\n"
+            << "  -s NUM   seed random numbers with NUM (reproducible runs)\n"
+            << "  -t NUM   seek with NUM threads when OpenCL is disabled\n"
+            << "             (at most the hardware threads; the speedup\n"
+            << "             over one thread has not been measured)\n"
+            << "  -w NUM   run NUM instances of experiments 4, 5 side by side\n"
             << "  -x       run in headless mode\n\n"
             << "Options for graphical mode:\n"
             << "  -3       start in 3d mode\n"
@@ -130,34 +237,56 @@ static std::map<std::string,std::string>
 args(int argc, char* argv[])
 {
   std::map<std::string,std::string> opts = {
+    {"device", ""},
+    {"eachnoise", ""},
     {"exp", ""},
+    {"fastmove", ""},
+    {"fused", ""},
     {"headless", ""},
+    {"inflight", ""},
     {"input", ""},
     {"nocl", ""},
     {"nogui", ""},
     {"pause", ""},
     {"quiet", ""},
     {"quit", ""},
+    {"reorder", ""},
     {"return", ""},
-    {"three", ""}
+    {"seed", ""},
+    {"skin", ""},
+    {"three", ""},
+    {"timings", ""},
+    {"threads", ""},
+    {"worlds", ""}
   };
   int opt;
-  while (-1 != (opt = getopt(argc, argv, "?3ce:gi:hpqvx"))) {
+  while (-1 != (opt = getopt(argc, argv, "?3a:cd:e:fgi:hk:l:mno:pqs:t:vw:x"))) {
     if ('?' == opt || 'h' == opt) {
       opts["quit"] = "help";
       opts["return"] = "0";
       break;
     }
     else if ('3' == opt) { opts["three"] = "."; }
+    else if ('a' == opt) { opts["inflight"] = optarg; }
     else if ('c' == opt) { opts["nocl"]  = "."; }
+    else if ('d' == opt) { opts["device"] = optarg; }
     else if ('e' == opt) { opts["exp"]   = optarg; }
+    else if ('f' == opt) { opts["fused"] = "."; }
     else if ('g' == opt) { opts["nogui"] = "."; }
     else if ('i' == opt) { opts["input"] = optarg; }
+    else if ('k' == opt) { opts["reorder"] = optarg; }
+    else if ('l' == opt) { opts["skin"] = optarg; }
+    else if ('m' == opt) { opts["fastmove"] = "."; }
+    else if ('n' == opt) { opts["eachnoise"] = "."; }
+    else if ('o' == opt) { opts["timings"] = optarg; }
     else if ('p' == opt) { opts["pause"] = "."; }
     else if ('q' == opt) { opts["quiet"] = "."; }
+    else if ('s' == opt) { opts["seed"] = optarg; }
+    else if ('t' == opt) { opts["threads"] = optarg; }
     else if ('v' == opt) { opts["quit"] = "version"; opts["return"] = "0";
       break;
     }
+    else if ('w' == opt) { opts["worlds"] = optarg; }
     else if ('x' == opt) { opts["headless"] = "."; }
     else if (':' == opt) { opts["quit"] = "noarg"; opts["return"] = "-1";
       break;
@@ -177,6 +306,29 @@ static void
 argue(Log& log, std::map<std::string,std::string>& opts)
 {
   std::string opt = opts["quit"];
+  if ("list" == opts["device"]) {
+    std::cout << Cl::devices() << std::flush;
+    opts["return"] = "0";
+    return;
+  }
+  if (!opts["threads"].empty()) {
+    std::istringstream stream(opts["threads"]);
+    unsigned int cores = std::thread::hardware_concurrency(); // 0: unknown
+    int threads = 0;
+    char rest;
+    if (!(stream >> threads) || stream >> rest || 1 > threads) {
+      opts["return"] = "-1";
+      log.add(Attn::E, "threads must be 1 or more: " + opts["threads"]);
+      usage();
+      return;
+    }
+    // more threads than the hardware runs would only contend for it
+    if (0 < cores && cores < static_cast<unsigned int>(threads)) {
+      log.add(Attn::O, "Capping -t at the " + std::to_string(cores)
+              + " hardware threads.");
+      opts["threads"] = std::to_string(cores);
+    }
+  }
   if (!opts["exp"].empty()) {
     int exp = std::stoi(opts["exp"]);
     auto exps = std::vector<int>{0,
@@ -3,13 +3,33 @@
 #if 1 == CL_ENABLED
 
 #include "../util/common.hh"
+#include "../util/rng.hh"
+#include <algorithm> // std::copy, std::nth_element, std::sort
+#include <cctype> // tolower
+#include <cstdio> // snprintf, std::remove, std::rename
+#include <cstdlib> // getenv
+#include <fstream>
+#include <iterator> // std::istreambuf_iterator
+#include <stdexcept> // std::invalid_argument, std::out_of_range
+#include <sys/stat.h> // mkdir
+#include <unistd.h> // getpid
+#include <GL/gl.h> // glFinish
+#include <GL/glx.h> // glXGetCurrentContext, glXGetCurrentDisplay
 
 
-Cl::Cl(Log& log)
-  : log_(log)
+Cl::Cl(Log& log, const std::string& device /* = "" */)
+  : log_(log), gl_(false), shared_(false), shareable_(true), capacity_(0),
+    units_capacity_(0),
+    occupied_(0), occupied_reading_(false), offsets_capacity_(0),
+    lists_capacity_(0), listed_(false), carry_capacity_(0),
+    worlds_capacity_(0), ensemble_capacity_(0), timing_(false)
 {
   std::vector<cl::Platform> platforms;
   std::vector<cl::Device> devices;
+  std::vector<cl_device_type> types;
+  size_t colon = device.find(':');
+  unsigned long p;
+  unsigned long d;
 
   cl::Platform::get(&platforms);
   if (0 == platforms.size()) {
@@ -17,68 +37,1289 @@ Cl::Cl(Log& log)
     return;
   }
   this->platform_ = platforms.front();
-  for (auto& platform : platforms) {
-    if ("FULL_PROFILE" != platform.getInfo<CL_PLATFORM_PROFILE>()) {
-      continue;
+  if (std::string::npos != colon) {
+    try {
+      p = std::stoul(device.substr(0, colon));
+      d = std::stoul(device.substr(colon + 1));
+    } catch (std::logic_error&) {
+      p = platforms.size();
+      d = 0;
     }
-    this->platform_ = platform;
-    platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
-    if (0 == devices.size()) {
-      continue;
+    if (p < platforms.size()) {
+      platforms[p].getDevices(CL_DEVICE_TYPE_ALL, &devices);
+    }
+    if (d < devices.size()) {
+      this->platform_ = platforms[p];
+      this->device_ = devices[d];
+    }
+  } else if ("gpu" == device) {
+    types = {CL_DEVICE_TYPE_GPU};
+  } else if ("cpu" == device) {
+    types = {CL_DEVICE_TYPE_CPU};
+  } else if (device.empty()) {
+    types = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ALL};
+  }
+  for (cl_device_type type : types) {
+    for (auto& platform : platforms) {
+      if ("FULL_PROFILE" != platform.getInfo<CL_PLATFORM_PROFILE>()) {
+        continue;
+      }
+      devices.clear();
+      platform.getDevices(type, &devices);
+      if (0 == devices.size()) {
+        continue;
+      }
+      this->platform_ = platform;
+      this->device_ = devices.front();
+      break;
+    }
+    if (!this->device_.getInfo<CL_DEVICE_NAME>().empty()) {
+      break;
     }
-    this->device_ = devices.front();
-    break;
   }
   std::string name = this->device_.getInfo<CL_DEVICE_NAME>();
   if (name.empty()) {
-    log.add(Attn::Ecl, "No device found.");
+    log.add(Attn::Ecl, device.empty() ? "No device found."
+                                      : "No device found: " + device);
     return;
   }
 
   this->context_ = cl::Context(this->device_);
-  //this->queue_ = cl::CommandQueue(this->context_, this->device_);
-  // profiling
-  this->queue_ = cl::CommandQueue(this->context_, this->device_, CL_QUEUE_PROFILING_ENABLE);
+  // profiling, for timing()
+  this->queue_ = cl::CommandQueue(this->context_, this->device_,
+                                  CL_QUEUE_PROFILING_ENABLE);
   this->max_cu_ = this->device_.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
   this->max_freq_ = this->device_.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
   this->max_gmem_ = this->device_.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+  this->max_wg_ = this->device_.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+
+  this->prep();
+
+  log.add(Attn::O,
+          "Started OpenCL module and found\n  device: " + name
+          + "\n  max compute units:\t" + std::to_string(this->max_cu_)
+          + "\n  max clock frequency:\t" + std::to_string(this->max_freq_)
+          + " MHz\n  max global memory:\t"
+          + std::to_string(this->max_gmem_ / 1024 / 1024) + " MB",
+          true);
+}
+
+
+std::string
+Cl::devices()
+{
+  std::vector<cl::Platform> platforms;
+  std::vector<cl::Device> devices;
+  cl_device_type type;
+  std::string list;
+
+  cl::Platform::get(&platforms);
+  for (size_t p = 0; p < platforms.size(); ++p) {
+    devices.clear();
+    platforms[p].getDevices(CL_DEVICE_TYPE_ALL, &devices);
+    for (size_t d = 0; d < devices.size(); ++d) {
+      type = devices[d].getInfo<CL_DEVICE_TYPE>();
+      list += std::to_string(p) + ":" + std::to_string(d) + " "
+              + devices[d].getInfo<CL_DEVICE_NAME>() + " ("
+              + (CL_DEVICE_TYPE_GPU & type ? "GPU"
+                 : CL_DEVICE_TYPE_CPU & type ? "CPU" : "other") + ")\n";
+    }
+  }
+  return list;
+}
+
+
+void
+Cl::prep()
+{
+  this->prep_plot();
+  this->prep_seek();
+  this->prep_gather();
+  this->prep_tile();
+  //this->prep_naive_seek();
+  this->prep_move();
+  this->prep_carry();
+  this->prep_ensemble();
+}
+
+
+bool
+Cl::share(unsigned int vbo)
+{
+  GLXContext gl_context = glXGetCurrentContext();
+  std::string extensions = this->device_.getInfo<CL_DEVICE_EXTENSIONS>();
+  cl::Context context;
+  cl::CommandQueue queue;
+
+  this->shared_ = false;
+  this->xyz_ = cl::BufferGL();
+  if (0 == vbo || !this->shareable_) {
+    return false;
+  }
+  if (!gl_context) {
+    // eg. an EGL context (Wayland), which cl_khr_gl_sharing cannot take
+    this->shareable_ = false;
+    this->log_.add(Attn::O, "No GLX context to share with OpenCL, copying"
+                   " particles through the host.");
+    return false;
+  }
+  if (std::string::npos == extensions.find("cl_khr_gl_sharing")) {
+    this->shareable_ = false;
+    this->log_.add(Attn::O, "No cl_khr_gl_sharing on the OpenCL device,"
+                   " copying particles through the host.");
+    return false;
+  }
+  try {
+    // contexts cannot be shared after the fact, so start over on one that is
+    if (!this->gl_) {
+      cl_context_properties properties[] = {
+        CL_GL_CONTEXT_KHR, (cl_context_properties)gl_context,
+        CL_GLX_DISPLAY_KHR, (cl_context_properties)glXGetCurrentDisplay(),
+        CL_CONTEXT_PLATFORM, (cl_context_properties)this->platform_(),
+        0
+      };
+      context = cl::Context(this->device_, properties);
+      queue = cl::CommandQueue(context, this->device_,
+                               CL_QUEUE_PROFILING_ENABLE);
+      this->context_ = context;
+      this->queue_ = queue;
+      this->prep();
+      this->capacity_ = 0;
+      this->units_capacity_ = 0;
+      this->occupied_ = 0;
+      this->occupied_reading_ = false;
+      this->lists_capacity_ = 0;
+      this->worlds_capacity_ = 0;
+      this->ensemble_capacity_ = 0;
+      this->gl_ = true;
+    }
+    this->xyz_ = cl::BufferGL(this->context_, CL_MEM_WRITE_ONLY, vbo);
+    this->shared_ = true;
+  } catch (cl_int err) {
+    this->shareable_ = false;
+    this->log_.add(Attn::Ecl, std::to_string(err)
+                   + ": failed to share with OpenGL, copying particles"
+                   " through the host.");
+  }
+  return this->shared_;
+}
+
+
+void
+Cl::timing(bool yesno)
+{
+  if (yesno && !this->timing_) {
+    this->times_.clear();
+  }
+  if (!yesno) {
+    this->timed_.clear();
+  }
+  this->timing_ = yesno;
+}
+
+
+std::vector<ClTiming>
+Cl::timings()
+{
+  const float ranks[3] = {0.5f, 0.9f, 0.99f};
+  std::vector<ClTiming> timings;
+  std::vector<cl_ulong> spans[3];
+  std::vector<cl_ulong> runs;
+  cl_ulong total = 0;
+  size_t k;
+
+  this->time();
+  for (auto& times : this->times_) {
+    ClTiming timing;
+    float* percentiles[3] = {timing.queue, timing.wait, timing.run};
+    cl_ulong run = 0;
+    timing.name = times.first;
+    timing.count = times.second.size();
+    for (auto& span : spans) {
+      span.clear();
+    }
+    // drivers do not all fill every stamp, so spans clamp at 0
+    for (auto& t : times.second) {
+      spans[0].push_back(t[1] > t[0] ? t[1] - t[0] : 0);
+      spans[1].push_back(t[2] > t[1] ? t[2] - t[1] : 0);
+      spans[2].push_back(t[3] > t[2] ? t[3] - t[2] : 0);
+      run += spans[2].back();
+    }
+    for (unsigned int s = 0; s < 3; ++s) {
+      for (unsigned int r = 0; r < 3; ++r) {
+        k = static_cast<size_t>(ranks[r] * (spans[s].size() - 1));
+        std::nth_element(spans[s].begin(), spans[s].begin() + k,
+                         spans[s].end());
+        percentiles[s][r] = spans[s][k] / 1000.0f;
+      }
+    }
+    timings.push_back(timing);
+    runs.push_back(run);
+    total += run;
+  }
+  for (size_t i = 0; i < timings.size(); ++i) {
+    timings[i].share = 0 < total ? static_cast<float>(runs[i]) / total
+                                 : 0.0f;
+  }
+  std::sort(timings.begin(), timings.end(),
+            [](const ClTiming& a, const ClTiming& b) {
+              return a.share > b.share;
+            });
+  return timings;
+}
+
+
+cl::Event*
+Cl::timed(const std::string& name)
+{
+  if (!this->timing_) {
+    return nullptr;
+  }
+  if (Cl::timing_window < this->timed_.size()) {
+    this->time();
+  }
+  this->timed_.emplace_back(name, cl::Event());
+  return &this->timed_.back().second;
+}
+
+
+void
+Cl::timed(const std::string& name, const cl::Event& event)
+{
+  if (!this->timing_) {
+    return;
+  }
+  this->timed_.emplace_back(name, event);
+}
+
+
+void
+Cl::time()
+{
+  std::deque<std::array<cl_ulong,4>>* times;
+
+  // the queue is in order, so the commands complete in the order timed
+  try {
+    while (!this->timed_.empty()) {
+      cl::Event& event = this->timed_.front().second;
+      if (CL_COMPLETE
+          != event.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>()) {
+        break;
+      }
+      times = &this->times_[this->timed_.front().first];
+      times->push_back({{
+        event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>(),
+        event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>(),
+        event.getProfilingInfo<CL_PROFILING_COMMAND_START>(),
+        event.getProfilingInfo<CL_PROFILING_COMMAND_END>()
+      }});
+      if (Cl::timing_window < times->size()) {
+        times->pop_front();
+      }
+      this->timed_.pop_front();
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err)
+                   + ": failed to time a command.");
+    this->timed_.clear();
+  }
+}
+
+
+cl::Program
+Cl::build(const std::string& code)
+{
+  std::string path = this->cache(code);
+  std::ifstream in(path, std::ios::binary);
+  std::ofstream out;
+  std::string temp;
+  std::vector<cl::Device> devices = {this->device_};
+  cl::Program::Binaries binaries;
+  std::vector<cl_int> status;
+  cl_int err = CL_SUCCESS;
+  cl::Program program;
+
+  // a binary that does not load or build (eg. after a driver update that
+  // kept the version string) is replaced by a fresh one
+  if (!path.empty() && in) {
+    binaries.emplace_back(std::istreambuf_iterator<char>(in),
+                          std::istreambuf_iterator<char>());
+    try {
+      program = cl::Program(this->context_, devices, binaries, &status, &err);
+      if (CL_SUCCESS == err && !status.empty() && CL_SUCCESS == status[0]
+          && CL_SUCCESS == program.build(devices)) {
+        return program;
+      }
+    } catch (cl_int) {}
+  }
+
+  program = cl::Program(this->context_, code, CL_TRUE);
+  if (path.empty()) {
+    return program;
+  }
+  binaries = program.getInfo<CL_PROGRAM_BINARIES>();
+  if (binaries.empty() || binaries.front().empty()) {
+    return program;
+  }
+  // written aside and renamed into place, so that a build running at the
+  // same time never loads a partly written binary
+  temp = path + "." + std::to_string(getpid()) + ".tmp";
+  out.open(temp, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(binaries.front().data()),
+            binaries.front().size());
+  out.close();
+  if (!out || 0 != std::rename(temp.c_str(), path.c_str())) {
+    std::remove(temp.c_str());
+  }
+  return program;
+}
+
+
+std::string
+Cl::cache(const std::string& code)
+{
+  const char* xdg = getenv("XDG_CACHE_HOME");
+  const char* home = getenv("HOME");
+  std::string me = ME;
+  std::string dir;
+  std::string key;
+  unsigned long long hash = 0xCBF29CE484222325ull; // FNV-1a
+  char name[17];
+
+  if (xdg && *xdg) {
+    dir = xdg;
+  } else if (home && *home) {
+    dir = std::string(home) + "/.cache";
+  } else {
+    return "";
+  }
+  mkdir(dir.c_str(), 0755);
+  me[0] = tolower(me[0]);
+  dir += "/" + me;
+  mkdir(dir.c_str(), 0755);
+
+  key = this->device_.getInfo<CL_DEVICE_NAME>() + '\n'
+        + this->device_.getInfo<CL_DRIVER_VERSION>() + '\n' + code;
+  for (unsigned char c : key) {
+    hash = (hash ^ c) * 0x100000001B3ull;
+  }
+  snprintf(name, sizeof(name), "%016llx", hash);
+  return dir + "/" + name + ".clbin";
+}
+
+
+void
+Cl::prep_seek()
+{
+  std::string code =
+    "void inc(\n"
+    "  volatile __global int* n\n"
+    ") {\n"
+    "  atomic_inc(n);\n"
+    "}\n"
+    "\n"
+    "__kernel void particles_seek(\n"
+    "  __private float SCOPE,\n"
+    "  __private float ASCOPE,\n"
+    "  __private float W,\n"
+    "  __private float H,\n"
+    "  __private int COLS,\n"
+    "  __private int ROWS,\n"
+    "  __global const int* GSTART,\n"
+    "  __global const int* GRID,\n"
+    "  __global const int* COL,\n"
+    "  __global const int* ROW,\n"
+    "  __global const int* RANK,\n"
+    "  __global const float* PX,\n"
+    "  __global const float* PY,\n"
+    "  __global const float* PC,\n"
+    "  __global const float* PS,\n"
+    "  __global unsigned int* PN,\n"
+    "  __global unsigned int* PAN,\n"
+    "  __global unsigned int* PL,\n"
+    "  __global unsigned int* PR\n"
+    ") {\n"
+    "  int srci = get_global_id(0);\n"
+    "  int col = COL[srci];\n"
+    "  int row = ROW[srci];\n"
+    // the rest of its own grid unit, the one east, and the three south
+    "  int vcol[5] = {col, col + 1, col - 1, col, col + 1};\n"
+    "  int vrow[5] = {row, row, row + 1, row + 1, row + 1};\n"
+    "  int c;\n"
+    "  int r;\n"
+    "  int unit;\n"
+    "  int dsti;\n"
+    "  float offx;\n"
+    "  float offy;\n"
+    "  float srcx = PX[srci];\n"
+    "  float srcy = PY[srci];\n"
+    "  float dx;\n"
+    "  float dy;\n"
+    "  float dist;\n"
+    "  float srcc = PC[srci];\n"
+    "  float srcs = PS[srci];\n"
+    "  float dstc;\n"
+    "  float dsts;\n"
+    "  for (int v = 0; v < 5; ++v) {\n"
+    "    c = vcol[v];\n"
+    "    r = vrow[v];\n"
+    "    offx = 0 > c ? -W : COLS <= c ? W : 0.0f;\n"
+    "    offy = ROWS <= r ? H : 0.0f;\n"
+    "    c = 0 > c ? COLS - 1 : COLS <= c ? 0 : c;\n"
+    "    r = ROWS <= r ? 0 : r;\n"
+    "    unit = (COLS * r) + c;\n"
+    "    for (int p = GSTART[unit] + (0 == v ? RANK[srci] + 1 : 0);\n"
+    "         p < GSTART[unit + 1]; ++p) {\n"
+    "      dsti = GRID[p];\n"
+    "      if (srci == dsti) {\n"
+    "        continue;\n"
+    "      }\n"
+    "      dx = (PX[dsti] - srcx) + offx;\n"
+    "      dy = (PY[dsti] - srcy) + offy;\n"
+    "      dist = (dx * dx) + (dy * dy);\n"
+    "      if (SCOPE < dist) {\n"
+    "        continue;\n"
+    "      }\n"
+    "      if (ASCOPE >= dist) {\n"
+    "        inc(&PAN[srci]);\n"
+    "        inc(&PAN[dsti]);\n"
+    "      }\n"
+    "      inc(&PN[srci]);\n"
+    "      inc(&PN[dsti]);\n"
+    "      dstc = PC[dsti];\n"
+    "      dsts = PS[dsti];\n"
+    "      if (0.0f > (dx * srcs) - (dy * srcc)) { inc(&PR[srci]); }\n"
+    "      else                                  { inc(&PL[srci]); }\n"
+    "      if (0.0f < (dx * dsts) - (dy * dstc)) { inc(&PR[dsti]); }\n"
+    "      else                                  { inc(&PL[dsti]); }\n"
+    /**
+    // TODO: duplication and misses occur when modifying PLS/PRD/etc. in
+    //       parallel, so passing in alternative neighborhood scope instead.
+    //       See prep_gather() for neighbor lists without atomics.
+    "      dststride = NSTRIDE * dsti;\n"
+    "      srcl = PL[srci];\n"
+    "      srcr = PR[srci];\n"
+    "      dstl = PL[dsti];\n"
+    "      dstr = PR[dsti];\n"
+    "      srcli = srcstride + srcl;\n"
+    "      srcri = srcstride + srcr;\n"
+    "      dstli = dststride + dstl;\n"
+    "      dstri = dststride + dstr;\n"
+    "      if (0.0f > (dx * srcs) - (dy * srcc)) {\n"
+    "        if (NSTRIDE > srcr) {\n"
+    "          PRS[srcri] = dsti;\n"
+    "          PRD[srcri] = dist;\n"
+    "        }\n"
+    "        inc(&PR[srci]);\n"
+    "      }\n"
+    "      else {\n"
+    "        if (NSTRIDE > srcl) {\n"
+    "          PLS[srcli] = dsti;\n"
+    "          PLD[srcli] = dist;\n"
+    "        }\n"
+    "        inc(&PL[srci]);\n"
+    "      }\n"
+    "      if (0.0f < (dx * dsts) - (dy * dstc)) {\n"
+    "        if (NSTRIDE > dstr) {\n"
+    "          PRS[dstri] = srci;\n"
+    "          PRD[dstri] = dist;\n"
+    "        }\n"
+    "        inc(&PR[dsti]);\n"
+    "      }\n"
+    "      else {\n"
+    "        if (NSTRIDE > dstl) {\n"
+    "          PLS[dstli] = srci;\n"
+    "          PLD[dstli] = dist;\n"
+    "        }\n"
+    "        inc(&PL[dsti]);\n"
+    "      }\n"
+    //*/
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+  Log& log = this->log_;
+  try {
+    std::string name = "particles_seek";
+    cl::Program program = this->build(code);
+    int compile_err;
+    this->kernel_seek_ = cl::Kernel(program, name.c_str(), &compile_err);
+    if (compile_err) {
+      log.add(Attn::Ecl, std::to_string(compile_err) + ": failed to compile '"
+              + name + "'.");
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::push(unsigned int n, std::vector<unsigned int>& pid,
+         std::vector<float>& px, std::vector<float>& py,
+         std::vector<float>& pf,
+         std::vector<float>& pc, std::vector<float>& ps)
+{
+  const cl_uint float_size = n * sizeof(float);
+  const cl_uint uint_size = n * sizeof(unsigned int);
+  this->enlarge(n, 0);
+  try {
+    this->queue_.enqueueWriteBuffer(this->pid_, CL_FALSE, 0, uint_size,
+                                    pid.data(),
+                                    nullptr, this->timed("write pid"));
+    this->queue_.enqueueWriteBuffer(this->px_, CL_FALSE, 0, float_size,
+                                    px.data(),
+                                    nullptr, this->timed("write px"));
+    this->queue_.enqueueWriteBuffer(this->py_, CL_FALSE, 0, float_size,
+                                    py.data(),
+                                    nullptr, this->timed("write py"));
+    this->queue_.enqueueWriteBuffer(this->pf_, CL_FALSE, 0, float_size,
+                                    pf.data(),
+                                    nullptr, this->timed("write pf"));
+    this->queue_.enqueueWriteBuffer(this->pc_, CL_FALSE, 0, float_size,
+                                    pc.data(),
+                                    nullptr, this->timed("write pc"));
+    this->queue_.enqueueWriteBuffer(this->ps_, CL_FALSE, 0, float_size,
+                                    ps.data(),
+                                    nullptr, this->timed("write ps"));
+    this->queue_.finish();
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::enlarge(unsigned int n, unsigned int keep)
+{
+  // strips of a split world change size every tick, so they get some slack
+  const unsigned int room = 0 < keep ? n + n / 4 : n;
+  const cl_uint float_size = room * sizeof(float);
+  const cl_uint int_size = room * sizeof(int);
+  const cl_uint uint_size = room * sizeof(unsigned int);
+  cl::Buffer kept[6] = {this->pid_, this->px_, this->py_,
+                        this->pf_, this->pc_, this->ps_};
+  cl::Context& context = this->context_;
+
+  if (this->capacity_ >= n) {
+    return;
+  }
+  try {
+    this->pid_ = cl::Buffer(context, CL_MEM_READ_WRITE, uint_size);
+    this->px_ = cl::Buffer(context, CL_MEM_READ_WRITE, float_size);
+    this->py_ = cl::Buffer(context, CL_MEM_READ_WRITE, float_size);
+    this->pf_ = cl::Buffer(context, CL_MEM_READ_WRITE, float_size);
+    this->pc_ = cl::Buffer(context, CL_MEM_READ_WRITE, float_size);
+    this->ps_ = cl::Buffer(context, CL_MEM_READ_WRITE, float_size);
+    this->pn_ = cl::Buffer(context, CL_MEM_READ_WRITE, uint_size);
+    this->pan_ = cl::Buffer(context, CL_MEM_READ_WRITE, uint_size);
+    this->pl_ = cl::Buffer(context, CL_MEM_READ_WRITE, uint_size);
+    this->pr_ = cl::Buffer(context, CL_MEM_READ_WRITE, uint_size);
+    this->gcol_ = cl::Buffer(context, CL_MEM_READ_WRITE, int_size);
+    this->grow_ = cl::Buffer(context, CL_MEM_READ_WRITE, int_size);
+    this->grank_ = cl::Buffer(context, CL_MEM_READ_WRITE, int_size);
+    this->grid_ = cl::Buffer(context, CL_MEM_READ_WRITE, int_size);
+    this->capacity_ = room;
+    if (0 < keep) {
+      cl::Buffer* into[6] = {&this->pid_, &this->px_, &this->py_,
+                             &this->pf_, &this->pc_, &this->ps_};
+      for (unsigned int b = 0; b < 6; ++b) {
+        this->queue_.enqueueCopyBuffer(kept[b], *into[b], 0, 0,
+                                       keep * sizeof(cl_uint),
+                                       nullptr, this->timed("copy kept"));
+      }
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::prep_carry()
+{
+  // PHI, X, Y etc. are carried as words, which copies them exactly
+  std::string code =
+    "__kernel void particles_carry(\n"
+    "  __global const int* SRC,\n"
+    "  __global const int* DST,\n"
+    "  __global const unsigned int* FROM,\n"
+    "  __global unsigned int* TO\n"
+    ") {\n"
+    "  int k = get_global_id(0);\n"
+    "  TO[DST[k]] = FROM[SRC[k]];\n"
+    "}\n";
+
+  Log& log = this->log_;
+  try {
+    std::string name = "particles_carry";
+    cl::Program program = this->build(code);
+    int compile_err;
+    this->kernel_carry_ = cl::Kernel(program, name.c_str(), &compile_err);
+    if (compile_err) {
+      log.add(Attn::Ecl, std::to_string(compile_err) + ": failed to compile '"
+              + name + "'.");
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::carry(unsigned int m, cl::Buffer& from, cl::Buffer& to,
+          const std::string& name)
+{
+  this->kernel_carry_.setArg(0, this->csrc_);
+  this->kernel_carry_.setArg(1, this->cdst_);
+  this->kernel_carry_.setArg(2, from);
+  this->kernel_carry_.setArg(3, to);
+  this->queue_.enqueueNDRangeKernel(this->kernel_carry_,
+                                    cl::NullRange, m, cl::NullRange,
+                                    nullptr, this->timed(name));
+}
+
+
+void
+Cl::reserve_carry(unsigned int m)
+{
+  const cl_uint int_size = m * sizeof(int);
+  const cl_uint float_size = m * sizeof(float);
+  cl::Context& context = this->context_;
+  try {
+    if (this->carry_capacity_ < m) {
+      this->csrc_ = cl::Buffer(context, CL_MEM_READ_ONLY, int_size);
+      this->cdst_ = cl::Buffer(context, CL_MEM_READ_ONLY, int_size);
+      this->cpf_ = cl::Buffer(context, CL_MEM_WRITE_ONLY, float_size);
+      this->cpc_ = cl::Buffer(context, CL_MEM_WRITE_ONLY, float_size);
+      this->cps_ = cl::Buffer(context, CL_MEM_WRITE_ONLY, float_size);
+      this->carry_capacity_ = m;
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::take(const std::vector<int>& slots, std::vector<float>& pf,
+         std::vector<float>& pc, std::vector<float>& ps)
+{
+  const unsigned int m = slots.size();
+  const cl_uint int_size = m * sizeof(int);
+  const cl_uint float_size = m * sizeof(float);
+  std::vector<int> order(m);
+
+  pf.resize(m);
+  pc.resize(m);
+  ps.resize(m);
+  if (0 == m) {
+    return;
+  }
+  for (unsigned int k = 0; k < m; ++k) {
+    order[k] = k;
+  }
+  this->reserve_carry(m);
+  try {
+    this->queue_.enqueueWriteBuffer(this->csrc_, CL_FALSE, 0, int_size,
+                                    slots.data(),
+                                    nullptr, this->timed("write csrc"));
+    this->queue_.enqueueWriteBuffer(this->cdst_, CL_FALSE, 0, int_size,
+                                    order.data(),
+                                    nullptr, this->timed("write cdst"));
+    this->carry(m, this->pf_, this->cpf_, "carry pf");
+    this->carry(m, this->pc_, this->cpc_, "carry pc");
+    this->carry(m, this->ps_, this->cps_, "carry ps");
+    this->queue_.enqueueReadBuffer(this->cpf_, CL_FALSE, 0, float_size,
+                                   pf.data(), nullptr, this->timed("read cpf"));
+    this->queue_.enqueueReadBuffer(this->cpc_, CL_FALSE, 0, float_size,
+                                   pc.data(), nullptr, this->timed("read cpc"));
+    this->queue_.enqueueReadBuffer(this->cps_, CL_FALSE, 0, float_size,
+                                   ps.data(), nullptr, this->timed("read cps"));
+    this->queue_.finish();
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::pack(const std::vector<int>& dst, const std::vector<int>& src)
+{
+  const unsigned int m = dst.size();
+  const cl_uint int_size = m * sizeof(int);
+
+  if (0 == m) {
+    return;
+  }
+  this->reserve_carry(m);
+  try {
+    this->queue_.enqueueWriteBuffer(this->csrc_, CL_FALSE, 0, int_size,
+                                    src.data(),
+                                    nullptr, this->timed("write csrc"));
+    this->queue_.enqueueWriteBuffer(this->cdst_, CL_FALSE, 0, int_size,
+                                    dst.data(),
+                                    nullptr, this->timed("write cdst"));
+    // no slot is both carried from and into
+    this->carry(m, this->pid_, this->pid_, "carry pid");
+    this->carry(m, this->px_, this->px_, "carry px");
+    this->carry(m, this->py_, this->py_, "carry py");
+    this->carry(m, this->pf_, this->pf_, "carry pf");
+    this->carry(m, this->pc_, this->pc_, "carry pc");
+    this->carry(m, this->ps_, this->ps_, "carry ps");
+    this->queue_.finish();
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::place(unsigned int at, std::vector<unsigned int>& pid,
+          std::vector<float>& px, std::vector<float>& py,
+          std::vector<float>& pf,
+          std::vector<float>& pc, std::vector<float>& ps)
+{
+  const unsigned int m = px.size();
+  const cl_uint offset = at * sizeof(float);
+  const cl_uint float_size = m * sizeof(float);
+  const cl_uint uint_size = m * sizeof(unsigned int);
+
+  if (0 == m) {
+    return;
+  }
+  this->enlarge(at + m, at);
+  try {
+    this->queue_.enqueueWriteBuffer(this->pid_, CL_FALSE, offset, uint_size,
+                                    pid.data(),
+                                    nullptr, this->timed("write pid"));
+    this->queue_.enqueueWriteBuffer(this->px_, CL_FALSE, offset, float_size,
+                                    px.data(),
+                                    nullptr, this->timed("write px"));
+    this->queue_.enqueueWriteBuffer(this->py_, CL_FALSE, offset, float_size,
+                                    py.data(),
+                                    nullptr, this->timed("write py"));
+    this->queue_.enqueueWriteBuffer(this->pf_, CL_FALSE, offset, float_size,
+                                    pf.data(),
+                                    nullptr, this->timed("write pf"));
+    this->queue_.enqueueWriteBuffer(this->pc_, CL_FALSE, offset, float_size,
+                                    pc.data(),
+                                    nullptr, this->timed("write pc"));
+    this->queue_.enqueueWriteBuffer(this->ps_, CL_FALSE, offset, float_size,
+                                    ps.data(),
+                                    nullptr, this->timed("write ps"));
+    this->queue_.finish();
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::halo(unsigned int at, std::vector<float>& px, std::vector<float>& py)
+{
+  const unsigned int m = px.size();
+  const cl_uint offset = at * sizeof(float);
+  const cl_uint float_size = m * sizeof(float);
+
+  if (0 == m) {
+    return;
+  }
+  this->enlarge(at + m, at);
+  try {
+    this->queue_.enqueueWriteBuffer(this->px_, CL_FALSE, offset, float_size,
+                                    px.data(),
+                                    nullptr, this->timed("write halo px"));
+    this->queue_.enqueueWriteBuffer(this->py_, CL_FALSE, offset, float_size,
+                                    py.data(),
+                                    nullptr, this->timed("write halo py"));
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::pull(unsigned int n, std::vector<float>& px, std::vector<float>& py,
+         std::vector<float>& pf,
+         std::vector<float>& pc, std::vector<float>& ps,
+         std::vector<unsigned int>& pl, std::vector<unsigned int>& pr)
+{
+  const cl_uint float_size = n * sizeof(float);
+  const cl_uint uint_size = n * sizeof(unsigned int);
+  try {
+    if (this->shared_) {
+      this->queue_.enqueueReadBuffer(this->px_, CL_FALSE, 0, float_size,
+                                     px.data(),
+                                     nullptr, this->timed("read px"));
+      this->queue_.enqueueReadBuffer(this->py_, CL_FALSE, 0, float_size,
+                                     py.data(),
+                                     nullptr, this->timed("read py"));
+    }
+    this->queue_.enqueueReadBuffer(this->pf_, CL_FALSE, 0, float_size,
+                                   pf.data(), nullptr, this->timed("read pf"));
+    this->queue_.enqueueReadBuffer(this->pc_, CL_FALSE, 0, float_size,
+                                   pc.data(), nullptr, this->timed("read pc"));
+    this->queue_.enqueueReadBuffer(this->ps_, CL_FALSE, 0, float_size,
+                                   ps.data(), nullptr, this->timed("read ps"));
+    this->queue_.enqueueReadBuffer(this->pl_, CL_FALSE, 0, uint_size,
+                                   pl.data(), nullptr, this->timed("read pl"));
+    this->queue_.enqueueReadBuffer(this->pr_, CL_FALSE, 0, uint_size,
+                                   pr.data(), nullptr, this->timed("read pr"));
+    this->queue_.finish();
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::prep_plot()
+{
+  std::string code =
+    "__kernel void grid_count(\n"
+    "  __private float UW,\n"
+    "  __private float UH,\n"
+    "  __private int COLS,\n"
+    "  __private int ROWS,\n"
+    "  __global const float* PX,\n"
+    "  __global const float* PY,\n"
+    "  __global int* COL,\n"
+    "  __global int* ROW,\n"
+    "  __global int* RANK,\n"
+    "  __global int* GCOUNT\n"
+    ") {\n"
+    "  int i = get_global_id(0);\n"
+    "  int col = min((int)floor(PX[i] / UW), COLS - 1);\n"
+    "  int row = min((int)floor(PY[i] / UH), ROWS - 1);\n"
+    "  COL[i] = col;\n"
+    "  ROW[i] = row;\n"
+    "  RANK[i] = atomic_inc(&GCOUNT[(COLS * row) + col]);\n"
+    "}\n"
+    "\n"
+    // a single work-group, each work-item of which sums a run of grid units
+    // before the sums are scanned in local memory, and which counts the
+    // grid units holding particles by the way
+    "__kernel void grid_scan(\n"
+    "  __private int UNITS,\n"
+    "  __global const int* GCOUNT,\n"
+    "  __global int* GSTART,\n"
+    "  __global int* GOCCUPIED,\n"
+    "  __local int* SUMS\n"
+    ") {\n"
+    "  int l = get_local_id(0);\n"
+    "  int size = get_local_size(0);\n"
+    "  int run = (UNITS + size - 1) / size;\n"
+    "  int from = min(l * run, UNITS);\n"
+    "  int to = min(from + run, UNITS);\n"
+    "  int sum = 0;\n"
+    "  int occupied = 0;\n"
+    "  int add;\n"
+    "  for (int u = from; u < to; ++u) {\n"
+    "    sum += GCOUNT[u];\n"
+    "    occupied += 0 < GCOUNT[u];\n"
+    "  }\n"
+    "  SUMS[l] = sum;\n"
+    "  barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "  for (int d = 1; d < size; d <<= 1) {\n"
+    "    add = d <= l ? SUMS[l - d] : 0;\n"
+    "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "    SUMS[l] += add;\n"
+    "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "  }\n"
+    "  sum = SUMS[l] - sum;\n"
+    "  for (int u = from; u < to; ++u) {\n"
+    "    GSTART[u] = sum;\n"
+    "    sum += GCOUNT[u];\n"
+    "  }\n"
+    "  if (size - 1 == l) {\n"
+    "    GSTART[UNITS] = SUMS[l];\n"
+    "  }\n"
+    "  barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "  SUMS[l] = occupied;\n"
+    "  barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "  if (0 == l) {\n"
+    "    for (int d = 1; d < size; ++d) {\n"
+    "      occupied += SUMS[d];\n"
+    "    }\n"
+    "    GOCCUPIED[0] = occupied;\n"
+    "  }\n"
+    "}\n"
+    "\n"
+    "__kernel void grid_fill(\n"
+    "  __private int COLS,\n"
+    "  __global const int* COL,\n"
+    "  __global const int* ROW,\n"
+    "  __global const int* RANK,\n"
+    "  __global const int* GSTART,\n"
+    "  __global int* GRID\n"
+    ") {\n"
+    "  int i = get_global_id(0);\n"
+    "  GRID[GSTART[(COLS * ROW[i]) + COL[i]] + RANK[i]] = i;\n"
+    "}\n";
+
+  Log& log = this->log_;
+  try {
+    cl::Program program = this->build(code);
+    int compile_err;
+    std::string names[3] = {"grid_count", "grid_scan", "grid_fill"};
+    cl::Kernel* kernels[3] = {&this->kernel_count_, &this->kernel_scan_,
+                              &this->kernel_fill_};
+    for (unsigned int k = 0; k < 3; ++k) {
+      *kernels[k] = cl::Kernel(program, names[k].c_str(), &compile_err);
+      if (compile_err) {
+        log.add(Attn::Ecl, std::to_string(compile_err)
+                + ": failed to compile '" + names[k] + "'.");
+      }
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::plot(unsigned int n, unsigned int w, unsigned int h, int cols, int rows)
+{
+  const unsigned int units = cols * rows;
+  const size_t scan_size = 256 < this->max_wg_ ? 256 : this->max_wg_;
+  cl::Context& context = this->context_;
+  try {
+    if (this->units_capacity_ < units) {
+      this->gcount_ = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                 units * sizeof(int));
+      this->gstart_ = cl::Buffer(context, CL_MEM_READ_WRITE,
+                                 (units + 1) * sizeof(int));
+      this->goccupied_ = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(int));
+      this->units_capacity_ = units;
+    }
+    this->kernel_count_.setArg(0, static_cast<cl_float>(w) / cols);
+    this->kernel_count_.setArg(1, static_cast<cl_float>(h) / rows);
+    this->kernel_count_.setArg(2, static_cast<cl_int>(cols));
+    this->kernel_count_.setArg(3, static_cast<cl_int>(rows));
+    this->kernel_count_.setArg(4, this->px_);
+    this->kernel_count_.setArg(5, this->py_);
+    this->kernel_count_.setArg(6, this->gcol_);
+    this->kernel_count_.setArg(7, this->grow_);
+    this->kernel_count_.setArg(8, this->grank_);
+    this->kernel_count_.setArg(9, this->gcount_);
+    this->kernel_scan_.setArg(0, static_cast<cl_int>(units));
+    this->kernel_scan_.setArg(1, this->gcount_);
+    this->kernel_scan_.setArg(2, this->gstart_);
+    this->kernel_scan_.setArg(3, this->goccupied_);
+    this->kernel_scan_.setArg(4, cl::Local(scan_size * sizeof(cl_int)));
+    this->kernel_fill_.setArg(0, static_cast<cl_int>(cols));
+    this->kernel_fill_.setArg(1, this->gcol_);
+    this->kernel_fill_.setArg(2, this->grow_);
+    this->kernel_fill_.setArg(3, this->grank_);
+    this->kernel_fill_.setArg(4, this->gstart_);
+    this->kernel_fill_.setArg(5, this->grid_);
+    this->queue_.enqueueFillBuffer(this->gcount_, 0, 0, units * sizeof(int),
+                                   nullptr, this->timed("fill gcount"));
+    this->queue_.enqueueNDRangeKernel(this->kernel_count_,
+                                      cl::NullRange, n, cl::NullRange,
+                                      nullptr, this->timed("grid_count"));
+    this->queue_.enqueueNDRangeKernel(this->kernel_scan_, cl::NullRange,
+                                      scan_size, scan_size,
+                                      nullptr, this->timed("grid_scan"));
+    this->queue_.enqueueNDRangeKernel(this->kernel_fill_,
+                                      cl::NullRange, n, cl::NullRange,
+                                      nullptr, this->timed("grid_fill"));
+    // for gather() to choose its kernel by at a later tick, once landed
+    if (!this->occupied_reading_) {
+      this->queue_.enqueueReadBuffer(this->goccupied_, CL_FALSE, 0,
+                                     sizeof(cl_int), &this->occupied_read_,
+                                     nullptr, &this->occupied_done_);
+      this->timed("read goccupied", this->occupied_done_);
+      this->occupied_reading_ = true;
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::grid(unsigned int n, unsigned int units,
+         std::vector<int>& grid, std::vector<int>& gstart,
+         std::vector<int>& gcol, std::vector<int>& grow)
+{
+  const cl_uint int_size = n * sizeof(int);
+  grid.resize(n);
+  gstart.resize(units + 1);
+  gcol.resize(n);
+  grow.resize(n);
+  try {
+    this->queue_.enqueueReadBuffer(this->grid_, CL_FALSE, 0, int_size,
+                                   grid.data(),
+                                   nullptr, this->timed("read grid"));
+    this->queue_.enqueueReadBuffer(this->gstart_, CL_FALSE, 0,
+                                   (units + 1) * sizeof(int), gstart.data(),
+                                   nullptr, this->timed("read gstart"));
+    this->queue_.enqueueReadBuffer(this->gcol_, CL_FALSE, 0, int_size,
+                                   gcol.data(),
+                                   nullptr, this->timed("read gcol"));
+    this->queue_.enqueueReadBuffer(this->grow_, CL_FALSE, 0, int_size,
+                                   grow.data(),
+                                   nullptr, this->timed("read grow"));
+    this->queue_.finish();
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::seek(unsigned int n, float scope, float ascope,
+         unsigned int w, unsigned int h, int cols, int rows,
+         std::vector<unsigned int>& pn, std::vector<unsigned int>& pan)
+{
+  const cl_uint uint_size = n * sizeof(unsigned int);
+  this->plot(n, w, h, cols, rows);
+  try {
+    this->kernel_seek_.setArg( 0, static_cast<cl_float>(scope));
+    this->kernel_seek_.setArg( 1, static_cast<cl_float>(ascope));
+    this->kernel_seek_.setArg( 2, static_cast<cl_float>(w));
+    this->kernel_seek_.setArg( 3, static_cast<cl_float>(h));
+    this->kernel_seek_.setArg( 4, static_cast<cl_int>(cols));
+    this->kernel_seek_.setArg( 5, static_cast<cl_int>(rows));
+    this->kernel_seek_.setArg( 6, this->gstart_);
+    this->kernel_seek_.setArg( 7, this->grid_);
+    this->kernel_seek_.setArg( 8, this->gcol_);
+    this->kernel_seek_.setArg( 9, this->grow_);
+    this->kernel_seek_.setArg(10, this->grank_);
+    this->kernel_seek_.setArg(11, this->px_);
+    this->kernel_seek_.setArg(12, this->py_);
+    this->kernel_seek_.setArg(13, this->pc_);
+    this->kernel_seek_.setArg(14, this->ps_);
+    this->kernel_seek_.setArg(15, this->pn_);
+    this->kernel_seek_.setArg(16, this->pan_);
+    this->kernel_seek_.setArg(17, this->pl_);
+    this->kernel_seek_.setArg(18, this->pr_);
+    this->queue_.enqueueFillBuffer(this->pn_, 0u, 0, uint_size,
+                                   nullptr, this->timed("fill pn"));
+    this->queue_.enqueueFillBuffer(this->pan_, 0u, 0, uint_size,
+                                   nullptr, this->timed("fill pan"));
+    this->queue_.enqueueFillBuffer(this->pl_, 0u, 0, uint_size,
+                                   nullptr, this->timed("fill pl"));
+    this->queue_.enqueueFillBuffer(this->pr_, 0u, 0, uint_size,
+                                   nullptr, this->timed("fill pr"));
+    this->queue_.enqueueNDRangeKernel(this->kernel_seek_,
+                                      cl::NullRange, n, cl::NullRange,
+                                      nullptr, this->timed("particles_seek"));
+    // L and R stay for move(), N and the alternative N are for Exp::type()
+    this->queue_.enqueueReadBuffer(this->pn_, CL_FALSE, 0, uint_size,
+                                   pn.data(), nullptr, this->timed("read pn"));
+    this->queue_.enqueueReadBuffer(this->pan_, CL_FALSE, 0, uint_size,
+                                   pan.data(),
+                                   nullptr, this->timed("read pan"));
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::prep_gather()
+{
+  std::string code =
+    "__kernel void particles_gather(\n"
+    "  __private float SCOPE,\n"
+    "  __private float ASCOPE,\n"
+    "  __private float W,\n"
+    "  __private float H,\n"
+    "  __private int COLS,\n"
+    "  __private int ROWS,\n"
+    "  __private int LISTS,\n"
+    "  __global const int* GSTART,\n"
+    "  __global const int* GRID,\n"
+    "  __global const int* COL,\n"
+    "  __global const int* ROW,\n"
+    "  __global const float* PX,\n"
+    "  __global const float* PY,\n"
+    "  __global const float* PC,\n"
+    "  __global const float* PS,\n"
+    "  __global unsigned int* PN,\n"
+    "  __global unsigned int* PAN,\n"
+    "  __global unsigned int* PL,\n"
+    "  __global unsigned int* PR,\n"
+    "  __global const unsigned int* PLO,\n"
+    "  __global const unsigned int* PRO,\n"
+    "  __global int* PLS,\n"
+    "  __global float* PLD,\n"
+    "  __global int* PRS,\n"
+    "  __global float* PRD\n"
+    ") {\n"
+    "  int srci = get_global_id(0);\n"
+    "  int col = COL[srci];\n"
+    "  int row = ROW[srci];\n"
+    // the lists of this particle, each as long as its count, see list()
+    "  unsigned int lo = LISTS ? PLO[srci] : 0;\n"
+    "  unsigned int lend = LISTS ? PLO[srci + 1] : 0;\n"
+    "  unsigned int ro = LISTS ? PRO[srci] : 0;\n"
+    "  unsigned int rend = LISTS ? PRO[srci + 1] : 0;\n"
+    "  int c;\n"
+    "  int r;\n"
+    "  int unit;\n"
+    "  int dsti;\n"
+    "  unsigned int n = 0;\n"
+    "  unsigned int an = 0;\n"
+    "  unsigned int ln = 0;\n"
+    "  unsigned int rn = 0;\n"
+    "  float offx;\n"
+    "  float offy;\n"
+    "  float srcx = PX[srci];\n"
+    "  float srcy = PY[srci];\n"
+    "  float dx;\n"
+    "  float dy;\n"
+    "  float dist;\n"
+    "  float srcc = PC[srci];\n"
+    "  float srcs = PS[srci];\n"
+    // all nine grid units around and including its own
+    "  for (int v = 0; v < 9; ++v) {\n"
+    "    c = col + (v % 3) - 1;\n"
+    "    r = row + (v / 3) - 1;\n"
+    "    offx = 0 > c ? -W : COLS <= c ? W : 0.0f;\n"
+    "    offy = 0 > r ? -H : ROWS <= r ? H : 0.0f;\n"
+    "    c = 0 > c ? COLS - 1 : COLS <= c ? 0 : c;\n"
+    "    r = 0 > r ? ROWS - 1 : ROWS <= r ? 0 : r;\n"
+    "    unit = (COLS * r) + c;\n"
+    "    for (int p = GSTART[unit]; p < GSTART[unit + 1]; ++p) {\n"
+    "      dsti = GRID[p];\n"
+    "      if (srci == dsti) {\n"
+    "        continue;\n"
+    "      }\n"
+    "      dx = (PX[dsti] - srcx) + offx;\n"
+    "      dy = (PY[dsti] - srcy) + offy;\n"
+    "      dist = (dx * dx) + (dy * dy);\n"
+    "      if (SCOPE < dist) {\n"
+    "        continue;\n"
+    "      }\n"
+    "      an += ASCOPE >= dist;\n"
+    "      ++n;\n"
+    "      if (0.0f > (dx * srcs) - (dy * srcc)) {\n"
+    "        if (ro + rn < rend) {\n"
+    "          PRS[ro + rn] = dsti;\n"
+    "          PRD[ro + rn] = dist;\n"
+    "        }\n"
+    "        ++rn;\n"
+    "      } else {\n"
+    "        if (lo + ln < lend) {\n"
+    "          PLS[lo + ln] = dsti;\n"
+    "          PLD[lo + ln] = dist;\n"
+    "        }\n"
+    "        ++ln;\n"
+    "      }\n"
+    "    }\n"
+    "  }\n"
+    "  PN[srci] = n;\n"
+    "  PAN[srci] = an;\n"
+    "  PL[srci] = ln;\n"
+    "  PR[srci] = rn;\n"
+    "}\n";
+
+  Log& log = this->log_;
+  try {
+    std::string name = "particles_gather";
+    cl::Program program = this->build(code);
+    int compile_err;
+    this->kernel_gather_ = cl::Kernel(program, name.c_str(), &compile_err);
+    if (compile_err) {
+      log.add(Attn::Ecl, std::to_string(compile_err) + ": failed to compile '"
+              + name + "'.");
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::gather(unsigned int n, float scope, float ascope,
+           unsigned int w, unsigned int h, int cols, int rows,
+           bool lists,
+           std::vector<unsigned int>& pn, std::vector<unsigned int>& pan)
+{
+  const cl_uint uint_size = n * sizeof(unsigned int);
+  // the last tick's grid is as good a guess as any for this tick's, but with
+  // ticks in flight (see move()) it may not have landed yet
+  if (this->occupied_reading_
+      && CL_COMPLETE == this->occupied_done_.getInfo<
+           CL_EVENT_COMMAND_EXECUTION_STATUS>()) {
+    this->occupied_ = this->occupied_read_;
+    this->occupied_reading_ = false;
+  }
+  if (0 < this->occupied_ && Cl::tile_min * this->occupied_ <= n) {
+    this->tile(n, scope, ascope, w, h, cols, rows, lists, pn, pan);
+    return;
+  }
+  this->plot(n, w, h, cols, rows);
+  this->reserve(n, 1); // the buffers are needed even if no lists are written
+  try {
+    this->gather_args(scope, ascope, w, h, cols, rows, false);
+    // every count is written whole, so none needs zeroing
+    this->queue_.enqueueNDRangeKernel(this->kernel_gather_,
+                                      cl::NullRange, n, cl::NullRange,
+                                      nullptr, this->timed("particles_gather"));
+    this->queue_.enqueueReadBuffer(this->pn_, CL_FALSE, 0, uint_size,
+                                   pn.data(), nullptr, this->timed("read pn"));
+    this->queue_.enqueueReadBuffer(this->pan_, CL_FALSE, 0, uint_size,
+                                   pan.data(),
+                                   nullptr, this->timed("read pan"));
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+  if (lists) {
+    this->list(n, scope, ascope, w, h, cols, rows);
+  }
+}
 
-  this->prep_seek();
-  //this->prep_naive_seek();
-  this->prep_move();
 
-  log.add(Attn::O,
-          "Started OpenCL module and found\n  device: " + name
-          + "\n  max compute units:\t" + std::to_string(this->max_cu_)
-          + "\n  max clock frequency:\t" + std::to_string(this->max_freq_)
-          + " MHz\n  max global memory:\t"
-          + std::to_string(this->max_gmem_ / 1024 / 1024) + " MB",
-          true);
+void
+Cl::gather_args(float scope, float ascope, unsigned int w, unsigned int h,
+                int cols, int rows, bool lists)
+{
+  this->kernel_gather_.setArg( 0, static_cast<cl_float>(scope));
+  this->kernel_gather_.setArg( 1, static_cast<cl_float>(ascope));
+  this->kernel_gather_.setArg( 2, static_cast<cl_float>(w));
+  this->kernel_gather_.setArg( 3, static_cast<cl_float>(h));
+  this->kernel_gather_.setArg( 4, static_cast<cl_int>(cols));
+  this->kernel_gather_.setArg( 5, static_cast<cl_int>(rows));
+  this->kernel_gather_.setArg( 6, static_cast<cl_int>(lists));
+  this->kernel_gather_.setArg( 7, this->gstart_);
+  this->kernel_gather_.setArg( 8, this->grid_);
+  this->kernel_gather_.setArg( 9, this->gcol_);
+  this->kernel_gather_.setArg(10, this->grow_);
+  this->kernel_gather_.setArg(11, this->px_);
+  this->kernel_gather_.setArg(12, this->py_);
+  this->kernel_gather_.setArg(13, this->pc_);
+  this->kernel_gather_.setArg(14, this->ps_);
+  this->kernel_gather_.setArg(15, this->pn_);
+  this->kernel_gather_.setArg(16, this->pan_);
+  this->kernel_gather_.setArg(17, this->pl_);
+  this->kernel_gather_.setArg(18, this->pr_);
+  this->kernel_gather_.setArg(19, this->plo_);
+  this->kernel_gather_.setArg(20, this->pro_);
+  this->kernel_gather_.setArg(21, this->pls_);
+  this->kernel_gather_.setArg(22, this->pld_);
+  this->kernel_gather_.setArg(23, this->prs_);
+  this->kernel_gather_.setArg(24, this->prd_);
 }
 
 
-
 void
-Cl::prep_seek()
+Cl::prep_tile()
 {
   std::string code =
-    "void inc(\n"
-    "  volatile __global int* n\n"
-    ") {\n"
-    "  atomic_inc(n);\n"
-    "}\n"
-    "\n"
-    "__kernel void particles_seek(\n"
-    "  __private float W,\n"
-    "  __private float H,\n"
+    "__kernel void particles_tile(\n"
     "  __private float SCOPE,\n"
     "  __private float ASCOPE,\n"
+    "  __private float W,\n"
+    "  __private float H,\n"
     "  __private int COLS,\n"
     "  __private int ROWS,\n"
-    "  __private unsigned int GSTRIDE,\n"
-    "  __global const int* G,\n"
-    "  __global const int* COL,\n"
-    "  __global const int* ROW,\n"
+    "  __global const int* GSTART,\n"
+    "  __global const int* GRID,\n"
     "  __global const float* PX,\n"
     "  __global const float* PY,\n"
     "  __global const float* PC,\n"
@@ -86,136 +1327,123 @@ Cl::prep_seek()
     "  __global unsigned int* PN,\n"
     "  __global unsigned int* PAN,\n"
     "  __global unsigned int* PL,\n"
-    "  __global unsigned int* PR\n"
+    "  __global unsigned int* PR,\n"
+    "  __private int TILE,\n"
+    "  __local int* TI,\n"
+    "  __local float* TX,\n"
+    "  __local float* TY\n"
     ") {\n"
-    "  int srci = get_global_id(0);\n"
-    "  int cc  = COL[srci];\n"
-    "  int rr  = ROW[srci];\n"
-    "  int c   = cc - 1;\n"
-    "  int ccc = cc + 1;\n"
-    "  int r   = rr - 1;\n"
-    "  int rrr = rr + 1;\n"
-    "  bool c_u = false;\n"
-    "  bool c_o = false;\n"
-    "  bool r_u = false;\n"
-    "  bool r_o = false;\n"
-    "  if      (cc == 0)        { c_u = true; c = COLS - 1; }\n"
-    "  else if (cc == COLS - 1) { c_o = true; ccc = 0; }\n"
-    "  if      (rr == 0)        { r_u = true; r = ROWS - 1; }\n"
-    "  else if (rr == ROWS - 1) { r_o = true; rrr = 0; }\n"
-    "  int vic[54] = {c,   r,   c_u,   false, r_u,   false,\n"
-    "                 cc,  r,   false, false, r_u,   false,\n"
-    "                 ccc, r,   false, c_o,   r_u,   false,\n"
-    "                 c,   rr,  c_u,   false, false, false,\n"
-    "                 cc,  rr,  false, false, false, false,\n"
-    "                 ccc, rr,  false, c_o,   false, false,\n"
-    "                 c,   rrr, c_u,   false, false, r_o,\n"
-    "                 cc,  rrr, false, false, false, r_o,\n"
-    "                 ccc, rrr, false, c_o,   false, r_o};\n"
-    "  unsigned int stride;\n"
+    "  int unit = get_group_id(0);\n"
+    "  int l = get_local_id(0);\n"
+    "  int size = get_local_size(0);\n"
+    "  int col = unit % COLS;\n"
+    "  int row = unit / COLS;\n"
+    "  int first = GSTART[unit];\n"
+    "  int count = GSTART[unit + 1] - first;\n"
+    // the nine grid units around and including this one, in the order of
+    // particles_gather, laid end to end: entry k is particle
+    // GRID[from[v] + k] for the first v with k < to[v]
+    "  int from[9];\n"
+    "  int to[9];\n"
+    "  float offx[9];\n"
+    "  float offy[9];\n"
+    "  int total = 0;\n"
+    "  int c;\n"
+    "  int r;\n"
+    "  int u;\n"
+    "  int v;\n"
+    "  int end;\n"
+    "  int srci;\n"
     "  int dsti;\n"
+    "  unsigned int n;\n"
+    "  unsigned int an;\n"
+    "  unsigned int ln;\n"
+    "  unsigned int rn;\n"
     "  float srcx;\n"
     "  float srcy;\n"
-    "  float dstx;\n"
-    "  float dsty;\n"
+    "  float srcc;\n"
+    "  float srcs;\n"
     "  float dx;\n"
     "  float dy;\n"
     "  float dist;\n"
-    "  float srcc;\n"
-    "  float srcs;\n"
-    "  float dstc;\n"
-    "  float dsts;\n"
-    "  for (int v = 0; v < 54; v += 6) {\n"
-    "    stride = (COLS * (vic[v + 1] * GSTRIDE)) + (vic[v] * GSTRIDE);\n"
-    "    c_u = vic[v + 2];\n"
-    "    c_o = vic[v + 3];\n"
-    "    r_u = vic[v + 4];\n"
-    "    r_o = vic[v + 5];\n"
-    "    for (int p = 0; p < GSTRIDE; ++p) {\n"
-    "      dsti = G[stride + p];\n"
-    "      if (dsti == -1) {\n"
-    "        break;\n"
-    "      }\n"
-    "      if (srci <= dsti) {\n"
-    "        continue;\n"
-    "      }\n"
+    "  for (v = 0; v < 9; ++v) {\n"
+    "    c = col + (v % 3) - 1;\n"
+    "    r = row + (v / 3) - 1;\n"
+    "    offx[v] = 0 > c ? -W : COLS <= c ? W : 0.0f;\n"
+    "    offy[v] = 0 > r ? -H : ROWS <= r ? H : 0.0f;\n"
+    "    c = 0 > c ? COLS - 1 : COLS <= c ? 0 : c;\n"
+    "    r = 0 > r ? ROWS - 1 : ROWS <= r ? 0 : r;\n"
+    "    u = (COLS * r) + c;\n"
+    "    from[v] = GSTART[u] - total;\n"
+    "    total += GSTART[u + 1] - GSTART[u];\n"
+    "    to[v] = total;\n"
+    "  }\n"
+    // every work-item goes through the same loops, for the barriers
+    "  for (int base = 0; base < count; base += size) {\n"
+    "    srci = base + l < count ? GRID[first + base + l] : -1;\n"
+    "    n = 0;\n"
+    "    an = 0;\n"
+    "    ln = 0;\n"
+    "    rn = 0;\n"
+    "    if (0 <= srci) {\n"
     "      srcx = PX[srci];\n"
-    "      dstx = PX[dsti];\n"
-    "      dx = dstx - srcx;\n"
-    "      if (c_u) { dx -= W; } else if (c_o) { dx += W; }\n"
     "      srcy = PY[srci];\n"
-    "      dsty = PY[dsti];\n"
-    "      dy = dsty - srcy;\n"
-    "      if (r_u) { dy -= H; } else if (r_o) { dy += H; }\n"
-    "      dist = (dx * dx) + (dy * dy);\n"
-    "      if (SCOPE < dist) {\n"
-    "        continue;\n"
-    "      }\n"
-    "      if (ASCOPE >= dist) {\n"
-    "        inc(&PAN[srci]);\n"
-    "        inc(&PAN[dsti]);\n"
-    "      }\n"
-    "      inc(&PN[srci]);\n"
-    "      inc(&PN[dsti]);\n"
     "      srcc = PC[srci];\n"
     "      srcs = PS[srci];\n"
-    "      dstc = PC[dsti];\n"
-    "      dsts = PS[dsti];\n"
-    "      if (0.0f > (dx * srcs) - (dy * srcc)) { inc(&PR[srci]); }\n"
-    "      else                                  { inc(&PL[srci]); }\n"
-    "      if (0.0f < (dx * dsts) - (dy * dstc)) { inc(&PR[dsti]); }\n"
-    "      else                                  { inc(&PL[dsti]); }\n"
-    /**
-    // TODO: duplication and misses occur when modifying PLS/PRD/etc. in
-    //       parallel, so passing in alternative neighborhood scope instead.
-    "      dststride = NSTRIDE * dsti;\n"
-    "      srcl = PL[srci];\n"
-    "      srcr = PR[srci];\n"
-    "      dstl = PL[dsti];\n"
-    "      dstr = PR[dsti];\n"
-    "      srcli = srcstride + srcl;\n"
-    "      srcri = srcstride + srcr;\n"
-    "      dstli = dststride + dstl;\n"
-    "      dstri = dststride + dstr;\n"
-    "      if (0.0f > (dx * srcs) - (dy * srcc)) {\n"
-    "        if (NSTRIDE > srcr) {\n"
-    "          PRS[srcri] = dsti;\n"
-    "          PRD[srcri] = dist;\n"
+    "    }\n"
+    "    for (int t = 0; t < total; t += TILE) {\n"
+    "      end = min(t + TILE, total);\n"
+    "      v = 0;\n"
+    "      for (int k = t + l; k < end; k += size) {\n"
+    "        while (k >= to[v]) {\n"
+    "          ++v;\n"
     "        }\n"
-    "        inc(&PR[srci]);\n"
+    "        dsti = GRID[from[v] + k];\n"
+    "        TI[k - t] = dsti;\n"
+    "        TX[k - t] = PX[dsti];\n"
+    "        TY[k - t] = PY[dsti];\n"
     "      }\n"
-    "      else {\n"
-    "        if (NSTRIDE > srcl) {\n"
-    "          PLS[srcli] = dsti;\n"
-    "          PLD[srcli] = dist;\n"
+    "      barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "      v = 0;\n"
+    "      for (int k = t; 0 <= srci && k < end; ++k) {\n"
+    "        while (k >= to[v]) {\n"
+    "          ++v;\n"
     "        }\n"
-    "        inc(&PL[srci]);\n"
-    "      }\n"
-    "      if (0.0f < (dx * dsts) - (dy * dstc)) {\n"
-    "        if (NSTRIDE > dstr) {\n"
-    "          PRS[dstri] = srci;\n"
-    "          PRD[dstri] = dist;\n"
+    "        dsti = TI[k - t];\n"
+    "        if (srci == dsti) {\n"
+    "          continue;\n"
     "        }\n"
-    "        inc(&PR[dsti]);\n"
-    "      }\n"
-    "      else {\n"
-    "        if (NSTRIDE > dstl) {\n"
-    "          PLS[dstli] = srci;\n"
-    "          PLD[dstli] = dist;\n"
+    "        dx = (TX[k - t] - srcx) + offx[v];\n"
+    "        dy = (TY[k - t] - srcy) + offy[v];\n"
+    "        dist = (dx * dx) + (dy * dy);\n"
+    "        if (SCOPE < dist) {\n"
+    "          continue;\n"
+    "        }\n"
+    "        an += ASCOPE >= dist;\n"
+    "        ++n;\n"
+    "        if (0.0f > (dx * srcs) - (dy * srcc)) {\n"
+    "          ++rn;\n"
+    "        } else {\n"
+    "          ++ln;\n"
     "        }\n"
-    "        inc(&PL[dsti]);\n"
     "      }\n"
-    //*/
+    "      barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "    }\n"
+    "    if (0 <= srci) {\n"
+    "      PN[srci] = n;\n"
+    "      PAN[srci] = an;\n"
+    "      PL[srci] = ln;\n"
+    "      PR[srci] = rn;\n"
     "    }\n"
     "  }\n"
     "}\n";
 
   Log& log = this->log_;
   try {
-    std::string name = "particles_seek";
-    cl::Program program(this->context_, code, CL_TRUE);
+    std::string name = "particles_tile";
+    cl::Program program = this->build(code);
     int compile_err;
-    this->kernel_seek_ = cl::Kernel(program, name.c_str(), &compile_err);
+    this->kernel_tile_ = cl::Kernel(program, name.c_str(), &compile_err);
     if (compile_err) {
       log.add(Attn::Ecl, std::to_string(compile_err) + ": failed to compile '"
               + name + "'.");
@@ -227,80 +1455,170 @@ Cl::prep_seek()
 
 
 void
-Cl::seek(unsigned int n, unsigned int w, unsigned int h,
-         float scope, float ascope, int cols, int rows,
-         unsigned int grid_stride, std::vector<int>& grid,
-         std::vector<int>& gcol, std::vector<int>& grow,
-         std::vector<float>& px, std::vector<float>& py,
-         std::vector<float>& pc, std::vector<float>& ps,
-         std::vector<unsigned int>& pn, std::vector<unsigned int>& pan,
-         std::vector<unsigned int>& pl, std::vector<unsigned int>& pr)
+Cl::tile(unsigned int n, float scope, float ascope,
+         unsigned int w, unsigned int h, int cols, int rows,
+         bool lists,
+         std::vector<unsigned int>& pn, std::vector<unsigned int>& pan)
 {
-  const cl_uint float_size = n * sizeof(float);
-  const cl_uint int_size = n * sizeof(int);
   const cl_uint uint_size = n * sizeof(unsigned int);
+  const size_t group = Cl::tile_group < this->max_wg_ ? Cl::tile_group
+                                                       : this->max_wg_;
+  this->plot(n, w, h, cols, rows);
+  this->reserve(n, 1); // the buffers are needed even if no lists are written
   try {
-    cl::Buffer G(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                 cols * rows * grid_stride * sizeof(int), grid.data());
-    cl::Buffer COL(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                   int_size, gcol.data());
-    cl::Buffer ROW(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                   int_size, grow.data());
-    cl::Buffer PX(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, px.data());
-    cl::Buffer PY(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, py.data());
-    cl::Buffer PC(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, pc.data());
-    cl::Buffer PS(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, ps.data());
-    cl::Buffer PN(this->context_, CL_MEM_READ_WRITE, uint_size);
-    cl::Buffer PAN(this->context_, CL_MEM_READ_WRITE, uint_size);
-    cl::Buffer PL(this->context_, CL_MEM_READ_WRITE, uint_size);
-    cl::Buffer PR(this->context_, CL_MEM_READ_WRITE, uint_size);
-    this->kernel_seek_.setArg( 0, static_cast<cl_float>(w));
-    this->kernel_seek_.setArg( 1, static_cast<cl_float>(h));
-    this->kernel_seek_.setArg( 2, static_cast<cl_float>(scope));
-    this->kernel_seek_.setArg( 3, static_cast<cl_float>(ascope));
-    this->kernel_seek_.setArg( 4, static_cast<cl_int>(cols));
-    this->kernel_seek_.setArg( 5, static_cast<cl_int>(rows));
-    this->kernel_seek_.setArg( 6, static_cast<cl_int>(grid_stride));
-    this->kernel_seek_.setArg( 7, G);
-    this->kernel_seek_.setArg( 8, COL);
-    this->kernel_seek_.setArg( 9, ROW);
-    this->kernel_seek_.setArg(10, PX);
-    this->kernel_seek_.setArg(11, PY);
-    this->kernel_seek_.setArg(12, PC);
-    this->kernel_seek_.setArg(13, PS);
-    this->kernel_seek_.setArg(14, PN);
-    this->kernel_seek_.setArg(15, PAN);
-    this->kernel_seek_.setArg(16, PL);
-    this->kernel_seek_.setArg(17, PR);
-    this->queue_.enqueueWriteBuffer(PN, CL_TRUE, 0, uint_size, pn.data());
-    this->queue_.enqueueWriteBuffer(PAN, CL_TRUE, 0, uint_size, pan.data());
-    this->queue_.enqueueWriteBuffer(PL, CL_TRUE, 0, uint_size, pl.data());
-    this->queue_.enqueueWriteBuffer(PR, CL_TRUE, 0, uint_size, pr.data());
-    /**
-    // profiling
-    cl::Event event;
-    this->queue_.enqueueNDRangeKernel(this->kernel_seek_,
-                                      cl::NullRange, n, cl::NullRange, NULL,
-                                      &event);
-    event.wait();
-    //*/
-    this->queue_.enqueueNDRangeKernel(this->kernel_seek_,
-                                      cl::NullRange, n, cl::NullRange);
-    this->queue_.enqueueReadBuffer(PN, CL_TRUE, 0, uint_size, pn.data());
-    this->queue_.enqueueReadBuffer(PAN, CL_TRUE, 0, uint_size, pan.data());
-    this->queue_.enqueueReadBuffer(PL, CL_TRUE, 0, uint_size, pl.data());
-    this->queue_.enqueueReadBuffer(PR, CL_TRUE, 0, uint_size, pr.data());
+    this->kernel_tile_.setArg( 0, static_cast<cl_float>(scope));
+    this->kernel_tile_.setArg( 1, static_cast<cl_float>(ascope));
+    this->kernel_tile_.setArg( 2, static_cast<cl_float>(w));
+    this->kernel_tile_.setArg( 3, static_cast<cl_float>(h));
+    this->kernel_tile_.setArg( 4, static_cast<cl_int>(cols));
+    this->kernel_tile_.setArg( 5, static_cast<cl_int>(rows));
+    this->kernel_tile_.setArg( 6, this->gstart_);
+    this->kernel_tile_.setArg( 7, this->grid_);
+    this->kernel_tile_.setArg( 8, this->px_);
+    this->kernel_tile_.setArg( 9, this->py_);
+    this->kernel_tile_.setArg(10, this->pc_);
+    this->kernel_tile_.setArg(11, this->ps_);
+    this->kernel_tile_.setArg(12, this->pn_);
+    this->kernel_tile_.setArg(13, this->pan_);
+    this->kernel_tile_.setArg(14, this->pl_);
+    this->kernel_tile_.setArg(15, this->pr_);
+    this->kernel_tile_.setArg(16, static_cast<cl_int>(Cl::tile_size));
+    this->kernel_tile_.setArg(17, cl::Local(Cl::tile_size * sizeof(cl_int)));
+    this->kernel_tile_.setArg(18,
+                              cl::Local(Cl::tile_size * sizeof(cl_float)));
+    this->kernel_tile_.setArg(19,
+                              cl::Local(Cl::tile_size * sizeof(cl_float)));
+    // a work-group for each grid unit, every particle of which is written
+    this->queue_.enqueueNDRangeKernel(this->kernel_tile_, cl::NullRange,
+                                      cols * rows * group, group,
+                                      nullptr, this->timed("particles_tile"));
+    this->queue_.enqueueReadBuffer(this->pn_, CL_FALSE, 0, uint_size,
+                                   pn.data(), nullptr, this->timed("read pn"));
+    this->queue_.enqueueReadBuffer(this->pan_, CL_FALSE, 0, uint_size,
+                                   pan.data(),
+                                   nullptr, this->timed("read pan"));
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+  if (lists) {
+    this->list(n, scope, ascope, w, h, cols, rows);
+  }
+}
+
+
+void
+Cl::list(unsigned int n, float scope, float ascope,
+         unsigned int w, unsigned int h, int cols, int rows)
+{
+  const size_t scan_size = 256 < this->max_wg_ ? 256 : this->max_wg_;
+  cl_uint lslots;
+  cl_uint rslots;
+  try {
+    // the offsets of the lists are scanned from L and R as those of the grid
+    // units are from their counts, see plot()
+    this->kernel_scan_.setArg(0, static_cast<cl_int>(n));
+    this->kernel_scan_.setArg(1, this->pl_);
+    this->kernel_scan_.setArg(2, this->plo_);
+    this->kernel_scan_.setArg(3, this->lused_);
+    this->kernel_scan_.setArg(4, cl::Local(scan_size * sizeof(cl_int)));
+    this->queue_.enqueueNDRangeKernel(this->kernel_scan_, cl::NullRange,
+                                      scan_size, scan_size,
+                                      nullptr, this->timed("scan pl"));
+    this->kernel_scan_.setArg(1, this->pr_);
+    this->kernel_scan_.setArg(2, this->pro_);
+    this->queue_.enqueueNDRangeKernel(this->kernel_scan_, cl::NullRange,
+                                      scan_size, scan_size,
+                                      nullptr, this->timed("scan pr"));
+    // the buffers are sized by the totals, for which this waits
+    this->queue_.enqueueReadBuffer(this->plo_, CL_FALSE,
+                                   n * sizeof(cl_uint), sizeof(cl_uint),
+                                   &lslots, nullptr, this->timed("read plo"));
+    this->queue_.enqueueReadBuffer(this->pro_, CL_FALSE,
+                                   n * sizeof(cl_uint), sizeof(cl_uint),
+                                   &rslots, nullptr, this->timed("read pro"));
+    this->queue_.finish();
+    this->reserve(n, lslots < rslots ? rslots : lslots);
+    this->gather_args(scope, ascope, w, h, cols, rows, true);
+    this->queue_.enqueueNDRangeKernel(this->kernel_gather_,
+                                      cl::NullRange, n, cl::NullRange,
+                                      nullptr, this->timed("particles_list"));
+    this->listed_ = true;
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::reserve(unsigned int n, size_t slots)
+{
+  cl::Context& context = this->context_;
+  try {
+    if (this->offsets_capacity_ < n + 1) {
+      this->plo_ = cl::Buffer(context, CL_MEM_READ_WRITE,
+                              (n + 1) * sizeof(cl_uint));
+      this->pro_ = cl::Buffer(context, CL_MEM_READ_WRITE,
+                              (n + 1) * sizeof(cl_uint));
+      this->lused_ = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_int));
+      this->offsets_capacity_ = n + 1;
+    }
+    if (this->lists_capacity_ < slots) {
+      this->pls_ = cl::Buffer(context, CL_MEM_WRITE_ONLY, slots * sizeof(int));
+      this->pld_ = cl::Buffer(context, CL_MEM_WRITE_ONLY,
+                              slots * sizeof(float));
+      this->prs_ = cl::Buffer(context, CL_MEM_WRITE_ONLY, slots * sizeof(int));
+      this->prd_ = cl::Buffer(context, CL_MEM_WRITE_ONLY,
+                              slots * sizeof(float));
+      this->lists_capacity_ = slots;
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+  this->listed_ = false;
+}
+
+
+void
+Cl::lists(unsigned int n,
+          std::vector<int>& pls, std::vector<float>& pld,
+          std::vector<int>& prs, std::vector<float>& prd,
+          std::vector<unsigned int>& plo, std::vector<unsigned int>& pro)
+{
+  if (!this->listed_) {
+    return;
+  }
+  plo.resize(n + 1);
+  pro.resize(n + 1);
+  try {
+    this->queue_.enqueueReadBuffer(this->plo_, CL_TRUE, 0,
+                                   plo.size() * sizeof(unsigned int),
+                                   plo.data(),
+                                   nullptr, this->timed("read plo"));
+    this->queue_.enqueueReadBuffer(this->pro_, CL_TRUE, 0,
+                                   pro.size() * sizeof(unsigned int),
+                                   pro.data(),
+                                   nullptr, this->timed("read pro"));
+    pls.resize(plo[n]);
+    pld.resize(plo[n]);
+    prs.resize(pro[n]);
+    prd.resize(pro[n]);
+    if (0 < plo[n]) {
+      this->queue_.enqueueReadBuffer(this->pls_, CL_FALSE, 0,
+                                     pls.size() * sizeof(int), pls.data(),
+                                     nullptr, this->timed("read pls"));
+      this->queue_.enqueueReadBuffer(this->pld_, CL_FALSE, 0,
+                                     pld.size() * sizeof(float), pld.data(),
+                                     nullptr, this->timed("read pld"));
+    }
+    if (0 < pro[n]) {
+      this->queue_.enqueueReadBuffer(this->prs_, CL_FALSE, 0,
+                                     prs.size() * sizeof(int), prs.data(),
+                                     nullptr, this->timed("read prs"));
+      this->queue_.enqueueReadBuffer(this->prd_, CL_FALSE, 0,
+                                     prd.size() * sizeof(float), prd.data(),
+                                     nullptr, this->timed("read prd"));
+    }
     this->queue_.finish();
-    /**
-    // profiling
-    std::cout << event.getProfilingInfo<CL_PROFILING_COMMAND_END>() -
-                 event.getProfilingInfo<CL_PROFILING_COMMAND_START>()
-              << std::endl;
-    //*/
   } catch (cl_int err) {
     this->log_.add(Attn::Ecl, std::to_string(err));
   }
@@ -310,7 +1628,28 @@ Cl::seek(unsigned int n, unsigned int w, unsigned int h,
 void
 Cl::prep_move()
 {
+  // philox() is Rng::philox(), and the noise of each particle is that of
+  // its stable ID in Rng::normal()
   std::string code =
+    "void philox(\n"
+    "  unsigned int* c,\n"
+    "  unsigned int k0,\n"
+    "  unsigned int k1\n"
+    ") {\n"
+    "  for (int round = 0; round < 10; ++round) {\n"
+    "    unsigned int hi0 = mul_hi(0xD2511F53u, c[0]);\n"
+    "    unsigned int hi1 = mul_hi(0xCD9E8D57u, c[2]);\n"
+    "    unsigned int lo0 = 0xD2511F53u * c[0];\n"
+    "    unsigned int lo1 = 0xCD9E8D57u * c[2];\n"
+    "    c[0] = hi1 ^ c[1] ^ k0;\n"
+    "    c[2] = hi0 ^ c[3] ^ k1;\n"
+    "    c[1] = lo1;\n"
+    "    c[3] = lo0;\n"
+    "    k0 += 0x9E3779B9u;\n"
+    "    k1 += 0xBB67AE85u;\n"
+    "  }\n"
+    "}\n"
+    "\n"
     "__kernel void particles_move(\n"
     "  __private float TAU,\n"
     "  __private float W,\n"
@@ -319,6 +1658,13 @@ Cl::prep_move()
     "  __private float B,\n"
     "  __private float S,\n"
     "  __private float E,\n"
+    "  __private float D,\n"
+    "  __private unsigned int K0,\n"
+    "  __private unsigned int K1,\n"
+    "  __private unsigned int RS,\n"
+    "  __private unsigned int T0,\n"
+    "  __private unsigned int T1,\n"
+    "  __global const unsigned int* PI,\n"
     "  __global const unsigned int* PN,\n"
     "  __global const unsigned int* PL,\n"
     "  __global const unsigned int* PR,\n"
@@ -326,11 +1672,23 @@ Cl::prep_move()
     "  __global float* PY,\n"
     "  __global float* PF,\n"
     "  __global float* PC,\n"
-    "  __global float* PS\n"
+    "  __global float* PS,\n"
+    "  __global float* XYZ,\n"
+    "  __private int SHARE\n"
     ") {\n"
     "  int i = get_global_id(0);\n"
     "  int signum = (0 < (int)(PR[i] - PL[i])) - ((int)(PR[i] - PL[i]) < 0);\n"
-    "  float f = fmod(PF[i] + A + (B * PN[i] * (float)signum) + E, TAU);\n"
+    "  float e = E;\n"
+    "  if (0.0f != D) {\n"
+    "    unsigned int c[4] = {PI[i] >> 2, RS, T0, T1};\n"
+    "    unsigned int q = PI[i] & 2;\n"
+    "    philox(c, K0, K1);\n"
+    "    float u = 1.0f - (float)(c[q] >> 8) * (1.0f / 16777216.0f);\n"
+    "    float v = (float)(c[q + 1] >> 8) * (1.0f / 16777216.0f);\n"
+    "    float r = sqrt(-2.0f * log(u));\n"
+    "    e = D * ((PI[i] & 1) ? r * sin(TAU * v) : r * cos(TAU * v));\n"
+    "  }\n"
+    "  float f = fmod(PF[i] + A + (B * PN[i] * (float)signum) + e, TAU);\n"
     "  if (f < 0) { f += TAU; }\n"
     "  PF[i] = f;\n"
     "  PC[i] = native_cos(f);\n"
@@ -341,12 +1699,16 @@ Cl::prep_move()
     "  float y = fmod(PY[i] + (S * PS[i]), H);\n"
     "  if (y < 0.0f) { y += H; }\n"
     "  PY[i] = y;\n"
+    "  if (SHARE) {\n"
+    "    XYZ[3 * i] = x;\n"
+    "    XYZ[(3 * i) + 1] = y;\n"
+    "  }\n"
     "}\n";
 
   Log& log = this->log_;
   try {
     std::string name = "particles_move";
-    cl::Program program(this->context_, code, CL_TRUE);
+    cl::Program program = this->build(code);
     int compile_err;
     this->kernel_move_ = cl::Kernel(program, name.c_str(), &compile_err);
     if (compile_err) {
@@ -361,27 +1723,15 @@ Cl::prep_move()
 
 void
 Cl::move(unsigned int n, unsigned int w, unsigned int h,
-         float a, float b, float s, float e,
-         std::vector<unsigned int>& pn,
-         std::vector<unsigned int>& pl, std::vector<unsigned int>& pr,
+         float a, float b, float s, float e, float d,
+         unsigned long long tick,
          std::vector<float>& px, std::vector<float>& py,
-         std::vector<float>& pf,
-         std::vector<float>& pc, std::vector<float>& ps)
+         cl::Event* done /* = nullptr */)
 {
   const cl_uint float_size = n * sizeof(float);
-  const cl_uint uint_size = n * sizeof(unsigned int);
+  const unsigned int* key = Rng::key();
+  const std::vector<cl::Memory> shared = {this->xyz_};
   try {
-    cl::Buffer PN(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  uint_size, pn.data());
-    cl::Buffer PL(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  uint_size, pl.data());
-    cl::Buffer PR(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  uint_size, pr.data());
-    cl::Buffer PX(this->context_, CL_MEM_READ_WRITE, float_size);
-    cl::Buffer PY(this->context_, CL_MEM_READ_WRITE, float_size);
-    cl::Buffer PF(this->context_, CL_MEM_READ_WRITE, float_size);
-    cl::Buffer PC(this->context_, CL_MEM_READ_WRITE, float_size);
-    cl::Buffer PS(this->context_, CL_MEM_READ_WRITE, float_size);
     this->kernel_move_.setArg( 0, TAU);
     this->kernel_move_.setArg( 1, static_cast<cl_float>(w));
     this->kernel_move_.setArg( 2, static_cast<cl_float>(h));
@@ -389,41 +1739,362 @@ Cl::move(unsigned int n, unsigned int w, unsigned int h,
     this->kernel_move_.setArg( 4, static_cast<cl_float>(b));
     this->kernel_move_.setArg( 5, static_cast<cl_float>(s));
     this->kernel_move_.setArg( 6, static_cast<cl_float>(e));
-    this->kernel_move_.setArg( 7, PN);
-    this->kernel_move_.setArg( 8, PL);
-    this->kernel_move_.setArg( 9, PR);
-    this->kernel_move_.setArg(10, PX);
-    this->kernel_move_.setArg(11, PY);
-    this->kernel_move_.setArg(12, PF);
-    this->kernel_move_.setArg(13, PC);
-    this->kernel_move_.setArg(14, PS);
-    this->queue_.enqueueWriteBuffer(PX, CL_TRUE, 0, float_size, px.data());
-    this->queue_.enqueueWriteBuffer(PY, CL_TRUE, 0, float_size, py.data());
-    this->queue_.enqueueWriteBuffer(PF, CL_TRUE, 0, float_size, pf.data());
-    this->queue_.enqueueWriteBuffer(PC, CL_TRUE, 0, float_size, pc.data());
-    this->queue_.enqueueWriteBuffer(PS, CL_TRUE, 0, float_size, ps.data());
-    /**
-    // profiling
-    cl::Event event;
-    this->queue_.enqueueNDRangeKernel(this->kernel_move_,
-                                      cl::NullRange, n, cl::NullRange, NULL,
-                                      &event);
-    event.wait();
-    //*/
+    this->kernel_move_.setArg( 7, static_cast<cl_float>(d));
+    this->kernel_move_.setArg( 8, static_cast<cl_uint>(key[0]));
+    this->kernel_move_.setArg( 9, static_cast<cl_uint>(key[1]));
+    this->kernel_move_.setArg(10, static_cast<cl_uint>(RngStream::Noise));
+    this->kernel_move_.setArg(11, static_cast<cl_uint>(tick));
+    this->kernel_move_.setArg(12, static_cast<cl_uint>(tick >> 32));
+    this->kernel_move_.setArg(13, this->pid_);
+    this->kernel_move_.setArg(14, this->pn_);
+    this->kernel_move_.setArg(15, this->pl_);
+    this->kernel_move_.setArg(16, this->pr_);
+    this->kernel_move_.setArg(17, this->px_);
+    this->kernel_move_.setArg(18, this->py_);
+    this->kernel_move_.setArg(19, this->pf_);
+    this->kernel_move_.setArg(20, this->pc_);
+    this->kernel_move_.setArg(21, this->ps_);
+    if (this->shared_) {
+      this->kernel_move_.setArg(22, this->xyz_);
+    } else {
+      this->kernel_move_.setArg(22, this->px_); // never written
+    }
+    this->kernel_move_.setArg(23, static_cast<cl_int>(this->shared_));
+    if (this->shared_) {
+      // OpenGL must be done drawing from the vertex buffer
+      glFinish();
+      this->queue_.enqueueAcquireGLObjects(&shared);
+    }
     this->queue_.enqueueNDRangeKernel(this->kernel_move_,
-                                      cl::NullRange, n, cl::NullRange);
-    this->queue_.enqueueReadBuffer(PX, CL_TRUE, 0, float_size, px.data());
-    this->queue_.enqueueReadBuffer(PY, CL_TRUE, 0, float_size, py.data());
-    this->queue_.enqueueReadBuffer(PF, CL_TRUE, 0, float_size, pf.data());
-    this->queue_.enqueueReadBuffer(PC, CL_TRUE, 0, float_size, pc.data());
-    this->queue_.enqueueReadBuffer(PS, CL_TRUE, 0, float_size, ps.data());
+                                      cl::NullRange, n, cl::NullRange,
+                                      nullptr, this->timed("particles_move"));
+    // PHI, cos(PHI) and sin(PHI) stay until pull(), and so do X and Y if
+    // shared
+    if (this->shared_) {
+      this->queue_.enqueueReleaseGLObjects(&shared, nullptr, done);
+    } else {
+      this->queue_.enqueueReadBuffer(this->px_, CL_FALSE, 0, float_size,
+                                     px.data(),
+                                     nullptr, this->timed("read px"));
+      this->queue_.enqueueReadBuffer(this->py_, CL_FALSE, 0, float_size,
+                                     py.data(), nullptr,
+                                     done ? done : this->timed("read py"));
+      if (done) {
+        this->timed("read py", *done);
+      }
+    }
+    if (this->shared_ || !done) {
+      this->queue_.finish();
+    } else {
+      this->queue_.flush();
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::prep_ensemble()
+{
+  const std::string floats = std::to_string(Cl::ensemble_floats);
+  const std::string uints = std::to_string(Cl::ensemble_uints);
+  const std::string tile = std::to_string(Cl::ensemble_tile);
+  // philox() and the noise are those of particles_move, and the wrapping
+  // of each pair that of particles_gather, but by the nearest image
+  std::string code =
+    "void philox(\n"
+    "  unsigned int* c,\n"
+    "  unsigned int k0,\n"
+    "  unsigned int k1\n"
+    ") {\n"
+    "  for (int round = 0; round < 10; ++round) {\n"
+    "    unsigned int hi0 = mul_hi(0xD2511F53u, c[0]);\n"
+    "    unsigned int hi1 = mul_hi(0xCD9E8D57u, c[2]);\n"
+    "    unsigned int lo0 = 0xD2511F53u * c[0];\n"
+    "    unsigned int lo1 = 0xCD9E8D57u * c[2];\n"
+    "    c[0] = hi1 ^ c[1] ^ k0;\n"
+    "    c[2] = hi0 ^ c[3] ^ k1;\n"
+    "    c[1] = lo1;\n"
+    "    c[3] = lo0;\n"
+    "    k0 += 0x9E3779B9u;\n"
+    "    k1 += 0xBB67AE85u;\n"
+    "  }\n"
+    "}\n"
+    "\n"
+    // a work-group per world, whose work-items take every size-th particle
+    // of it, all of them walking the world in tiles in step
+    "__kernel void particles_ensemble_seek(\n"
+    "  __global const int* WSTART,\n"
+    "  __global const float* WF,\n"
+    "  __global const float* PX,\n"
+    "  __global const float* PY,\n"
+    "  __global const float* PC,\n"
+    "  __global const float* PS,\n"
+    "  __global unsigned int* PN,\n"
+    "  __global unsigned int* PAN,\n"
+    "  __global unsigned int* PL,\n"
+    "  __global unsigned int* PR,\n"
+    "  __local float* TX,\n"
+    "  __local float* TY\n"
+    ") {\n"
+    "  int w = get_group_id(0);\n"
+    "  int l = get_local_id(0);\n"
+    "  int size = get_local_size(0);\n"
+    "  int start = WSTART[w];\n"
+    "  int count = WSTART[w + 1] - start;\n"
+    "  float W = WF[(" + floats + " * w)];\n"
+    "  float H = WF[(" + floats + " * w) + 1];\n"
+    "  float SCOPE = WF[(" + floats + " * w) + 2];\n"
+    "  float ASCOPE = WF[(" + floats + " * w) + 3];\n"
+    "  int i;\n"
+    "  int tile;\n"
+    "  bool own;\n"
+    "  unsigned int n;\n"
+    "  unsigned int an;\n"
+    "  unsigned int ln;\n"
+    "  unsigned int rn;\n"
+    "  float srcx = 0.0f;\n"
+    "  float srcy = 0.0f;\n"
+    "  float srcc = 0.0f;\n"
+    "  float srcs = 0.0f;\n"
+    "  float dx;\n"
+    "  float dy;\n"
+    "  float dist;\n"
+    "  for (int base = 0; base < count; base += size) {\n"
+    "    i = base + l;\n"
+    "    own = i < count;\n"
+    "    n = 0;\n"
+    "    an = 0;\n"
+    "    ln = 0;\n"
+    "    rn = 0;\n"
+    "    if (own) {\n"
+    "      srcx = PX[start + i];\n"
+    "      srcy = PY[start + i];\n"
+    "      srcc = PC[start + i];\n"
+    "      srcs = PS[start + i];\n"
+    "    }\n"
+    "    for (int t = 0; t < count; t += " + tile + ") {\n"
+    "      tile = min(" + tile + ", count - t);\n"
+    "      barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "      for (int k = l; k < tile; k += size) {\n"
+    "        TX[k] = PX[start + t + k];\n"
+    "        TY[k] = PY[start + t + k];\n"
+    "      }\n"
+    "      barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "      for (int k = 0; own && k < tile; ++k) {\n"
+    "        if (t + k == i) {\n"
+    "          continue;\n"
+    "        }\n"
+    "        dx = TX[k] - srcx;\n"
+    "        dy = TY[k] - srcy;\n"
+    "        dx += 0.5f * W < dx ? -W : -0.5f * W > dx ? W : 0.0f;\n"
+    "        dy += 0.5f * H < dy ? -H : -0.5f * H > dy ? H : 0.0f;\n"
+    "        dist = (dx * dx) + (dy * dy);\n"
+    "        if (SCOPE < dist) {\n"
+    "          continue;\n"
+    "        }\n"
+    "        an += ASCOPE >= dist;\n"
+    "        ++n;\n"
+    "        if (0.0f > (dx * srcs) - (dy * srcc)) {\n"
+    "          ++rn;\n"
+    "        } else {\n"
+    "          ++ln;\n"
+    "        }\n"
+    "      }\n"
+    "    }\n"
+    "    if (own) {\n"
+    "      PN[start + i] = n;\n"
+    "      PAN[start + i] = an;\n"
+    "      PL[start + i] = ln;\n"
+    "      PR[start + i] = rn;\n"
+    "    }\n"
+    "  }\n"
+    "}\n"
+    "\n"
+    "__kernel void particles_ensemble_move(\n"
+    "  __private float TAU,\n"
+    "  __private unsigned int K0,\n"
+    "  __private unsigned int K1,\n"
+    "  __global const float* WF,\n"
+    "  __global const unsigned int* WU,\n"
+    "  __global const unsigned int* PW,\n"
+    "  __global const unsigned int* PI,\n"
+    "  __global const unsigned int* PN,\n"
+    "  __global const unsigned int* PL,\n"
+    "  __global const unsigned int* PR,\n"
+    "  __global float* PX,\n"
+    "  __global float* PY,\n"
+    "  __global float* PF,\n"
+    "  __global float* PC,\n"
+    "  __global float* PS\n"
+    ") {\n"
+    "  int i = get_global_id(0);\n"
+    "  __global const float* wf = WF + (" + floats + " * PW[i]);\n"
+    "  __global const unsigned int* wu = WU + (" + uints + " * PW[i]);\n"
+    "  float W = wf[0];\n"
+    "  float H = wf[1];\n"
+    "  float A = wf[4];\n"
+    "  float B = wf[5];\n"
+    "  float S = wf[6];\n"
+    "  float D = wf[8];\n"
+    "  int signum = (0 < (int)(PR[i] - PL[i])) - ((int)(PR[i] - PL[i]) < 0);\n"
+    "  float e = wf[7];\n"
+    "  if (0.0f != D) {\n"
+    "    unsigned int c[4] = {PI[i] >> 2, wu[0], wu[1], wu[2]};\n"
+    "    unsigned int q = PI[i] & 2;\n"
+    "    philox(c, K0, K1);\n"
+    "    float u = 1.0f - (float)(c[q] >> 8) * (1.0f / 16777216.0f);\n"
+    "    float v = (float)(c[q + 1] >> 8) * (1.0f / 16777216.0f);\n"
+    "    float r = sqrt(-2.0f * log(u));\n"
+    "    e = D * ((PI[i] & 1) ? r * sin(TAU * v) : r * cos(TAU * v));\n"
+    "  }\n"
+    "  float f = fmod(PF[i] + A + (B * PN[i] * (float)signum) + e, TAU);\n"
+    "  if (f < 0) { f += TAU; }\n"
+    "  PF[i] = f;\n"
+    "  PC[i] = native_cos(f);\n"
+    "  PS[i] = native_sin(f);\n"
+    "  float x = fmod(PX[i] + (S * PC[i]), W);\n"
+    "  if (x < 0.0f) { x += W; }\n"
+    "  PX[i] = x;\n"
+    "  float y = fmod(PY[i] + (S * PS[i]), H);\n"
+    "  if (y < 0.0f) { y += H; }\n"
+    "  PY[i] = y;\n"
+    "}\n";
+
+  Log& log = this->log_;
+  try {
+    std::string seek_name = "particles_ensemble_seek";
+    std::string move_name = "particles_ensemble_move";
+    cl::Program program = this->build(code);
+    int compile_err;
+    this->kernel_ensemble_seek_ = cl::Kernel(program, seek_name.c_str(),
+                                             &compile_err);
+    if (compile_err) {
+      log.add(Attn::Ecl, std::to_string(compile_err) + ": failed to compile '"
+              + seek_name + "'.");
+    }
+    this->kernel_ensemble_move_ = cl::Kernel(program, move_name.c_str(),
+                                             &compile_err);
+    if (compile_err) {
+      log.add(Attn::Ecl, std::to_string(compile_err) + ": failed to compile '"
+              + move_name + "'.");
+    }
+  } catch (cl_int err) {
+    this->log_.add(Attn::Ecl, std::to_string(err));
+  }
+}
+
+
+void
+Cl::ensemble(unsigned int worlds, std::vector<int>& wstart,
+             std::vector<float>& wf, std::vector<unsigned int>& wu,
+             std::vector<unsigned int>& pw,
+             std::vector<unsigned int>& pid,
+             std::vector<float>& px, std::vector<float>& py,
+             std::vector<float>& pf,
+             std::vector<float>& pc, std::vector<float>& ps,
+             std::vector<unsigned int>& pn,
+             std::vector<unsigned int>& pan,
+             std::vector<unsigned int>& pl,
+             std::vector<unsigned int>& pr)
+{
+  const unsigned int n = wstart[worlds];
+  const cl_uint float_size = n * sizeof(float);
+  const cl_uint uint_size = n * sizeof(unsigned int);
+  const size_t group = Cl::ensemble_group < this->max_wg_
+                       ? Cl::ensemble_group : this->max_wg_;
+  const size_t tile_size = Cl::ensemble_tile * sizeof(cl_float);
+  const unsigned int* key = Rng::key();
+  cl::Context& context = this->context_;
+
+  if (0 == n) {
+    return;
+  }
+  this->push(n, pid, px, py, pf, pc, ps);
+  try {
+    if (this->worlds_capacity_ < worlds) {
+      this->wstart_ = cl::Buffer(context, CL_MEM_READ_ONLY,
+                                 (worlds + 1) * sizeof(int));
+      this->wf_ = cl::Buffer(context, CL_MEM_READ_ONLY,
+                             Cl::ensemble_floats * worlds * sizeof(float));
+      this->wu_ = cl::Buffer(context, CL_MEM_READ_ONLY,
+                             Cl::ensemble_uints * worlds
+                             * sizeof(unsigned int));
+      this->worlds_capacity_ = worlds;
+    }
+    if (this->ensemble_capacity_ < n) {
+      this->pw_ = cl::Buffer(context, CL_MEM_READ_ONLY, uint_size);
+      this->ensemble_capacity_ = n;
+    }
+    this->queue_.enqueueWriteBuffer(this->wstart_, CL_FALSE, 0,
+                                    (worlds + 1) * sizeof(int),
+                                    wstart.data(),
+                                    nullptr, this->timed("write wstart"));
+    this->queue_.enqueueWriteBuffer(this->wf_, CL_FALSE, 0,
+                                    wf.size() * sizeof(float), wf.data(),
+                                    nullptr, this->timed("write wf"));
+    this->queue_.enqueueWriteBuffer(this->wu_, CL_FALSE, 0,
+                                    wu.size() * sizeof(unsigned int),
+                                    wu.data(),
+                                    nullptr, this->timed("write wu"));
+    this->queue_.enqueueWriteBuffer(this->pw_, CL_FALSE, 0, uint_size,
+                                    pw.data(),
+                                    nullptr, this->timed("write pw"));
+    this->kernel_ensemble_seek_.setArg( 0, this->wstart_);
+    this->kernel_ensemble_seek_.setArg( 1, this->wf_);
+    this->kernel_ensemble_seek_.setArg( 2, this->px_);
+    this->kernel_ensemble_seek_.setArg( 3, this->py_);
+    this->kernel_ensemble_seek_.setArg( 4, this->pc_);
+    this->kernel_ensemble_seek_.setArg( 5, this->ps_);
+    this->kernel_ensemble_seek_.setArg( 6, this->pn_);
+    this->kernel_ensemble_seek_.setArg( 7, this->pan_);
+    this->kernel_ensemble_seek_.setArg( 8, this->pl_);
+    this->kernel_ensemble_seek_.setArg( 9, this->pr_);
+    this->kernel_ensemble_seek_.setArg(10, cl::Local(tile_size));
+    this->kernel_ensemble_seek_.setArg(11, cl::Local(tile_size));
+    this->kernel_ensemble_move_.setArg( 0, TAU);
+    this->kernel_ensemble_move_.setArg( 1, static_cast<cl_uint>(key[0]));
+    this->kernel_ensemble_move_.setArg( 2, static_cast<cl_uint>(key[1]));
+    this->kernel_ensemble_move_.setArg( 3, this->wf_);
+    this->kernel_ensemble_move_.setArg( 4, this->wu_);
+    this->kernel_ensemble_move_.setArg( 5, this->pw_);
+    this->kernel_ensemble_move_.setArg( 6, this->pid_);
+    this->kernel_ensemble_move_.setArg( 7, this->pn_);
+    this->kernel_ensemble_move_.setArg( 8, this->pl_);
+    this->kernel_ensemble_move_.setArg( 9, this->pr_);
+    this->kernel_ensemble_move_.setArg(10, this->px_);
+    this->kernel_ensemble_move_.setArg(11, this->py_);
+    this->kernel_ensemble_move_.setArg(12, this->pf_);
+    this->kernel_ensemble_move_.setArg(13, this->pc_);
+    this->kernel_ensemble_move_.setArg(14, this->ps_);
+    this->queue_.enqueueNDRangeKernel(this->kernel_ensemble_seek_,
+                                      cl::NullRange, worlds * group, group,
+                                      nullptr,
+                                      this->timed("particles_ensemble_seek"));
+    this->queue_.enqueueNDRangeKernel(this->kernel_ensemble_move_,
+                                      cl::NullRange, n, cl::NullRange, nullptr,
+                                      this->timed("particles_ensemble_move"));
+    this->queue_.enqueueReadBuffer(this->px_, CL_FALSE, 0, float_size,
+                                   px.data(), nullptr, this->timed("read px"));
+    this->queue_.enqueueReadBuffer(this->py_, CL_FALSE, 0, float_size,
+                                   py.data(), nullptr, this->timed("read py"));
+    this->queue_.enqueueReadBuffer(this->pf_, CL_FALSE, 0, float_size,
+                                   pf.data(), nullptr, this->timed("read pf"));
+    this->queue_.enqueueReadBuffer(this->pc_, CL_FALSE, 0, float_size,
+                                   pc.data(), nullptr, this->timed("read pc"));
+    this->queue_.enqueueReadBuffer(this->ps_, CL_FALSE, 0, float_size,
+                                   ps.data(), nullptr, this->timed("read ps"));
+    this->queue_.enqueueReadBuffer(this->pn_, CL_FALSE, 0, uint_size,
+                                   pn.data(), nullptr, this->timed("read pn"));
+    this->queue_.enqueueReadBuffer(this->pan_, CL_FALSE, 0, uint_size,
+                                   pan.data(),
+                                   nullptr, this->timed("read pan"));
+    this->queue_.enqueueReadBuffer(this->pl_, CL_FALSE, 0, uint_size,
+                                   pl.data(), nullptr, this->timed("read pl"));
+    this->queue_.enqueueReadBuffer(this->pr_, CL_FALSE, 0, uint_size,
+                                   pr.data(), nullptr, this->timed("read pr"));
     this->queue_.finish();
-    /**
-    // profiling
-    std::cout << event.getProfilingInfo<CL_PROFILING_COMMAND_END>() -
-                 event.getProfilingInfo<CL_PROFILING_COMMAND_START>()
-              << std::endl;
-    //*/
   } catch (cl_int err) {
     this->log_.add(Attn::Ecl, std::to_string(err));
   }
@@ -499,7 +2170,7 @@ Cl::prep_naive_seek()
   Log& log = this->log_;
   try {
     std::string name = "particles_naive_seek";
-    cl::Program program(this->context_, code, CL_TRUE);
+    cl::Program program = this->build(code);
     int compile_err;
     this->kernel_seek_ = cl::Kernel(program, name.c_str(), &compile_err);
     if (compile_err) {
@@ -514,49 +2185,31 @@ Cl::prep_naive_seek()
 
 void
 Cl::naive_seek(unsigned int n, float scope, float ascope,
-               std::vector<float>& px, std::vector<float>& py,
-               std::vector<float>& pc, std::vector<float>& ps,
-               std::vector<unsigned int>& pn, std::vector<unsigned int>& pan,
-               std::vector<unsigned int>& pl, std::vector<unsigned int>& pr)
+               std::vector<unsigned int>& pn, std::vector<unsigned int>& pan)
 {
-  const cl_uint float_size = n * sizeof(float);
-  const cl_uint int_size = n * sizeof(int);
   const cl_uint uint_size = n * sizeof(unsigned int);
   try {
-    cl::Buffer PX(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, px.data());
-    cl::Buffer PY(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, py.data());
-    cl::Buffer PC(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, pc.data());
-    cl::Buffer PS(this->context_, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                  float_size, ps.data());
-    cl::Buffer PN(this->context_, CL_MEM_READ_WRITE, uint_size);
-    cl::Buffer PAN(this->context_, CL_MEM_READ_WRITE, uint_size);
-    cl::Buffer PL(this->context_, CL_MEM_READ_WRITE, uint_size);
-    cl::Buffer PR(this->context_, CL_MEM_READ_WRITE, uint_size);
     this->kernel_seek_.setArg( 0, static_cast<cl_uint>(n));
     this->kernel_seek_.setArg( 1, static_cast<cl_float>(scope));
     this->kernel_seek_.setArg( 2, static_cast<cl_float>(ascope));
-    this->kernel_seek_.setArg( 3, PX);
-    this->kernel_seek_.setArg( 4, PY);
-    this->kernel_seek_.setArg( 5, PC);
-    this->kernel_seek_.setArg( 6, PS);
-    this->kernel_seek_.setArg( 7, PN);
-    this->kernel_seek_.setArg( 8, PAN);
-    this->kernel_seek_.setArg( 9, PL);
-    this->kernel_seek_.setArg(10, PR);
-    this->queue_.enqueueWriteBuffer(PN, CL_TRUE, 0, uint_size, pn.data());
-    this->queue_.enqueueWriteBuffer(PAN, CL_TRUE, 0, uint_size, pan.data());
-    this->queue_.enqueueWriteBuffer(PL, CL_TRUE, 0, uint_size, pl.data());
-    this->queue_.enqueueWriteBuffer(PR, CL_TRUE, 0, uint_size, pr.data());
+    this->kernel_seek_.setArg( 3, this->px_);
+    this->kernel_seek_.setArg( 4, this->py_);
+    this->kernel_seek_.setArg( 5, this->pc_);
+    this->kernel_seek_.setArg( 6, this->ps_);
+    this->kernel_seek_.setArg( 7, this->pn_);
+    this->kernel_seek_.setArg( 8, this->pan_);
+    this->kernel_seek_.setArg( 9, this->pl_);
+    this->kernel_seek_.setArg(10, this->pr_);
+    this->queue_.enqueueFillBuffer(this->pn_, 0u, 0, uint_size);
+    this->queue_.enqueueFillBuffer(this->pan_, 0u, 0, uint_size);
+    this->queue_.enqueueFillBuffer(this->pl_, 0u, 0, uint_size);
+    this->queue_.enqueueFillBuffer(this->pr_, 0u, 0, uint_size);
     this->queue_.enqueueNDRangeKernel(this->kernel_seek_,
                                       cl::NullRange, n, cl::NullRange);
-    this->queue_.enqueueReadBuffer(PN, CL_TRUE, 0, uint_size, pn.data());
-    this->queue_.enqueueReadBuffer(PAN, CL_TRUE, 0, uint_size, pan.data());
-    this->queue_.enqueueReadBuffer(PL, CL_TRUE, 0, uint_size, pl.data());
-    this->queue_.enqueueReadBuffer(PR, CL_TRUE, 0, uint_size, pr.data());
-    this->queue_.finish();
+    this->queue_.enqueueReadBuffer(this->pn_, CL_FALSE, 0, uint_size,
+                                   pn.data());
+    this->queue_.enqueueReadBuffer(this->pan_, CL_FALSE, 0, uint_size,
+                                   pan.data());
   } catch (cl_int err) {
     this->log_.add(Attn::Ecl, std::to_string(err));
   }
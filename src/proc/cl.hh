@@ -12,14 +12,35 @@
 #pragma once
 
 #include "../util/log.hh"
+#include <string>
+#include <vector>
 
 #if 1 == CL_ENABLED
 
 #include <CL/opencl.hpp>
+#include <array>
+#include <deque>
+#include <map>
 
 #endif /* CL_ENABLED */
 
 
+// ClTiming: How long the runs of a command (eg. a kernel, or the reads of a
+//           buffer) took on the device, as 50th, 90th and 99th percentiles
+//           in microseconds, see Cl::timings().
+
+struct ClTiming
+{
+  std::string  name;    // kernel name, or "write", "fill" or "read" and the
+                        // buffer
+  unsigned int count;   // number of runs within the window
+  float        queue[3]; // from queued by the host to submitted to the device
+  float        wait[3];  // from submitted to started
+  float        run[3];   // from started to ended
+  float        share;    // fraction of the device time of all commands
+};
+
+
 class Cl
 {
  public:
@@ -28,70 +49,220 @@ class Cl
 
   /// constructor: Initialise the OpenCL device and build the computation
   ///              kernels.
+  ///              Unless told otherwise, the device is the first GPU of a
+  ///              FULL_PROFILE platform, or failing that, the first device
+  ///              of any type (eg. a CPU under pocl).
   /// \param log  Log object
-  Cl(Log& log);
+  /// \param device  "P:D" for device D of platform P (see devices()), "gpu"
+  ///                or "cpu" for the first device of that type, or empty
+  Cl(Log& log, const std::string& device = "");
+
+  /// devices(): List the devices of every platform, as picked by the
+  ///            constructor.
+  /// \returns  a line of "P:D name (type)" for each device
+  static std::string devices();
 
   /// prep_seek(): Pre-build the kernel for performing particle seeking.
-  ///              See Proc::plain_seek(), plain_seek_vicinity(), and
-  ///              plain_seek_tally() for the non-OpenCL variants.
+  ///              See Proc::plain_seek() and plain_seek_vicinity() for the
+  ///              non-OpenCL variants.
   void prep_seek();
 
-  /// seek: Perform particle seeking.
+  /// push(): Upload the particle arrays, which then stay on the device
+  ///         between ticks, so that seek() and move() need not transfer them.
+  ///         The buffers are (re)allocated here if the system has grown.
+  ///         Only needed when the arrays have changed on the host, see
+  ///         Proc::touch().
   /// \param n  number of particles
-  /// \param w  width of the particle system
-  /// \param h  width of the particle system
-  /// \param scope  vicinity radius squared
-  /// \param ascope  alternative vicinity radius squared
-  /// \param cols  number of grid columns
-  /// \param rows  number of grid rows
-  /// \param grid_stride  stride between each grid unit
-  /// \param grid  flat vector representing the grid
-  /// \param gcol  grid columns vector
-  /// \param grow  grid rows vector
+  /// \param pid  stable particle IDs
   /// \param px  X particle parameter vector
   /// \param py  Y particle parameter vector
+  /// \param pf  PHI particle parameter vector
   /// \param pc  cos(PHI) particle parameter vector
   /// \param ps  sin(PHI) particle parameter vector
-  /// \param pn  N particle parameter vector
-  /// \param pan  alternative N particle parameter vector
-  /// \param pl  L particle parameter vector
-  /// \param pr  R particle parameter vector
-  void seek(unsigned int n, unsigned int w, unsigned int h, float scope,
-            float ascope, int cols, int rows, unsigned int grid_stride,
-            std::vector<int>& grid,
-            std::vector<int>& gcol, std::vector<int>& grow,
+  void push(unsigned int n, std::vector<unsigned int>& pid,
             std::vector<float>& px, std::vector<float>& py,
+            std::vector<float>& pf,
+            std::vector<float>& pc, std::vector<float>& ps);
+
+  /// prep_carry(): Pre-build the kernel for carrying particles between the
+  ///               slots of the particle arrays, see take() and pack().
+  void prep_carry();
+
+  /// take(): Download PHI, cos(PHI) and sin(PHI) of some particles only, eg.
+  ///         of those leaving the strip of a split world, see Proc::split().
+  /// \param slots  index of each particle on the device
+  /// \param pf  PHI of each particle (output)
+  /// \param pc  cos(PHI) of each particle (output)
+  /// \param ps  sin(PHI) of each particle (output)
+  void take(const std::vector<int>& slots, std::vector<float>& pf,
+            std::vector<float>& pc, std::vector<float>& ps);
+
+  /// pack(): Move some particles into other slots of the particle arrays,
+  ///         eg. into those left by the particles taken, see take().
+  /// \param dst  slot to move each particle into
+  /// \param src  slot of each particle
+  void pack(const std::vector<int>& dst, const std::vector<int>& src);
+
+  /// place(): Upload particles behind those on the device already, eg. of
+  ///          those entering the strip of a split world. The buffers grow
+  ///          if need be, keeping the particles before at. See push() for
+  ///          the other params.
+  /// \param at  number of particles to keep
+  void place(unsigned int at, std::vector<unsigned int>& pid,
+             std::vector<float>& px, std::vector<float>& py,
+             std::vector<float>& pf,
+             std::vector<float>& pc, std::vector<float>& ps);
+
+  /// halo(): Upload X and Y of particles behind those on the device, which
+  ///         are seeked with but not moved, eg. of the halo of the strip of
+  ///         a split world. As for move(), px and py must be left alone
+  ///         until the tick is done. See place() for params.
+  void halo(unsigned int at, std::vector<float>& px, std::vector<float>& py);
+
+  /// pull(): Download the particle arrays that seek() and move() leave on
+  ///         the device, see Proc::sync(). X and Y are only downloaded if
+  ///         move() does not, see share().
+  /// \param n  number of particles
+  /// \param px  X particle parameter vector (output)
+  /// \param py  Y particle parameter vector (output)
+  /// \param pf  PHI particle parameter vector (output)
+  /// \param pc  cos(PHI) particle parameter vector (output)
+  /// \param ps  sin(PHI) particle parameter vector (output)
+  /// \param pl  L particle parameter vector (output)
+  /// \param pr  R particle parameter vector (output)
+  void pull(unsigned int n, std::vector<float>& px, std::vector<float>& py,
+            std::vector<float>& pf,
             std::vector<float>& pc, std::vector<float>& ps,
-            std::vector<unsigned int>& pn, std::vector<unsigned int>& pan,
             std::vector<unsigned int>& pl, std::vector<unsigned int>& pr);
 
+  /// prep_plot(): Pre-build the kernels for generating the grid on the
+  ///              device. See Proc::plot() for the non-OpenCL variant.
+  void prep_plot();
+
+  /// plot(): Generate the grid from the particle arrays on the device, as a
+  ///         cell list built by counting sort like Proc::plot(): the grid
+  ///         units are counted (each particle taking a rank within its own),
+  ///         the counts are prefix-summed into offsets, and the particle
+  ///         indices are scattered by offset and rank. Within a grid unit,
+  ///         the particle indices come in no particular order. The grid
+  ///         stays on the device, see grid().
+  /// \param n  number of particles
+  /// \param w  width of the particle system
+  /// \param h  height of the particle system
+  /// \param cols  number of columns in the grid
+  /// \param rows  number of rows in the grid
+  void plot(unsigned int n, unsigned int w, unsigned int h,
+            int cols, int rows);
+
+  /// grid(): Download the grid generated by plot() (for testing).
+  /// \param n  number of particles
+  /// \param units  number of grid units
+  /// \param grid  particle indices ordered by grid unit (output)
+  /// \param gstart  offsets of each grid unit into grid (output)
+  /// \param gcol  grid columns vector (output)
+  /// \param grow  grid rows vector (output)
+  void grid(unsigned int n, unsigned int units,
+            std::vector<int>& grid, std::vector<int>& gstart,
+            std::vector<int>& gcol, std::vector<int>& grow);
+
+  /// seek: Perform particle seeking on the particle arrays on the device,
+  ///       generating the grid with plot() first, so that nothing is
+  ///       uploaded. Each pair is compared once and counted for both of its
+  ///       particles, which takes atomics. The vicinity of each particle is
+  ///       walked like that of Proc::halo(), its wrapping being worked out on
+  ///       the fly. Only N and the alternative N are downloaded, which is done
+  ///       by the time move() returns.
+  /// \param n  number of particles
+  /// \param scope  vicinity radius squared
+  /// \param ascope  alternative vicinity radius squared
+  /// \param w  width of the particle system
+  /// \param h  height of the particle system
+  /// \param cols  number of columns in the grid
+  /// \param rows  number of rows in the grid
+  /// \param pn  N particle parameter vector (output)
+  /// \param pan  alternative N particle parameter vector (output)
+  void seek(unsigned int n, float scope, float ascope,
+            unsigned int w, unsigned int h, int cols, int rows,
+            std::vector<unsigned int>& pn, std::vector<unsigned int>& pan);
+
+  /// prep_gather(): Pre-build the kernel for performing particle seeking by
+  ///                gathering.
+  void prep_gather();
+
+  /// gather: Perform particle seeking like seek(), but with each work-item
+  ///         walking the whole vicinity of its own particle and counting for
+  ///         it alone, so that there are no atomics, at the cost of comparing
+  ///         each pair twice. The neighbor lists can be written this way too,
+  ///         whole, see list(). Hands over to tile() instead if the grid units
+  ///         were crowded enough at the last tick, see tile_min. See seek()
+  ///         for the other params.
+  /// \param lists  whether to write the neighbor lists, see lists()
+  void gather(unsigned int n, float scope, float ascope,
+              unsigned int w, unsigned int h, int cols, int rows,
+              bool lists,
+              std::vector<unsigned int>& pn, std::vector<unsigned int>& pan);
+
+  /// prep_tile(): Pre-build the kernel for performing particle seeking by
+  ///              gathering in tiles.
+  void prep_tile();
+
+  /// tile: Perform particle seeking like gather(), but with a work-group of
+  ///       tile_group work-items for each grid unit, which load the X and Y
+  ///       parameters of the vicinity of the unit into local memory together,
+  ///       tile_size at a time, for all particles of the unit to compare
+  ///       against. This pays off if the grid units are crowded, and wastes
+  ///       work-items if they are sparse. See gather() for params.
+  void tile(unsigned int n, float scope, float ascope,
+            unsigned int w, unsigned int h, int cols, int rows,
+            bool lists,
+            std::vector<unsigned int>& pn, std::vector<unsigned int>& pan);
+
+  /// lists(): Download the neighbor lists written by the last gather(), as
+  ///          lists like those of Proc::list(), each as long as L or R.
+  ///          Does nothing if gather() wrote no lists.
+  /// \param n  number of particles
+  /// \param pls  L neighbor indices (output)
+  /// \param pld  L neighbor distances (output)
+  /// \param prs  R neighbor indices (output)
+  /// \param prd  R neighbor distances (output)
+  /// \param plo  offsets of each L neighbor list (output)
+  /// \param pro  offsets of each R neighbor list (output)
+  void lists(unsigned int n,
+             std::vector<int>& pls, std::vector<float>& pld,
+             std::vector<int>& prs, std::vector<float>& prd,
+             std::vector<unsigned int>& plo, std::vector<unsigned int>& pro);
+
   /// prep_move(): Pre-build the kernel for performing particle moving.
   ///              See Proc::plain_move() for the non-OpenCL variant.
   void prep_move();
 
-  /// move: Perform particle moving.
+  /// move: Perform particle moving on the particle arrays on the device.
+  ///       Only X and Y are downloaded, which the Views draw, unless they are
+  ///       written into an OpenGL vertex buffer instead, see share(). Blocks
+  ///       until the tick is done, unless done is given: the tick is then
+  ///       only flushed, and done marks when it (and with it the downloads
+  ///       of seek()) has landed in the host vectors, which must be left
+  ///       alone until then. Ticks queue up behind each other in order. If
+  ///       shared, move() blocks regardless, since OpenGL may only draw from
+  ///       the vertex buffer once it is released.
   /// \param n  number of particles
   /// \param w  width of the particle system
   /// \param h  height of the particle system
   /// \param a  alpha parameter
   /// \param b  beta parameter
   /// \param s  speed parameter
-  /// \param e  noise parameter
-  /// \param pn  N particle parameter vector
-  /// \param pl  L particle parameter vector
-  /// \param pr  R particle parameter vector
-  /// \param px  X particle parameter vector
-  /// \param py  Y particle parameter vector
-  /// \param pf  PHI particle parameter vector
-  /// \param pc  cos(PHI) particle parameter vector
-  /// \param ps  sin(PHI) particle parameter vector
+  /// \param e  noise added to every particle
+  /// \param d  standard deviation of the noise drawn for each particle (0 for
+  ///           none), see Proc::plain_move()
+  /// \param tick  tick keying the noise of each particle
+  /// \param px  X particle parameter vector (output)
+  /// \param py  Y particle parameter vector (output)
+  /// \param done  event of the downloads (output), or nullptr to block
   void move(unsigned int n, unsigned int w, unsigned int h,
-            float a, float b, float s, float e,
-            std::vector<unsigned int>& pn,
-            std::vector<unsigned int>& pl, std::vector<unsigned int>& pr,
+            float a, float b, float s, float e, float d,
+            unsigned long long tick,
             std::vector<float>& px, std::vector<float>& py,
-            std::vector<float>& pf,
-            std::vector<float>& pc, std::vector<float>& ps);
+            cl::Event* done = nullptr);
 
   /// prep_naive_seek(): Pre-build the kernel for performing naive particle
   ///                    seeking.
@@ -100,12 +271,89 @@ class Cl
   /// naive_seek: Perform naive particle seeking (for benchmarking).
   ///             See seek() for params.
   void naive_seek(unsigned int n, float scope, float ascope,
-                  std::vector<float>& px, std::vector<float>& py,
-                  std::vector<float>& pc, std::vector<float>& ps,
                   std::vector<unsigned int>& pn,
-                  std::vector<unsigned int>& pan,
-                  std::vector<unsigned int>& pl,
-                  std::vector<unsigned int>& pr);
+                  std::vector<unsigned int>& pan);
+
+  /// prep_ensemble(): Pre-build the kernels for seeking and moving many
+  ///                  independent worlds at once.
+  void prep_ensemble();
+
+  /// ensemble(): Seek and move many small independent worlds (see
+  ///             Proc::ensemble()), all in one launch of each kernel. The
+  ///             particle arrays of the worlds are laid out one after the
+  ///             other. Seeking takes a work-group for each world, which
+  ///             compares every pair of its particles by way of local memory
+  ///             rather than a grid, which would hardly pay off for a few
+  ///             hundred particles. Everything is transferred both ways, as
+  ///             the worlds stay on the host between ticks. Blocks until
+  ///             done.
+  /// \param worlds  number of worlds
+  /// \param wstart  offset of the particles of each world, and the number of
+  ///                all particles at the end (worlds + 1)
+  /// \param wf  ensemble_floats parameters of each world: width, height,
+  ///            vicinity radius squared, alternative vicinity radius squared,
+  ///            alpha, beta, speed, noise added to every particle and
+  ///            standard deviation of the noise drawn for each particle
+  /// \param wu  ensemble_uints parameters of each world: noise stream (see
+  ///            Rng::stream()), and the tick keying the noise (low and high
+  ///            words)
+  /// \param pw  world of each particle
+  /// \param pid  stable particle IDs within their worlds
+  /// \param px  X particle parameter vector (input and output)
+  /// \param py  Y particle parameter vector (input and output)
+  /// \param pf  PHI particle parameter vector (input and output)
+  /// \param pc  cos(PHI) particle parameter vector (input and output)
+  /// \param ps  sin(PHI) particle parameter vector (input and output)
+  /// \param pn  N particle parameter vector (output)
+  /// \param pan  alternative N particle parameter vector (output)
+  /// \param pl  L particle parameter vector (output)
+  /// \param pr  R particle parameter vector (output)
+  void ensemble(unsigned int worlds, std::vector<int>& wstart,
+                std::vector<float>& wf, std::vector<unsigned int>& wu,
+                std::vector<unsigned int>& pw,
+                std::vector<unsigned int>& pid,
+                std::vector<float>& px, std::vector<float>& py,
+                std::vector<float>& pf,
+                std::vector<float>& pc, std::vector<float>& ps,
+                std::vector<unsigned int>& pn,
+                std::vector<unsigned int>& pan,
+                std::vector<unsigned int>& pl,
+                std::vector<unsigned int>& pr);
+
+  /// share(): Let move() write X and Y straight into an OpenGL vertex buffer
+  ///          of (x, y, z) triplets instead of downloading them, by way of
+  ///          cl_khr_gl_sharing. The first call moves onto a context shared
+  ///          with the current OpenGL context, which drops the particle
+  ///          arrays on the device, so push() is needed again.
+  /// \param vbo  OpenGL vertex buffer, or 0 to stop sharing (eg. before it
+  ///             is deleted)
+  /// \returns  true if shared, false if the device or the OpenGL context
+  ///           do not allow it (in which case X and Y are downloaded, and
+  ///           later calls give up straight away, see shareable())
+  bool share(unsigned int vbo);
+
+  /// shareable(): Whether share() may succeed, ie. it has not yet found the
+  ///              device or the OpenGL context unable to share (eg. an EGL
+  ///              context under Wayland, which is not a GLX one).
+  /// \returns  false if share() gave up
+  bool
+  shareable() const
+  {
+    return this->shareable_;
+  }
+
+  /// timing(): Start or stop timing every write, fill, kernel and read of
+  ///           a tick, by the profiling info of their events: when each was
+  ///           queued, submitted, started and ended. Starting forgets the
+  ///           runs timed before.
+  /// \param yesno  whether to time
+  void timing(bool yesno);
+
+  /// timings(): Percentiles of the last timing_window runs of each command
+  ///            timed, which tell whether transfers or kernels dominate on
+  ///            the device. Takes in the runs completed since last called.
+  /// \returns  timing of each command, most device time first
+  std::vector<ClTiming> timings();
 
   /// good(): Whether OpenCL is enabled.
   /// \returns  true if OpenCL is enabled
@@ -115,11 +363,42 @@ class Cl
     return !this->device_.getInfo<CL_DEVICE_NAME>().empty();
   }
 
+  static const unsigned int tile_group = 32; // work-items per grid unit
+  static const unsigned int tile_size = 512; // vicinity entries per tile
+  static const unsigned int tile_min = 8;    // particles per occupied grid
+                                             // unit to switch to tile()
+  static const unsigned int ensemble_floats = 9; // float parameters per world
+  static const unsigned int ensemble_uints = 3;  // uint parameters per world
+  static const unsigned int ensemble_group = 64; // work-items per world
+  static const unsigned int ensemble_tile = 256; // particles per tile
+  static const unsigned int timing_window = 1024; // runs kept per command
+
 #else
 
   /// constructor: Stub (OpenCL unavailable).
   /// \param log  (unused) Log object
-  inline Cl(Log& /* log */) {}
+  /// \param device  (unused) device
+  inline Cl(Log& /* log */, const std::string& /* device */ = "") {}
+
+  /// devices(): Stub (OpenCL unavailable).
+  /// \returns  empty list
+  static inline std::string
+  devices()
+  {
+    return "";
+  }
+
+  /// timing(): Stub (OpenCL unavailable).
+  /// \param yesno  (unused) whether to time
+  inline void timing(bool /* yesno */) {}
+
+  /// timings(): Stub (OpenCL unavailable).
+  /// \returns  no timings
+  inline std::vector<ClTiming>
+  timings()
+  {
+    return {};
+  }
 
   /// good(): Stub (OpenCL unavailable).
   /// \returns  false
@@ -134,16 +413,154 @@ class Cl
 #if 1 == CL_ENABLED
 
  private:
+  /// prep(): Pre-build all kernels.
+  void prep();
+
+  /// build(): Build a program for the device, or load it from the binary
+  ///          cached by an earlier build, see cache(). Builds from source if
+  ///          the cached binary is missing or fails to load, and caches the
+  ///          result by renaming a finished temporary file into place.
+  /// \param code  source code
+  /// \returns  built program
+  cl::Program build(const std::string& code);
+
+  /// cache(): Path of the cached binary of a program, which is keyed by the
+  ///          device name, the driver version and a hash of the source code,
+  ///          so that binaries of stale sources or other devices are never
+  ///          picked up. Lives in $XDG_CACHE_HOME or ~/.cache.
+  /// \param code  source code
+  /// \returns  path, or empty if there is no place for a cache
+  std::string cache(const std::string& code);
+
+  /// timed(): Event to enqueue a command with, so that it is timed under a
+  ///          name, see timing().
+  /// \param name  name of the command
+  /// \returns  event, or nullptr if not timing
+  cl::Event* timed(const std::string& name);
+
+  /// timed(): Time a command under a name by the event it was enqueued with
+  ///          anyway (eg. for Proc::land()).
+  /// \param name  name of the command
+  /// \param event  event of the command
+  void timed(const std::string& name, const cl::Event& event);
+
+  /// time(): Take the stamps of the timed commands that have completed
+  ///         into the windows of timings().
+  void time();
+
+  /// gather_args(): Set the arguments of the gather() kernel.
+  /// \param lists  whether the kernel writes the neighbor lists
+  void gather_args(float scope, float ascope, unsigned int w, unsigned int h,
+                   int cols, int rows, bool lists);
+
+  /// list(): Write the neighbor lists of the particles counted by the last
+  ///         gather() or tile(), as Proc::list() does: L and R are scanned
+  ///         into the offset of each list, which sum up to the size of the
+  ///         buffers, and gather() is run again to fill them. Waits for the
+  ///         device to have counted. See gather() for params.
+  void list(unsigned int n, float scope, float ascope,
+            unsigned int w, unsigned int h, int cols, int rows);
+
+  /// enlarge(): Make room in the particle buffers, see push() and place().
+  /// \param n  number of particles
+  /// \param keep  number of particles to keep
+  void enlarge(unsigned int n, unsigned int keep);
+
+  /// carry(): Carry the words of a buffer from the slots in csrc_ to those
+  ///          in cdst_, see prep_carry().
+  /// \param m  number of slots
+  /// \param from  buffer to carry from
+  /// \param to  buffer to carry to
+  /// \param name  name of the command, see timed()
+  void carry(unsigned int m, cl::Buffer& from, cl::Buffer& to,
+             const std::string& name);
+
+  /// reserve_carry(): Make room in the buffers of take() and pack().
+  /// \param m  number of slots
+  void reserve_carry(unsigned int m);
+
+  /// reserve(): Make room in the neighbor list buffers, see list().
+  /// \param n  number of particles
+  /// \param slots  number of neighbors on either side of all particles
+  void reserve(unsigned int n, size_t slots);
+
   Log&             log_;
   cl::Platform     platform_;
   cl::Device       device_;
   cl::Context      context_;
   cl::CommandQueue queue_;
   cl::Kernel       kernel_seek_;
+  cl::Kernel       kernel_gather_;
+  cl::Kernel       kernel_tile_;
+  cl::Kernel       kernel_count_;
+  cl::Kernel       kernel_scan_;
+  cl::Kernel       kernel_fill_;
   cl::Kernel       kernel_move_;
+  cl::Kernel       kernel_carry_;
+  cl::Kernel       kernel_ensemble_seek_;
+  cl::Kernel       kernel_ensemble_move_;
   unsigned int     max_cu_;   // max GPU compute units
   unsigned int     max_freq_; // max GPU frequency
   unsigned int     max_gmem_; // max global memory
+  bool             gl_;       // whether context_ is shared with OpenGL
+  bool             shared_;   // whether move() writes into xyz_
+  bool             shareable_; // whether share() may succeed
+  cl::BufferGL     xyz_;      // OpenGL vertex buffer of (x, y, z) triplets
+  size_t           max_wg_;   // max work-group size
+  // particle arrays, which stay on the device between ticks, see push()
+  unsigned int     capacity_; // number of particles the buffers hold
+  cl::Buffer       pid_;
+  cl::Buffer       px_;
+  cl::Buffer       py_;
+  cl::Buffer       pf_;
+  cl::Buffer       pc_;
+  cl::Buffer       ps_;
+  cl::Buffer       pn_;
+  cl::Buffer       pan_;
+  cl::Buffer       pl_;
+  cl::Buffer       pr_;
+  cl::Buffer       gcol_;
+  cl::Buffer       grow_;
+  cl::Buffer       grank_;    // rank of each particle within its grid unit
+  cl::Buffer       grid_;
+  // grid units, whose number varies with the scope
+  unsigned int     units_capacity_; // number of grid units the buffers hold
+  cl::Buffer       gcount_;
+  cl::Buffer       gstart_;
+  cl::Buffer       goccupied_; // number of grid units holding particles
+  cl_int           occupied_;  // goccupied_ as of the last landed read
+  cl_int           occupied_read_;    // goccupied_ as being read
+  cl::Event        occupied_done_;    // event of reading occupied_read_
+  bool             occupied_reading_; // whether occupied_done_ is pending
+  // neighbor lists, see list()
+  unsigned int     offsets_capacity_; // number of offsets plo_ and pro_ hold
+  size_t           lists_capacity_;   // number of slots the buffers hold
+  bool             listed_;  // whether the last gather() wrote the lists
+  cl::Buffer       plo_;
+  cl::Buffer       pro_;
+  cl::Buffer       lused_;   // number of particles with L (or R) neighbors
+  cl::Buffer       pls_;
+  cl::Buffer       pld_;
+  cl::Buffer       prs_;
+  cl::Buffer       prd_;
+  // particles carried by take() and pack()
+  unsigned int     carry_capacity_; // number of slots the buffers hold
+  cl::Buffer       csrc_;
+  cl::Buffer       cdst_;
+  cl::Buffer       cpf_;
+  cl::Buffer       cpc_;
+  cl::Buffer       cps_;
+  // worlds of ensemble(), whose particles are in the buffers above
+  unsigned int     worlds_capacity_;   // number of worlds the buffers hold
+  unsigned int     ensemble_capacity_; // number of particles pw_ holds
+  cl::Buffer       wstart_;
+  cl::Buffer       wf_;
+  cl::Buffer       wu_;
+  cl::Buffer       pw_;
+  // timing(), by name of command
+  bool             timing_;
+  std::deque<std::pair<std::string,cl::Event>> timed_; // not yet completed
+  std::map<std::string,std::deque<std::array<cl_ulong,4>>> times_; // stamps
 
 #endif /* CL_ENABLED */
 
@@ -7,15 +7,21 @@
 
 
 Control::Control(Log& log, State& state, Proc& proc, ExpControl& expctrl,
-                 Exp& exp, const std::string& init_path, bool pause)
+                 Exp& exp, const std::string& init_path, bool pause,
+                 bool fused /* = false */,
+                 unsigned int inflight /* = 0 */)
   : exp_(exp), expctrl_(expctrl), log_(log), proc_(proc), state_(state),
-    paused_(pause)
+    paused_(pause), fused_(fused), timing_(false), colored_(false)
 {
   this->pid_ = static_cast<int>(getpid());
   this->duration_ = -1;
   this->tick_ = 0;
   this->step_ = false;
   this->quit_ = false;
+  if (0 < inflight && proc.inflight(inflight)) {
+    log.add(Attn::O, "Letting up to " + std::to_string(inflight)
+            + " OpenCL ticks be in flight.");
+  }
   if (!init_path.empty()) {
     this->load(init_path);
   }
@@ -92,6 +98,19 @@ Control::profile()
 
 void
 Control::next()
+{
+  bool cleared;
+
+  if (!this->next_start(cleared)) {
+    return;
+  }
+  this->proc_.next(cleared);
+  this->next_end();
+}
+
+
+bool
+Control::next_start(bool& cleared)
 {
   //this->profile();
 
@@ -106,14 +125,31 @@ Control::next()
   if (this->paused_ && !this->step_) {
     // TODO: separate concerns
     proc.notify(Issue::ProcNextDone); // Views react
-    return;
+    return false;
   }
 
   Exp& exp = this->exp_;
+  Coloring coloring = static_cast<Coloring>(this->state_.coloring_);
+
+  // the counts of the last seek are read once and cleared in the same pass
+  if (this->fused_ && Coloring::Original == coloring) {
+    exp.type_color();
+    cleared = true;
+    this->colored_ = true;
+  } else {
+    exp.type();
+    cleared = false;
+  }
+  return true;
+}
+
 
-  exp.type();
-  proc.next();
-  this->expctrl_.next(exp, *this);
+void
+Control::next_end()
+{
+  long long countdown = this->countdown_;
+
+  this->expctrl_.next(this->exp_, *this);
   this->step_ = false;
   ++this->tick_;
   if (-1 >= countdown) {
@@ -154,7 +190,10 @@ Control::detach_from_proc(Observer& observer)
 void
 Control::change(Stative& input, bool respawn)
 {
+  this->proc_.sync();
   this->state_.change(input, respawn);
+  this->proc_.touch();
+  this->colored_ = false;
   long long duration = input.duration;
   if (duration != this->duration_) {
     this->duration_ = duration;
@@ -237,7 +276,6 @@ Control::load_file(const std::string& path)
 
   float w = static_cast<float>(truth.width_);
   float h = static_cast<float>(truth.height_);
-  unsigned int n_stride = truth.n_stride_;
   unsigned int i;
   float px;
   float py;
@@ -264,10 +302,8 @@ Control::load_file(const std::string& path)
     truth.pl_.push_back(0);
     truth.pr_.push_back(0);
     truth.pan_.push_back(0);
-    for (int j = 0; j < n_stride; ++j) { truth.pls_.push_back(-1); }
-    for (int j = 0; j < n_stride; ++j) { truth.prs_.push_back(-1); }
-    for (int j = 0; j < n_stride; ++j) { truth.pld_.push_back(-1.0f); }
-    for (int j = 0; j < n_stride; ++j) { truth.prd_.push_back(-1.0f); }
+    truth.plo_.push_back(truth.plo_.back());
+    truth.pro_.push_back(truth.pro_.back());
     truth.pt_.push_back(Type::None);
     truth.gcol_.push_back(0);
     truth.grow_.push_back(0);
@@ -275,6 +311,8 @@ Control::load_file(const std::string& path)
     truth.xg_.push_back(1.0f);
     truth.xb_.push_back(1.0f);
     truth.xa_.push_back(0.5f);
+    truth.pid_.push_back(count);
+    truth.pidx_.push_back(count);
     ++count;
   }
   truth.num_ = count;
@@ -282,6 +320,8 @@ Control::load_file(const std::string& path)
     truth.num_ = 1000;
     truth.spawn();
   }
+  this->proc_.touch();
+  this->colored_ = false;
   // TODO: bug when random -> load (change() doesn't help)
   return true;
 }
@@ -295,6 +335,7 @@ Control::save_file(const std::string& path)
   if (!stream) {
     return false;
   }
+  this->proc_.sync();
   stream << this->duration_ << ' '
          << truth.width_ << ' '
          << truth.height_ << ' '
@@ -353,6 +394,77 @@ Control::cl_good() const
 }
 
 
+void
+Control::sync()
+{
+  this->proc_.sync();
+}
+
+
+bool
+Control::share(unsigned int vbo)
+{
+  return this->proc_.share(vbo);
+}
+
+
+bool
+Control::timing(bool yesno)
+{
+  this->timing_ = this->proc_.timing(yesno);
+  return this->timing_;
+}
+
+
+std::vector<ClTiming>
+Control::timings()
+{
+  return this->proc_.timings();
+}
+
+
+bool
+Control::save_timings(const std::string& path)
+{
+  std::vector<ClTiming> timings = this->proc_.timings();
+  std::ofstream stream(path);
+
+  if (!stream) {
+    this->log_.add(Attn::E, "unwritable file: " + path);
+    return false;
+  }
+  stream << "name,count,share";
+  for (const char* span : {"queue", "wait", "run"}) {
+    stream << ',' << span << "50," << span << "90," << span << "99";
+  }
+  stream << '\n';
+  for (ClTiming& timing : timings) {
+    stream << timing.name << ',' << timing.count << ',' << timing.share;
+    for (float* span : {timing.queue, timing.wait, timing.run}) {
+      stream << ',' << span[0] << ',' << span[1] << ',' << span[2];
+    }
+    stream << '\n';
+  }
+  stream.close();
+  this->log_.add(Attn::O, "Saved OpenCL timings to " + path + ".");
+  return true;
+}
+
+
+void
+Control::keep_lists(bool yesno)
+{
+  this->proc_.keep_lists(yesno);
+}
+
+
+bool
+Control::listed()
+{
+  return this->proc_.listed();
+}
+
+
 void
 Control::reset_exp()
 {
@@ -363,7 +475,10 @@ Control::reset_exp()
 std::string
 Control::color(Coloring scheme)
 {
-  this->exp_.color(scheme);
+  if (!this->colored_ || Coloring::Original != scheme) {
+    this->exp_.color(scheme);
+    this->colored_ = false;
+  }
 
   std::string which;
   if      (Coloring::Original  == scheme) { which = "original"; }
@@ -427,7 +542,10 @@ Control::inject(Type type, bool greater)
   unsigned int size = exp.sprites_[type].size();
   std::ostringstream message;
 
+  this->proc_.sync();
   exp.inject(type, greater);
+  this->proc_.touch();
+  this->colored_ = false; // injected particles are white until colored
   state.notify(Issue::StateChanged); // Canvas reacts TODO
 
   message.precision(4);
@@ -51,15 +51,36 @@ class Control
   /// \param expctrl  experiment control object
   /// \param init  path to the file containing an initial state
   /// \param pause  whether system should start paused
+  /// \param fused  whether to type and color particles in the same pass as
+  ///               clearing their counts, see next()
+  /// \param inflight  number of OpenCL ticks that may be in flight while
+  ///                  Exp and the Views work on an older one, see
+  ///                  Proc::inflight()
 
   Control(Log& log, State& state, Proc& proc, ExpControl& expctrl, Exp& exp,
-          const std::string& init, bool pause);
+          const std::string& init, bool pause, bool fused = false,
+          unsigned int inflight = 0);
 
   // next /////////////////////////////////////////////////////////////////////
 
   /// next(): Handle processing iteration, pausing, ticking, etc.
+  ///         When fused_ and coloring by type, Exp::type_color() types,
+  ///         colors and clears in one pass, so that color() has nothing left
+  ///         to do until the next tick.
   void next();
 
+  /// next_start(): First half of next(), up to processing: handle pausing
+  ///               and the end of the countdown, and type the particles.
+  ///               Lets an Ensemble process many worlds at once in between.
+  /// \param cleared  whether the counts are already cleared (output), see
+  ///                 Proc::next()
+  /// \returns  false if there is nothing to process (eg. paused)
+  bool next_start(bool& cleared);
+
+  /// next_end(): Second half of next(), after processing: handle the
+  ///             experiment and tick.
+  void next_end();
+
   /// exp_next(): Handle experimentation.
   void exp_next();
 
@@ -127,18 +148,61 @@ class Control
   /// \returns  true if OpenCL is enabled
   bool cl_good() const;
 
+  /// sync(): Thin wrapper around Proc::sync(), for Views that read particle
+  ///         parameters other than X, Y, N and the alternative N.
+  void sync();
+
+  /// share(): Thin wrapper around Proc::share(), for Canvas.
+  /// \param vbo  OpenGL vertex buffer of (x, y, z) triplets, or 0
+  /// \returns  true if shared
+  bool share(unsigned int vbo);
+
+  /// timing(): Thin wrapper around Proc::timing().
+  /// \param yesno  whether to time the OpenCL commands
+  /// \returns  whether timing
+  bool timing(bool yesno);
+
+  /// timings(): Thin wrapper around Proc::timings().
+  /// \returns  timing of each OpenCL command, most device time first
+  std::vector<ClTiming> timings();
+
+  /// save_timings(): Record the timings of the OpenCL commands.
+  /// \param path  path to the file to save the timings to
+  /// \returns  whether the save was successful
+  bool save_timings(const std::string& path);
+
+  /* timings file format
+   *
+   * - Comma separated values, a header line and a line for each command
+   * - Times in microseconds: 50th, 90th and 99th percentiles of each span
+   * - Namely:
+   *
+   * name,count,share,queue50,queue90,queue99,wait50,wait90,wait99,run50,...
+   * particles_gather,1024,0.41,...
+   * ...
+   */
+
+  /// keep_lists(): Thin wrapper around Proc::keep_lists().
+  /// \param yesno  whether to fill the neighbor lists
+  void keep_lists(bool yesno);
+
+  /// listed(): Thin wrapper around Proc::listed().
+  /// \returns  whether the neighbor lists agree with N, L and R
+  bool listed();
+
   // Exp //////////////////////////////////////////////////////////////////////
 
   /// reset_exp(): Thin wrapper around Exp::reset().
   void reset_exp();
 
-  /// color(): Thin wrapper around Exp::color().
+  /// color(): Thin wrapper around Exp::color(). Skipped for the original
+  ///          scheme if the fused pass of next() has already colored.
   /// \param scheme  particle coloring scheme
   /// \returns  coloring result message
   std::string color(Coloring scheme);
 
   /// highlight(): Thin wrapper around Exp::highlight().
-  /// \param particles  list of particle indices to highlight
+  /// \param particles  list of particle IDs to highlight
   /// \returns  coloring result message
   std::string highlight(std::vector<unsigned int>& particles);
 
@@ -169,6 +233,8 @@ class Control
   bool          quit_;      // whether processing ought to stop
   bool          gui_change_;
   float         dpe_;
+  bool          fused_;     // whether to tick with Exp::type_color()
+  bool          timing_;    // whether the OpenCL commands are timed
 
  private:
   /// profile(): Print the framerate.
@@ -176,6 +242,7 @@ class Control
 
   Log&     log_;
   Proc&    proc_;
+  bool     colored_; // whether colors are by type as of the last fused pass
   std::chrono::steady_clock::time_point profile_ago_;
   std::chrono::steady_clock::time_point profile_last_;
   unsigned int profile_fps_;
@@ -163,3 +163,84 @@ TEST_CASE("Control::save")
   REQUIRE("1" == words[0]);
 }
 
+
+
+TEST_CASE("Control::next fused")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto fexpctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto fstate = State(log, fexpctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto fproc = Proc(log, fstate, cl, true);
+  auto exp = Exp(log, expctrl, state, proc, true);
+  auto fexp = Exp(log, fexpctrl, fstate, fproc, true);
+  auto ctrl = Control(log, state, proc, expctrl, exp, "", false);
+  auto fctrl = Control(log, fstate, fproc, fexpctrl, fexp, "", false, true);
+  fstate.px_ = state.px_;
+  fstate.py_ = state.py_;
+  fstate.pf_ = state.pf_;
+  fstate.pc_ = state.pc_;
+  fstate.ps_ = state.ps_;
+
+  // same frames as Canvas::exec(), color before next
+  for (unsigned int tick = 0; tick < 20; ++tick) {
+    ctrl.color(Coloring::Original);
+    fctrl.color(Coloring::Original);
+    REQUIRE(state.pt_ == fstate.pt_);
+    REQUIRE(state.xr_ == fstate.xr_);
+    REQUIRE(state.xg_ == fstate.xg_);
+    REQUIRE(state.xb_ == fstate.xb_);
+    REQUIRE(state.xa_ == fstate.xa_);
+    ctrl.next();
+    fctrl.next();
+    REQUIRE(state.px_ == fstate.px_);
+    REQUIRE(state.pn_ == fstate.pn_);
+    REQUIRE(state.pan_ == fstate.pan_);
+    REQUIRE(exp.magentas_ == fexp.magentas_);
+    REQUIRE(exp.blues_ == fexp.blues_);
+    REQUIRE(exp.greens_ == fexp.greens_);
+  }
+
+  // other schemes overwrite the colors, which are then redone by type
+  fctrl.color(Coloring::Dynamic);
+  fctrl.color(Coloring::Original);
+  ctrl.color(Coloring::Original);
+  REQUIRE(state.xr_ == fstate.xr_);
+  REQUIRE(state.xa_ == fstate.xa_);
+}
+
+
+TEST_CASE("Exp::cluster reorder")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, false);
+  auto exp = Exp(log, expctrl, state, proc, false);
+  auto ctrl = Control(log, state, proc, expctrl, exp, "", false);
+  unsigned int num = state.num_;
+
+  for (unsigned int tick = 0; tick < 50; ++tick) {
+    ctrl.next();
+  }
+  ctrl.cluster(state.scope_, 14);
+  REQUIRE(0 < exp.clusters_.size());
+  ctrl.color(Coloring::Cluster);
+  std::vector<float> xr = state.xr_;
+  std::vector<float> xa = state.xa_;
+  std::vector<std::set<int>> clusters = exp.clusters_;
+
+  // clusters are kept by ID, so they keep coloring the same particles
+  proc.reorder();
+  std::vector<unsigned int>& pid = state.pid_;
+  REQUIRE(clusters == exp.clusters_);
+  ctrl.color(Coloring::Cluster);
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(xr[pid[i]] == state.xr_[i]);
+    REQUIRE(xa[pid[i]] == state.xa_[i]);
+  }
+}
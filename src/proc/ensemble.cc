@@ -0,0 +1,146 @@
+#include "ensemble.hh"
+#include <iostream>
+
+
+Ensemble::World::World(Log& log, ExpControl& expctrl, Cl& cl, unsigned int w,
+                       bool no_cl, unsigned int threads, unsigned int reorder,
+                       float skin, bool fast_move, bool each_noise,
+                       bool fused)
+  : state_(log, expctrl),
+    proc_(log, state_, cl, no_cl, threads, reorder, skin, fast_move,
+          each_noise),
+    exp_(log, expctrl, state_, proc_, true),
+    ctrl_(log, state_, proc_, expctrl, exp_, "", false, fused)
+{
+  this->proc_.world_ = w;
+  this->exp_.exp_4_count_ = 1 + w;
+  this->exp_.exp_5_count_ = 1 + w;
+}
+
+
+Ensemble::Ensemble(Log& log, ExpControl& expctrl, Cl& cl,
+                   unsigned int worlds, bool no_cl /* = false */,
+                   unsigned int threads /* = 1 */,
+                   unsigned int reorder /* = 0 */, float skin /* = 0.0f */,
+                   bool fast_move /* = false */,
+                   bool each_noise /* = false */, bool fused /* = false */)
+  : quit_(false), quiet_(256, true), cl_(cl)
+{
+  unsigned int replicates = expctrl.replicates();
+  bool use_cl = cl.good() && !no_cl;
+
+  if (worlds > replicates) {
+    log.add(Attn::O, "The experiment has only " + std::to_string(replicates)
+            + " instances to run side by side.");
+    worlds = replicates;
+  }
+  expctrl.worlds_ = worlds;
+  for (unsigned int w = 0; w < worlds; ++w) {
+    this->worlds_.emplace_back(new World(this->quiet_, expctrl, cl, w,
+                                         no_cl, threads, reorder, skin,
+                                         fast_move, each_noise, fused));
+  }
+  if (this->worlds_.empty()) {
+    this->quit_ = true;
+  }
+
+  if (use_cl) {
+    log.add(Attn::O, "Running " + std::to_string(worlds)
+            + " worlds side by side, in one OpenCL launch.");
+  } else {
+    log.add(Attn::O, "Running " + std::to_string(worlds)
+            + " worlds side by side, one after the other.");
+  }
+  if (use_cl && (0 < reorder || 0.0f < skin || fast_move)) {
+    log.add(Attn::O, "Ignoring reordering, Verlet lists and approximate"
+            " moving, which the worlds only use without OpenCL.");
+  }
+}
+
+
+void
+Ensemble::next()
+{
+  std::vector<World*> active;
+  std::vector<Proc*> procs;
+  std::vector<bool> cleared;
+  std::streambuf* out = std::cout.rdbuf();
+  bool clear;
+
+  for (auto& world : this->worlds_) {
+    Control& ctrl = world->ctrl_;
+    if (ctrl.quit_ || ctrl.paused_) {
+      continue;
+    }
+    std::cout.rdbuf(world->out_.rdbuf());
+    if (ctrl.next_start(clear)) {
+      active.push_back(world.get());
+      procs.push_back(&world->proc_);
+      cleared.push_back(clear);
+      std::cout.rdbuf(out);
+    } else {
+      std::cout.rdbuf(out);
+      this->show(*world, true); // done
+    }
+  }
+  if (active.empty()) {
+    this->quit_ = true;
+    return;
+  }
+
+  Proc::ensemble(this->cl_, procs, cleared);
+
+  for (World* world : active) {
+    Control& ctrl = world->ctrl_;
+    std::cout.rdbuf(world->out_.rdbuf());
+    ctrl.next_end();
+    std::cout.rdbuf(out);
+    this->show(*world, ctrl.quit_ || ctrl.paused_);
+  }
+}
+
+
+bool
+Ensemble::timing(bool yesno)
+{
+  if (this->worlds_.empty()) {
+    return false;
+  }
+
+  // the worlds share cl_, and so its timings
+  return this->worlds_.front()->ctrl_.timing(yesno);
+}
+
+
+bool
+Ensemble::save_timings(const std::string& path)
+{
+  if (this->worlds_.empty()) {
+    return false;
+  }
+  return this->worlds_.front()->ctrl_.save_timings(path);
+}
+
+
+void
+Ensemble::show(World& world, bool all)
+{
+  std::string text = world.out_.str();
+  size_t end = text.rfind('\n');
+
+  if (all) {
+    end = text.size();
+  } else if (std::string::npos == end) {
+    return;
+  } else {
+    ++end;
+  }
+  std::cout << text.substr(0, end);
+  if (all && !text.empty() && '\n' != text.back()) {
+    std::cout << "\n";
+  }
+  std::cout << std::flush;
+  world.out_.str(text.substr(end));
+  world.out_.seekp(0, std::ios_base::end);
+}
+
@@ -0,0 +1,85 @@
+//===-- proc/ensemble.hh - Ensemble class declaration ----------*- C++ -*-===//
+///
+/// \file
+/// Declaration of the Ensemble class, which runs several independent worlds
+/// of a replicated experiment (4 or 5) side by side, ticking all of them in
+/// one OpenCL launch, or one after the other without OpenCL (see
+/// Proc::ensemble()). Each world has its own State, Proc, Exp and Control,
+/// and so its own parameters, random numbers and experiment bookkeeping;
+/// world w takes the instances w + 1, w + 1 + W, ...
+///
+//===---------------------------------------------------------------------===//
+
+#pragma once
+
+#include "control.hh"
+#include <memory>
+#include <sstream>
+
+
+class Ensemble
+{
+ public:
+  /// constructor: Set up the worlds, as many as asked for but no more than
+  ///              the experiment has instances.
+  /// \param log  Log object
+  /// \param expctrl  experiment control object, shared by the worlds
+  /// \param cl  Cl object
+  /// \param worlds  number of worlds
+  /// \param no_cl  whether to tick the worlds one after the other, without
+  ///               OpenCL
+  /// \param threads  see Proc()
+  /// \param reorder  see Proc()
+  /// \param skin  see Proc()
+  /// \param fast_move  see Proc()
+  /// \param each_noise  see Proc()
+  /// \param fused  see Control()
+  Ensemble(Log& log, ExpControl& expctrl, Cl& cl, unsigned int worlds,
+           bool no_cl = false, unsigned int threads = 1,
+           unsigned int reorder = 0, float skin = 0.0f,
+           bool fast_move = false, bool each_noise = false,
+           bool fused = false);
+
+  /// next(): Tick every world that is neither done nor finished. What Exp
+  ///         prints for a world is held back until its line is complete, so
+  ///         that the lines of the worlds do not interleave.
+  void next();
+
+  /// timing(): Time the OpenCL commands of the worlds, see Control::timing().
+  /// \param yesno  whether to time
+  /// \returns  whether timing
+  bool timing(bool yesno);
+
+  /// save_timings(): Record the timings of the OpenCL commands of the
+  ///                 worlds, see Control::save_timings(). Its messages go
+  ///                 to the quiet Log of the worlds, so that the caller
+  ///                 reports the outcome.
+  /// \param path  path to the file to save the timings to
+  /// \returns  whether the save was successful
+  bool save_timings(const std::string& path);
+
+  bool quit_; // whether all worlds have finished
+
+ private:
+  struct World
+  {
+    World(Log& log, ExpControl& expctrl, Cl& cl, unsigned int w,
+          bool no_cl, unsigned int threads, unsigned int reorder, float skin,
+          bool fast_move, bool each_noise, bool fused);
+
+    State              state_;
+    Proc               proc_;
+    Exp                exp_;
+    Control            ctrl_;
+    std::ostringstream out_;  // what Exp has printed, but not yet shown
+  };
+
+  /// show(): Print the complete lines a world has printed.
+  /// \param world  world
+  /// \param all  whether to print the incomplete last line too
+  void show(World& world, bool all);
+
+  Log  quiet_; // for the worlds, which would otherwise repeat every message
+  Cl&  cl_;
+  std::vector<std::unique_ptr<World>> worlds_;
+};
@@ -0,0 +1,31 @@
+//===-- proc/halo.hh - Halo struct definition ------------------*- C++ -*-===//
+///
+/// \file
+/// Definition of the Halo struct, which holds a grid of particles surrounded
+/// by a halo of ghost grid units, as generated by Proc::halo(). It lets the
+/// seeking algorithms go through the vicinity of a grid unit without any
+/// checks for wrapping across the edges of the space.
+///
+//===---------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+
+// Halo: Grid with a halo of ghost grid units around it, see Proc::halo().
+
+struct Halo
+{
+  int                cols;  // number of columns, including the halo
+  int                rows;  // number of rows, including the halo
+  std::vector<int>   start; // offsets of each grid unit into the rest
+  std::vector<int>   index; // particle indices ordered by grid unit
+  std::vector<float> x;     // X parameters ordered by grid unit
+  std::vector<float> y;     // Y parameters ordered by grid unit
+  std::vector<float> c;     // cos(PHI) parameters ordered by grid unit
+  std::vector<float> s;     // sin(PHI) parameters ordered by grid unit
+  std::vector<float> offx;  // x wrapping offsets (-width, 0, or width)
+  std::vector<float> offy;  // y wrapping offsets (-height, 0, or height)
+  std::vector<int>   pos;   // position of each particle outside the ghosts
+};
@@ -1,26 +1,64 @@
 #include "proc.hh"
+#include "tally.hh"
 #include "../util/common.hh"
+#include "../util/rng.hh"
 #include "../util/util.hh"
+#include <algorithm>
 #include <chrono>
 #include <GL/glew.h>
 
 
-Proc::Proc(Log& log, State& state, Cl& cl, bool no_cl)
-  : state_(state), cl_(cl)
+Proc::Proc(Log& log, State& state, Cl& cl, bool no_cl,
+           unsigned int threads /* = 1 */, unsigned int reorder /* = 0 */,
+           float skin /* = 0.0f */, bool fast_move /* = false */,
+           bool each_noise /* = false */)
+  : state_(state), lists_(false), world_(0), cl_(cl), reorder_(reorder),
+    reorder_tick_(0),
+    verlet_skin_(skin), verlet_built_(false), fast_move_(fast_move),
+    each_noise_(each_noise), tick_(0), lists_tick_(0), cl_pushed_(false),
+    cl_synced_(true), cl_shared_(false), inflight_(0)
 {
   this->cl_good_ = this->cl_.good();
+#if 1 == CL_ENABLED
+  this->flight_ = 0;
+#endif /* CL_ENABLED */
   if (no_cl) {
     this->cl_good_ = false;
   }
+  if (1 > threads || this->cl_good_) {
+    threads = 1;
+  }
+  this->pool_.reset(new Pool(threads));
   if (!this->cl_good_) {
     log.add(Attn::O, "Proceeding without OpenCL parallelisation.");
+    if (1 < threads) {
+      log.add(Attn::O, "Seeking with " + std::to_string(threads)
+              + " threads.");
+    } else {
+      log.add(Attn::O, "Seeking with " + Simd::name(Simd::level())
+              + " instructions.");
+    }
+  }
+  if (0 < reorder) {
+    log.add(Attn::O, "Reordering particles every " + std::to_string(reorder)
+            + " ticks.");
+  }
+  if (0.0f < skin && !this->cl_good_) {
+    log.add(Attn::O, "Seeking with Verlet lists of skin "
+            + std::to_string(skin) + ".");
+  }
+  if (fast_move && !this->cl_good_) {
+    log.add(Attn::O, "Moving with approximate sine and cosine.");
+  }
+  if (each_noise) {
+    log.add(Attn::O, "Drawing heading noise for each particle.");
   }
   log.add(Attn::O, "Started process module.");
 }
 
 
 void
-Proc::next()
+Proc::next(bool cleared /* = false */)
 {
   /**
   // profiling
@@ -30,22 +68,51 @@ Proc::next()
   now = std::chrono::steady_clock::now();
   //*/
 
-  this->clear();
+  if (!cleared) {
+    this->clear();
+  }
+  ++this->tick_;
+  if (0 < this->reorder_ && this->reorder_ <= ++this->reorder_tick_) {
+    this->reorder();
+    this->reorder_tick_ = 0;
+  }
 
 #if 1 == CL_ENABLED
 
+  if (this->cl_good_ && !this->strips_.empty()) {
+    this->strip_next();
+    this->notify(Issue::ProcNextDone); // Views react
+    return;
+  }
   if (this->cl_good_) {
-    this->seek();
-    this->move();
+    if (!this->cl_pushed_) {
+      State& state = this->state_;
+      this->cl_.push(state.num_, state.pid_, state.px_, state.py_,
+                     state.pf_, state.pc_, state.ps_);
+      this->cl_pushed_ = true;
+    }
+    if (0 < this->inflight_) {
+      this->launch();
+    } else {
+      this->seek(this->state_.pn_, this->state_.pan_);
+      this->move(this->state_.px_, this->state_.py_);
+    }
+    this->cl_synced_ = false;
     this->notify(Issue::ProcNextDone); // Views react
     return;
   }
 
 #endif /* CL_ENABLED */
 
-  this->plain_seek(this->state_.scope_, this->grid_,
-                   this->grid_cols_, this->grid_rows_, this->grid_stride_,
-                   &Proc::tally_neighborhood);
+  if (0.0f < this->verlet_skin_) {
+    this->verlet_seek();
+  } else if (1 < this->pool_->size()) {
+    this->thread_seek(this->state_.scope_, this->grid_, this->grid_start_,
+                      this->grid_cols_, this->grid_rows_);
+  } else {
+    this->vector_seek(this->state_.scope_, this->grid_, this->grid_start_,
+                      this->grid_cols_, this->grid_rows_);
+  }
   this->plain_move();
   this->notify(Issue::ProcNextDone); // Views react
 
@@ -59,6 +126,223 @@ Proc::next()
 }
 
 
+void
+Proc::sync()
+{
+#if 1 == CL_ENABLED
+
+  State& state = this->state_;
+
+  if (!this->cl_good_ || this->cl_synced_) {
+    return;
+  }
+  while (!this->flying_.empty()) {
+    this->land();
+  }
+  if (!this->strips_.empty()) {
+    this->strip_sync();
+    this->cl_synced_ = true;
+    return;
+  }
+  this->cl_.pull(state.num_, state.px_, state.py_,
+                 state.pf_, state.pc_, state.ps_, state.pl_, state.pr_);
+  if (this->lists_) {
+    this->cl_.lists(state.num_, state.pls_, state.pld_, state.prs_, state.prd_,
+                    state.plo_, state.pro_);
+  }
+  this->cl_synced_ = true;
+
+#endif /* CL_ENABLED */
+}
+
+
+void
+Proc::touch()
+{
+#if 1 == CL_ENABLED
+
+  // the ticks in flight are of the particles as they were, so drop them
+  for (unsigned int i : this->flying_) {
+    this->flights_[i].done.wait();
+  }
+  this->flying_.clear();
+
+#endif /* CL_ENABLED */
+
+  this->cl_pushed_ = false;
+}
+
+
+#if 1 == CL_ENABLED
+
+bool
+Proc::inflight(unsigned int ticks)
+{
+  if (this->cl_good_ && this->strips_.empty()) {
+    this->sync();
+    this->inflight_ = ticks;
+    this->flights_.clear();
+    this->flights_.resize(0 < ticks ? ticks + 1 : 0);
+    this->flight_ = 0;
+    return true;
+  }
+  return false;
+}
+
+#else
+
+bool
+Proc::inflight(unsigned int /* ticks */)
+{
+  return false;
+}
+
+#endif /* CL_ENABLED */
+
+
+#if 1 == CL_ENABLED
+
+void
+Proc::ensemble(Cl& cl, std::vector<Proc*>& procs,
+               const std::vector<bool>& cleared)
+{
+  if (!procs.empty() && procs.front()->cl_good_) {
+    Proc::cl_ensemble(cl, procs, cleared);
+    return;
+  }
+
+  for (unsigned int w = 0; w < procs.size(); ++w) {
+    procs[w]->next(cleared[w]);
+  }
+}
+
+#else
+
+void
+Proc::ensemble(Cl& /* cl */, std::vector<Proc*>& procs,
+               const std::vector<bool>& cleared)
+{
+  for (unsigned int w = 0; w < procs.size(); ++w) {
+    procs[w]->next(cleared[w]);
+  }
+}
+
+#endif /* CL_ENABLED */
+
+
+#if 1 == CL_ENABLED
+
+bool
+Proc::split(const std::vector<Cl*>& cls)
+{
+  Strip strip;
+
+  if (!this->cl_good_) {
+    return false;
+  }
+  this->sync();
+  this->inflight_ = 0;
+  this->flights_.clear();
+  this->strips_.clear();
+  strip.cl = &this->cl_;
+  this->strips_.push_back(strip);
+  for (Cl* cl : cls) {
+    if (cl->good()) {
+      strip.cl = cl;
+      this->strips_.push_back(strip);
+    }
+  }
+  if (1 < this->strips_.size()) {
+    this->touch(); // dealt out at the next tick
+    return true;
+  }
+  this->strips_.clear();
+  return false;
+}
+
+#else
+
+bool
+Proc::split(const std::vector<Cl*>& /* cls */)
+{
+  return false;
+}
+
+#endif /* CL_ENABLED */
+
+
+#if 1 == CL_ENABLED
+
+bool
+Proc::share(unsigned int vbo)
+{
+  bool shared = false;
+
+  // Canvas asks every frame while refused, which need not sync every time
+  if (this->cl_good_ && this->strips_.empty()
+      && (0 == vbo || this->cl_.shareable())) {
+    this->sync();
+    shared = this->cl_.share(vbo);
+    this->cl_shared_ = shared;
+    this->touch();
+  }
+  return shared;
+}
+
+#else
+
+bool
+Proc::share(unsigned int /* vbo */)
+{
+  return false;
+}
+
+#endif /* CL_ENABLED */
+
+
+#if 1 == CL_ENABLED
+
+bool
+Proc::timing(bool yesno)
+{
+  bool timing = false;
+
+  if (this->cl_good_) {
+    this->cl_.timing(yesno);
+    timing = yesno;
+  }
+  return timing;
+}
+
+#else
+
+bool
+Proc::timing(bool /* yesno */)
+{
+  return false;
+}
+
+#endif /* CL_ENABLED */
+
+
+std::vector<ClTiming>
+Proc::timings()
+{
+  return this->cl_.timings();
+}
+
+
+void
+Proc::keep_lists(bool yesno)
+{
+  // the seeks so far recorded no pairs, so the next one is the first listed
+  if (yesno && !this->lists_) {
+    this->lists_tick_ = this->tick_;
+  }
+  this->lists_ = yesno;
+}
+
+
 void
 Proc::clear()
 {
@@ -67,55 +351,102 @@ Proc::clear()
   std::vector<unsigned int>& pl = state.pl_;
   std::vector<unsigned int>& pr = state.pr_;
   std::vector<unsigned int>& pan = state.pan_;
-  std::vector<int>& pls = state.pls_;
-  std::vector<int>& prs = state.prs_;
-  std::vector<float>& pld = state.pld_;
-  std::vector<float>& prd = state.prd_;
-  unsigned int n_stride = state.n_stride_;
-  unsigned int istride;
-  unsigned int jstride;
 
   for (int i = 0; i < state.num_; ++i) {
     pn[i] = 0;
     pl[i] = 0;
     pr[i] = 0;
     pan[i] = 0;
-    istride = n_stride * i;
-    for (int j = 0; j < n_stride; ++j) {
-      jstride = istride + j;
-      if (0 > pls[jstride]) {
-        break;
-      }
-      pls[jstride] = -1;
-      pld[jstride] = -1.0f;
+  }
+}
+
+
+void
+Proc::list()
+{
+  if (!this->lists_) {
+    return;
+  }
+  this->list_start();
+  this->list_fill(this->pairs_, true);
+  this->pairs_.clear();
+}
+
+
+void
+Proc::list_start()
+{
+  State& state = this->state_;
+  unsigned int num = state.num_;
+  std::vector<unsigned int>& pl = state.pl_;
+  std::vector<unsigned int>& pr = state.pr_;
+  std::vector<unsigned int>& plo = state.plo_;
+  std::vector<unsigned int>& pro = state.pro_;
+
+  // prefix sums of the counts
+  plo.resize(num + 1);
+  pro.resize(num + 1);
+  plo[0] = 0;
+  pro[0] = 0;
+  for (unsigned int i = 0; i < num; ++i) {
+    plo[i + 1] = plo[i] + pl[i];
+    pro[i + 1] = pro[i] + pr[i];
+  }
+  state.pls_.resize(plo[num]);
+  state.pld_.resize(plo[num]);
+  state.prs_.resize(pro[num]);
+  state.prd_.resize(pro[num]);
+  this->list_l_.assign(plo.begin(), plo.end() - 1);
+  this->list_r_.assign(pro.begin(), pro.end() - 1);
+}
+
+
+void
+Proc::list_fill(std::vector<Pair>& pairs, bool both)
+{
+  State& state = this->state_;
+  std::vector<int>& pls = state.pls_;
+  std::vector<int>& prs = state.prs_;
+  std::vector<float>& pld = state.pld_;
+  std::vector<float>& prd = state.prd_;
+  std::vector<unsigned int>& ln = this->list_l_;
+  std::vector<unsigned int>& rn = this->list_r_;
+  unsigned int n;
+
+  for (Pair& pair : pairs) {
+    if (pair.srcright) {
+      n = rn[pair.srci]++;
+      prs[n] = pair.dsti;
+      prd[n] = pair.distsq;
+    } else {
+      n = ln[pair.srci]++;
+      pls[n] = pair.dsti;
+      pld[n] = pair.distsq;
     }
-    for (int j = 0; j < n_stride; ++j) {
-      jstride = istride + j;
-      if (0 > prs[jstride]) {
-        break;
-      }
-      prs[jstride] = -1;
-      prd[jstride] = -1.0f;
+    if (!both) {
+      continue;
+    }
+    if (pair.dstright) {
+      n = rn[pair.dsti]++;
+      prs[n] = pair.srci;
+      prd[n] = pair.distsq;
+    } else {
+      n = ln[pair.dsti]++;
+      pls[n] = pair.srci;
+      pld[n] = pair.distsq;
     }
   }
 }
 
 
 void
-Proc::plot(unsigned int scope, std::vector<int>& grid, int& cols, int& rows,
-           unsigned int& stride)
+Proc::plot(unsigned int scope, std::vector<int>& grid,
+           std::vector<int>& gstart, int& cols, int& rows)
 {
   State& state = this->state_;
   unsigned int num = state.num_;
-  float width = state.width_;
-  float height = state.height_;
-  // the columns and rows of the grid are semi-flattened to a single list, but
-  // each element is itself a list (of particle indices) -- "semi-" because the
-  // entire thing will be further flattened later
-  cols = 1; if (width  > scope) { cols = floor(width  / scope); }
-  rows = 1; if (height > scope) { rows = floor(height / scope); }
-  unsigned int unflat_size = cols * rows;
-  auto unflat = std::vector<std::vector<int>>(unflat_size);
+  this->dims(scope, cols, rows);
+  unsigned int units = cols * rows;
   float unit_width = state.width_ / cols;
   float unit_height = state.height_ / rows;
   std::vector<float>& px = state.px_;
@@ -124,7 +455,10 @@ Proc::plot(unsigned int scope, std::vector<int>& grid, int& cols, int& rows,
   std::vector<int>& grow = state.grow_;
   gcol.resize(num);
   grow.resize(num);
+  grid.resize(num);
+  gstart.assign(units + 1, 0);
 
+  // count the particles in each grid unit
   int col;
   int row;
   for (int i = 0; i < num; ++i) {
@@ -134,79 +468,618 @@ Proc::plot(unsigned int scope, std::vector<int>& grid, int& cols, int& rows,
     row = floor(py[i] / unit_height); if (row >= rows) { row = rows - 1; }
     gcol[i] = col;
     grow[i] = row;
-    unflat[cols * row + col].push_back(i);
+    ++gstart[cols * row + col];
   }
 
-  // find the size of the largest grid unit
-  stride = 0;
-  unsigned int count = 0;
-  for (unsigned int i = 0; i < unflat_size; ++i) {
-    count = unflat[i].size();
-    if (count > stride) {
-      stride = count;
-    }
+  // running sum, so that each offset points past the end of its grid unit
+  for (unsigned int u = 1; u < units; ++u) {
+    gstart[u] += gstart[u - 1];
   }
+  gstart[units] = num;
+
+  // fill backwards, which moves every offset back to the start of its grid
+  // unit and keeps the particle indices within a unit in ascending order
+  for (int i = num - 1; i >= 0; --i) {
+    grid[--gstart[cols * grow[i] + gcol[i]]] = i;
+  }
+}
+
+
+void
+Proc::dims(unsigned int scope, int& cols, int& rows)
+{
+  State& state = this->state_;
+  float width = state.width_;
+  float height = state.height_;
+  cols = 1; if (width  > scope) { cols = floor(width  / scope); }
+  rows = 1; if (height > scope) { rows = floor(height / scope); }
+}
+
+
+void
+Proc::halo(std::vector<int>& grid, std::vector<int>& gstart,
+           int cols, int rows, Halo& halo)
+{
+  State& state = this->state_;
+  std::vector<float>& px = state.px_;
+  std::vector<float>& py = state.py_;
+  std::vector<float>& pc = state.pc_;
+  std::vector<float>& ps = state.ps_;
+  float width = state.width_;
+  float height = state.height_;
+  int hcols = cols + 2;
+  int hrows = rows + 2;
+  std::vector<int>& start = halo.start;
+  unsigned int hunit;
+  unsigned int unit;
+  int size = 0;
+  int base;
+  int row;
+  int i;
+  int p;
+  float offy;
+
+  halo.cols = hcols;
+  halo.rows = hrows;
+  start.resize(hcols * hrows + 1);
 
-  // flatten the grid (a single list of particle indices, padding with -1)
-  auto flat = std::vector<int>();
-  for (std::vector<int> unit : unflat) {
-    count = 0;
-    for (int p : unit) {
-      flat.push_back(p);
-      ++count;
+  // every halo unit is as big as the grid unit it copies, which for the
+  // ghost units is the one at the opposite edge
+  for (int hrow = 0; hrow < hrows; ++hrow) {
+    row = 0 == hrow ? rows - 1 : hrows - 1 == hrow ? 0 : hrow - 1;
+    unit = cols * row;
+    hunit = hcols * hrow;
+    start[hunit] = size;
+    size += gstart[unit + cols] - gstart[unit + cols - 1];
+    base = size - gstart[unit]; // the grid row is shifted as a whole
+    for (int col = 0; col < cols; ++col) {
+      start[hunit + col + 1] = base + gstart[unit + col];
     }
-    while (count < stride) {
-      flat.push_back(-1);
-      ++count;
+    size = base + gstart[unit + cols];
+    start[hunit + cols + 1] = size;
+    size += gstart[unit + 1] - gstart[unit];
+  }
+  start[hcols * hrows] = size;
+  // padded for Simd::compare()
+  halo.index.resize(size + Simd::pad);
+  halo.x.resize(size + Simd::pad);
+  halo.y.resize(size + Simd::pad);
+  halo.c.resize(size + Simd::pad);
+  halo.s.resize(size + Simd::pad);
+  halo.offx.resize(size + Simd::pad);
+  halo.offy.resize(size + Simd::pad);
+  halo.pos.resize(grid.size());
+
+  // each halo row is the west ghost unit, the whole grid row, and the east
+  // ghost unit, all of which are contiguous in grid
+  p = 0;
+  for (int hrow = 0; hrow < hrows; ++hrow) {
+    row = 0 == hrow ? rows - 1 : hrows - 1 == hrow ? 0 : hrow - 1;
+    offy = 0 == hrow ? -height : hrows - 1 == hrow ? height : 0.0f;
+    unit = cols * row;
+    int from[3] = {gstart[unit + cols - 1], gstart[unit], gstart[unit]};
+    int to[3] = {gstart[unit + cols], gstart[unit + cols], gstart[unit + 1]};
+    float offx[3] = {-width, 0.0f, width};
+    for (unsigned int v = 0; v < 3; ++v) {
+      for (int g = from[v]; g < to[v]; ++g, ++p) {
+        i = grid[g];
+        halo.index[p] = i;
+        halo.x[p] = px[i];
+        halo.y[p] = py[i];
+        halo.c[p] = pc[i];
+        halo.s[p] = ps[i];
+        halo.offx[p] = offx[v];
+        halo.offy[p] = offy;
+        if (1 == v && 0 < hrow && hrows - 1 > hrow) {
+          halo.pos[i] = p;
+        }
+      }
     }
   }
+}
 
-  grid = flat;
+
+void
+Proc::reorder()
+{
+  State& state = this->state_;
+  this->sync();
+  this->plot(state.scope_, this->grid_, this->grid_start_,
+             this->grid_cols_, this->grid_rows_);
+  state.reorder(this->grid_);
+  this->verlet_built_ = false; // pairs refer to old indices
+  this->touch();
 }
 
 
 #if 1 == CL_ENABLED
 
 void
-Proc::seek()
+Proc::seek(std::vector<unsigned int>& pn, std::vector<unsigned int>& pan)
 {
   State& state = this->state_;
+  this->dims(state.scope_, this->grid_cols_, this->grid_rows_);
   /**/
-  this->plot(state.scope_, this->grid_,
-             this->grid_cols_, this->grid_rows_, this->grid_stride_);
-  this->cl_.seek(state.num_, state.width_, state.height_,
-                 state.scope_squared_, state.ascope_squared_,
-                 this->grid_cols_, this->grid_rows_,
-                 this->grid_stride_, this->grid_, state.gcol_, state.grow_,
-                 state.px_, state.py_, state.pc_, state.ps_,
-                 state.pn_, state.pan_, state.pl_, state.pr_);
+  this->cl_.gather(state.num_, state.scope_squared_, state.ascope_squared_,
+                   state.width_, state.height_,
+                   this->grid_cols_, this->grid_rows_,
+                   this->lists_, pn, pan);
+  //*/
+  /**
+  this->cl_.seek(state.num_, state.scope_squared_, state.ascope_squared_,
+                 state.width_, state.height_,
+                 this->grid_cols_, this->grid_rows_, pn, pan);
   //*/
   /**
   this->cl_.naive_seek(state.num_, state.scope_squared_, state.ascope_squared_,
-                       state.px_, state.py_, state.pc_, state.ps_,
-                       state.pn_, state.pan_, state.pl_, state.pr_);
+                       pn, pan);
   //*/
 }
 
 
 void
-Proc::move()
+Proc::move(std::vector<float>& px, std::vector<float>& py,
+           cl::Event* done /* = nullptr */)
 {
   State& state = this->state_;
   this->cl_.move(state.num_, state.width_, state.height_,
-                 state.alpha_, state.beta_, state.speed_,
-                 Util::normal_noise(state.noise_),
-                 state.pn_, state.pl_, state.pr_,
-                 state.px_, state.py_, state.pf_, state.pc_, state.ps_);
+                 state.alpha_, state.beta_, state.speed_, this->noise(),
+                 this->each_noise_ ? state.noise_ : 0.0f, this->tick_,
+                 px, py, done);
 }
 
-#endif /* CL_ENABLED */
+
+void
+Proc::launch()
+{
+  const unsigned int num = this->state_.num_;
+  Flight& flight = this->flights_[this->flight_];
+
+  if (num != flight.pn.size()) {
+    flight.pn.resize(num);
+    flight.pan.resize(num);
+    flight.px.resize(num);
+    flight.py.resize(num);
+  }
+  this->seek(flight.pn, flight.pan);
+  this->move(flight.px, flight.py, &flight.done);
+  this->flying_.push_back(this->flight_);
+  this->flight_ = (this->flight_ + 1) % this->flights_.size();
+  if (this->inflight_ < this->flying_.size()) {
+    this->land();
+  }
+}
+
+
+void
+Proc::strip_next()
+{
+  State& state = this->state_;
+  std::vector<Strip>& strips = this->strips_;
+  std::vector<unsigned int>& owner = this->strip_of_row_;
+  std::vector<int>& rowof = this->strip_row_;
+  const float e = this->noise();
+  const float d = this->each_noise_ ? state.noise_ : 0.0f;
+  unsigned int used;
+  unsigned int up;
+  unsigned int down;
+  unsigned int n;
+  int cols;
+  int rows;
+  float uh;
+  int row;
+  int g;
+
+  // a strip of at least one grid row each
+  this->dims(state.scope_, cols, rows);
+  uh = static_cast<float>(state.height_) / rows;
+  used = static_cast<unsigned int>(rows) < strips.size() ? rows
+                                                           : strips.size();
+  owner.resize(rows);
+  for (int r = 0; r < rows; ++r) {
+    owner[r] = r * used / rows;
+  }
+  rowof.resize(state.num_);
+  for (int i = 0; i < state.num_; ++i) {
+    rowof[i] = std::min(static_cast<int>(state.py_[i] / uh), rows - 1);
+  }
+  if (this->cl_pushed_) {
+    this->strip_trade();
+  } else {
+    this->strip_deal();
+    this->cl_pushed_ = true;
+  }
+
+  // then the halos behind, a boundary grid row being the halo of the strips
+  // above and below it (which may be one and the same)
+  for (Strip& strip : strips) {
+    strip.index.resize(strip.own);
+  }
+  for (int i = 0; i < state.num_; ++i) {
+    row = rowof[i];
+    up = owner[(row + 1) % rows];
+    down = owner[(row + rows - 1) % rows];
+    if (up != owner[row]) {
+      strips[up].index.push_back(i);
+    }
+    if (down != owner[row] && down != up) {
+      strips[down].index.push_back(i);
+    }
+  }
+
+  // the devices work at the same time, as only the downloads are waited for
+  for (Strip& strip : strips) {
+    n = strip.index.size();
+    if (0 == strip.own) {
+      continue;
+    }
+    strip.hx.resize(n - strip.own);
+    strip.hy.resize(n - strip.own);
+    for (unsigned int k = strip.own; k < n; ++k) {
+      g = strip.index[k];
+      strip.hx[k - strip.own] = state.px_[g];
+      strip.hy[k - strip.own] = state.py_[g];
+    }
+    strip.px.resize(strip.own);
+    strip.py.resize(strip.own);
+    strip.pn.resize(n);
+    strip.pan.resize(n);
+    strip.cl->halo(strip.own, strip.hx, strip.hy);
+    strip.cl->gather(n, state.scope_squared_, state.ascope_squared_,
+                     state.width_, state.height_, cols, rows,
+                     this->lists_, strip.pn, strip.pan);
+    // the halo is seeked with, but not moved
+    strip.cl->move(strip.own, state.width_, state.height_,
+                   state.alpha_, state.beta_, state.speed_, e, d,
+                   this->tick_, strip.px, strip.py, &strip.done);
+  }
+  for (Strip& strip : strips) {
+    if (0 == strip.own) {
+      continue;
+    }
+    strip.done.wait();
+    for (unsigned int k = 0; k < strip.own; ++k) {
+      g = strip.index[k];
+      state.px_[g] = strip.px[k];
+      state.py_[g] = strip.py[k];
+      state.pn_[g] = strip.pn[k];
+      state.pan_[g] = strip.pan[k];
+    }
+  }
+  this->cl_synced_ = false;
+}
+
+
+void
+Proc::strip_deal()
+{
+  State& state = this->state_;
+  std::vector<Strip>& strips = this->strips_;
+  std::vector<unsigned int>& owner = this->strip_of_row_;
+  std::vector<int>& rowof = this->strip_row_;
+  int g;
+
+  for (Strip& strip : strips) {
+    strip.index.clear();
+  }
+  for (int i = 0; i < state.num_; ++i) {
+    strips[owner[rowof[i]]].index.push_back(i);
+  }
+  for (Strip& strip : strips) {
+    strip.own = strip.index.size();
+    if (0 == strip.own) {
+      continue;
+    }
+    strip.pid.resize(strip.own);
+    strip.px.resize(strip.own);
+    strip.py.resize(strip.own);
+    strip.pf.resize(strip.own);
+    strip.pc.resize(strip.own);
+    strip.ps.resize(strip.own);
+    for (unsigned int k = 0; k < strip.own; ++k) {
+      g = strip.index[k];
+      strip.pid[k] = state.pid_[g];
+      strip.px[k] = state.px_[g];
+      strip.py[k] = state.py_[g];
+      strip.pf[k] = state.pf_[g];
+      strip.pc[k] = state.pc_[g];
+      strip.ps[k] = state.ps_[g];
+    }
+    strip.cl->push(strip.own, strip.pid, strip.px, strip.py,
+                   strip.pf, strip.pc, strip.ps);
+  }
+}
+
+
+void
+Proc::strip_trade()
+{
+  State& state = this->state_;
+  std::vector<Strip>& strips = this->strips_;
+  std::vector<unsigned int>& owner = this->strip_of_row_;
+  std::vector<int>& rowof = this->strip_row_;
+  std::vector<float> pf;
+  std::vector<float> pc;
+  std::vector<float> ps;
+  std::vector<int> holes;
+  std::vector<int> moved;
+  std::vector<int>::iterator gone;
+  unsigned int own;
+  int g;
+
+  for (Strip& strip : strips) {
+    strip.come.clear();
+    strip.pf.clear();
+    strip.pc.clear();
+    strip.ps.clear();
+  }
+  // X and Y are on the host anyway, but PHI of the particles leaving each
+  // strip must be taken off its device
+  for (unsigned int s = 0; s < strips.size(); ++s) {
+    Strip& strip = strips[s];
+    strip.leave.clear();
+    for (unsigned int k = 0; k < strip.own; ++k) {
+      if (s != owner[rowof[strip.index[k]]]) {
+        strip.leave.push_back(k);
+      }
+    }
+    if (strip.leave.empty()) {
+      continue;
+    }
+    strip.cl->take(strip.leave, pf, pc, ps);
+    for (unsigned int j = 0; j < strip.leave.size(); ++j) {
+      g = strip.index[strip.leave[j]];
+      Strip& to = strips[owner[rowof[g]]];
+      to.come.push_back(g);
+      to.pf.push_back(pf[j]);
+      to.pc.push_back(pc[j]);
+      to.ps.push_back(ps[j]);
+    }
+  }
+
+  // those staying behind the new end of each strip fill the slots of those
+  // leaving before it, and those entering are placed behind
+  for (Strip& strip : strips) {
+    own = strip.own - strip.leave.size();
+    holes.clear();
+    moved.clear();
+    gone = std::lower_bound(strip.leave.begin(), strip.leave.end(),
+                            static_cast<int>(own));
+    holes.assign(strip.leave.begin(), gone);
+    for (unsigned int k = own; k < strip.own; ++k) {
+      if (strip.leave.end() != gone && static_cast<int>(k) == *gone) {
+        ++gone;
+        continue;
+      }
+      moved.push_back(k);
+    }
+    strip.cl->pack(holes, moved);
+    for (unsigned int j = 0; j < holes.size(); ++j) {
+      strip.index[holes[j]] = strip.index[moved[j]];
+    }
+    strip.index.resize(own);
+    strip.own = own;
+    if (strip.come.empty()) {
+      continue;
+    }
+    strip.pid.resize(strip.come.size());
+    strip.px.resize(strip.come.size());
+    strip.py.resize(strip.come.size());
+    for (unsigned int j = 0; j < strip.come.size(); ++j) {
+      g = strip.come[j];
+      strip.pid[j] = state.pid_[g];
+      strip.px[j] = state.px_[g];
+      strip.py[j] = state.py_[g];
+    }
+    strip.cl->place(strip.own, strip.pid, strip.px, strip.py,
+                    strip.pf, strip.pc, strip.ps);
+    strip.index.insert(strip.index.end(), strip.come.begin(),
+                       strip.come.end());
+    strip.own += strip.come.size();
+  }
+}
+
+
+void
+Proc::strip_sync()
+{
+  State& state = this->state_;
+  int g;
+
+  for (Strip& strip : this->strips_) {
+    if (0 == strip.own) {
+      continue;
+    }
+    strip.pf.resize(strip.own);
+    strip.pc.resize(strip.own);
+    strip.ps.resize(strip.own);
+    strip.pl.resize(strip.own);
+    strip.pr.resize(strip.own);
+    strip.cl->pull(strip.own, strip.px, strip.py,
+                   strip.pf, strip.pc, strip.ps, strip.pl, strip.pr);
+    if (this->lists_) {
+      strip.cl->lists(strip.own, strip.pls, strip.pld, strip.prs, strip.prd,
+                      strip.plo, strip.pro);
+    }
+    for (unsigned int k = 0; k < strip.own; ++k) {
+      g = strip.index[k];
+      state.pf_[g] = strip.pf[k];
+      state.pc_[g] = strip.pc[k];
+      state.ps_[g] = strip.ps[k];
+      state.pl_[g] = strip.pl[k];
+      state.pr_[g] = strip.pr[k];
+    }
+  }
+  if (this->lists_) {
+    this->strip_lists();
+  }
+}
+
+
+void
+Proc::strip_lists()
+{
+  State& state = this->state_;
+  std::vector<unsigned int>& plo = state.plo_;
+  std::vector<unsigned int>& pro = state.pro_;
+  int g;
+
+  // size the lists of each particle, and place them after those before
+  plo.assign(state.num_ + 1, 0);
+  pro.assign(state.num_ + 1, 0);
+  for (Strip& strip : this->strips_) {
+    for (unsigned int k = 0; k < strip.own; ++k) {
+      g = strip.index[k];
+      plo[g + 1] = strip.plo[k + 1] - strip.plo[k];
+      pro[g + 1] = strip.pro[k + 1] - strip.pro[k];
+    }
+  }
+  for (int i = 0; i < state.num_; ++i) {
+    plo[i + 1] += plo[i];
+    pro[i + 1] += pro[i];
+  }
+  state.pls_.resize(plo[state.num_]);
+  state.pld_.resize(plo[state.num_]);
+  state.prs_.resize(pro[state.num_]);
+  state.prd_.resize(pro[state.num_]);
+
+  // neighbors are strip indices, which may be of the halo
+  for (Strip& strip : this->strips_) {
+    for (unsigned int k = 0; k < strip.own; ++k) {
+      g = strip.index[k];
+      for (unsigned int j = strip.plo[k]; j < strip.plo[k + 1]; ++j) {
+        state.pls_[plo[g] + j - strip.plo[k]] = strip.index[strip.pls[j]];
+        state.pld_[plo[g] + j - strip.plo[k]] = strip.pld[j];
+      }
+      for (unsigned int j = strip.pro[k]; j < strip.pro[k + 1]; ++j) {
+        state.prs_[pro[g] + j - strip.pro[k]] = strip.index[strip.prs[j]];
+        state.prd_[pro[g] + j - strip.pro[k]] = strip.prd[j];
+      }
+    }
+  }
+}
+
+
+void
+Proc::land()
+{
+  State& state = this->state_;
+  Flight& flight = this->flights_[this->flying_.front()];
+
+  flight.done.wait();
+  this->flying_.pop_front();
+  // the old vectors of State are downloaded into next time
+  state.pn_.swap(flight.pn);
+  state.pan_.swap(flight.pan);
+  if (!this->cl_shared_) {
+    state.px_.swap(flight.px);
+    state.py_.swap(flight.py);
+  }
+}
 
 
 void
+Proc::cl_ensemble(Cl& cl, std::vector<Proc*>& procs,
+                  const std::vector<bool>& cleared)
+{
+  const unsigned int worlds = procs.size();
+  Batch& batch = procs.front()->batch_;
+  unsigned int n = 0;
+  int start;
+  int end;
+  float* f;
+  unsigned int* u;
+
+  // reuse the vectors of the last tick, which are the same size but for
+  // worlds whose number of particles changed
+  batch.wstart.resize(worlds + 1);
+  batch.wf.resize(Cl::ensemble_floats * worlds);
+  batch.wu.resize(Cl::ensemble_uints * worlds);
+  batch.pw.clear();
+  batch.pid.clear();
+  batch.px.clear();
+  batch.py.clear();
+  batch.pf.clear();
+  batch.pc.clear();
+  batch.ps.clear();
+
+  // world after world, each with its own parameters and random numbers
+  for (unsigned int w = 0; w < worlds; ++w) {
+    Proc& proc = *procs[w];
+    State& state = proc.state_;
+    if (!cleared[w]) {
+      proc.clear();
+    }
+    ++proc.tick_;
+    batch.wstart[w] = n;
+    n += state.num_;
+    f = &batch.wf[Cl::ensemble_floats * w];
+    f[0] = state.width_;
+    f[1] = state.height_;
+    f[2] = state.scope_squared_;
+    f[3] = state.ascope_squared_;
+    f[4] = state.alpha_;
+    f[5] = state.beta_;
+    f[6] = state.speed_;
+    f[7] = proc.noise();
+    f[8] = proc.each_noise_ ? state.noise_ : 0.0f;
+    u = &batch.wu[Cl::ensemble_uints * w];
+    u[0] = static_cast<unsigned int>(Rng::stream(RngStream::Noise,
+                                                 proc.world_));
+    u[1] = static_cast<unsigned int>(proc.tick_);
+    u[2] = static_cast<unsigned int>(proc.tick_ >> 32);
+    batch.pw.insert(batch.pw.end(), state.num_, w);
+    batch.pid.insert(batch.pid.end(), state.pid_.begin(), state.pid_.end());
+    batch.px.insert(batch.px.end(), state.px_.begin(), state.px_.end());
+    batch.py.insert(batch.py.end(), state.py_.begin(), state.py_.end());
+    batch.pf.insert(batch.pf.end(), state.pf_.begin(), state.pf_.end());
+    batch.pc.insert(batch.pc.end(), state.pc_.begin(), state.pc_.end());
+    batch.ps.insert(batch.ps.end(), state.ps_.begin(), state.ps_.end());
+  }
+  batch.wstart[worlds] = n;
+  batch.pn.resize(n);
+  batch.pan.resize(n);
+  batch.pl.resize(n);
+  batch.pr.resize(n);
+
+  cl.ensemble(worlds, batch.wstart, batch.wf, batch.wu, batch.pw, batch.pid,
+              batch.px, batch.py, batch.pf, batch.pc, batch.ps,
+              batch.pn, batch.pan, batch.pl, batch.pr);
+
+  for (unsigned int w = 0; w < worlds; ++w) {
+    Proc& proc = *procs[w];
+    State& state = proc.state_;
+    start = batch.wstart[w];
+    end = batch.wstart[w + 1];
+    std::copy(batch.px.begin() + start, batch.px.begin() + end,
+              state.px_.begin());
+    std::copy(batch.py.begin() + start, batch.py.begin() + end,
+              state.py_.begin());
+    std::copy(batch.pf.begin() + start, batch.pf.begin() + end,
+              state.pf_.begin());
+    std::copy(batch.pc.begin() + start, batch.pc.begin() + end,
+              state.pc_.begin());
+    std::copy(batch.ps.begin() + start, batch.ps.begin() + end,
+              state.ps_.begin());
+    std::copy(batch.pn.begin() + start, batch.pn.begin() + end,
+              state.pn_.begin());
+    std::copy(batch.pan.begin() + start, batch.pan.begin() + end,
+              state.pan_.begin());
+    std::copy(batch.pl.begin() + start, batch.pl.begin() + end,
+              state.pl_.begin());
+    std::copy(batch.pr.begin() + start, batch.pr.begin() + end,
+              state.pr_.begin());
+    proc.notify(Issue::ProcNextDone); // Views react
+  }
+}
+
+#endif /* CL_ENABLED */
+
+
+template <typename Tally> void
 Proc::plain_seek(unsigned int scope, std::vector<int>& grid,
-                 int& cols, int& rows, unsigned int& stride,
-                 void (Proc::*tally)(int,int,float,float,float))
+                 std::vector<int>& gstart, int& cols, int& rows,
+                 Tally tally)
 {
   State& state = this->state_;
   unsigned int num = state.num_;
@@ -215,143 +1088,438 @@ Proc::plain_seek(unsigned int scope, std::vector<int>& grid,
   unsigned int scopesq = scope * scope;
   // scopesq is int because scope needs to be int for plotting anyway
 
-  this->plot(scope, grid, cols, rows, stride);
+  this->plot(scope, grid, gstart, cols, rows);
+  this->halo(grid, gstart, cols, rows, this->halo_);
 
   // for each particle index
   for (int srci = 0; srci < num; ++srci) {
-    this->plain_seek_vicinity(scopesq, grid, stride, gcol[srci], grow[srci],
-                              cols, rows, srci, tally);
+    this->plain_seek_vicinity(scopesq, this->halo_, gcol[srci], grow[srci],
+                              srci, tally);
   }
   for (int i = 0; i < num; ++i) {
     state.pn_[i] = state.pl_[i] + state.pr_[i];
   }
+  if (Tally::lists) {
+    this->list();
+  }
 }
 
 
 void
-Proc::plain_seek_vicinity(unsigned int scopesq, std::vector<int>& grid,
-                          unsigned int gstride,
-                          int col, int row, int cols, int rows, int srci,
-                          void (Proc::*tally)(int,int,float,float,float))
-{
-  // recognise the vicinity (with edge wrapping)
-  int c = col - 1;
-  int cc = col + 1;
-  int r = row - 1;
-  int rr = row + 1;
-  bool cunder = false;
-  bool cover = false;
-  bool runder = false;
-  bool rover = false;
-  if      (col == 0)        { cunder = true; c = cols - 1; }
-  else if (col == cols - 1) { cover  = true; cc = 0; }
-  if      (row == 0)        { runder = true; r = rows - 1; }
-  else if (row == rows - 1) { rover  = true; rr = 0; }
-  // NOTE 1: World origin is southwest, so top-bottom order is reversed. This
-  //         does not affect any core calculations, but helps us match up
-  //         with the flattened grid generated by plot().
-  // NOTE 2: Size is 3x3(# units) * 6(col,row,col_under/over,row_under/over).
-  int vic[54] = {/* sw */ c,   r,   cunder, false, runder, false,
-                 /* s  */ col, r,   false,  false, runder, false,
-                 /* se */ cc,  r,   false,  cover, runder, false,
-                 /* w  */ c,   row, cunder, false, false,  false,
-                 /* c  */ col, row, false,  false, false,  false,
-                 /* e  */ cc,  row, false,  cover, false,  false,
-                 /* nw */ c,   rr,  cunder, false, false,  rover,
-                 /* n  */ col, rr,  false,  false, false,  rover,
-                 /* ne */ cc,  rr,  false,  cover, false,  rover};
-  unsigned int stride;
+Proc::plain_seek(unsigned int scope, std::vector<int>& grid,
+                 std::vector<int>& gstart, int& cols, int& rows,
+                 void (Proc::*tally)(int,int,float,float,float))
+{
+  if (&Proc::tally_neighborhood == tally) {
+    this->plain_seek(scope, grid, gstart, cols, rows,
+                     TallyNeighborhood(*this));
+  } else if (&Proc::tally_neighbors == tally) {
+    this->plain_seek(scope, grid, gstart, cols, rows, TallyNeighbors(*this));
+  } else if (&Proc::tally_alt == tally) {
+    this->plain_seek(scope, grid, gstart, cols, rows, TallyAlt(*this));
+  } else if (&Proc::tally_counts == tally) {
+    this->plain_seek(scope, grid, gstart, cols, rows, TallyCounts(*this));
+  } else {
+    this->plain_seek(scope, grid, gstart, cols, rows,
+                     TallyFunction(*this, tally));
+  }
+}
+
+
+template <typename Tally> void
+Proc::plain_seek_vicinity(unsigned int scopesq, Halo& halo,
+                          int col, int row, int srci, Tally& tally)
+{
+  std::vector<int>& index = halo.index;
+  std::vector<float>& x = halo.x;
+  std::vector<float>& y = halo.y;
+  std::vector<float>& offx = halo.offx;
+  std::vector<float>& offy = halo.offy;
+  float srcx = this->state_.px_[srci];
+  float srcy = this->state_.py_[srci];
+  float dx;
+  float dy;
+  float distsq;
   int dsti;
+  // NOTE: World origin is southwest, so top-bottom order is reversed. Src
+  //       is in halo unit (col + 1, row + 1), so that the particles after
+  //       src in its own unit and the e unit make up one range, and the nw,
+  //       n and ne units make up another.
+  unsigned int unit = (halo.cols * (row + 1)) + col + 1;
+  int from[2] = {halo.pos[srci] + 1, halo.start[unit + halo.cols - 1]};
+  int to[2] = {halo.start[unit + 2], halo.start[unit + halo.cols + 2]};
 
-  // for every unit in the vicinity (neighborhood)
-  for (unsigned int v = 0; v < 54; v += 6) {
-    stride = (cols * (vic[v + 1] * gstride)) + (vic[v] * gstride);
-    // for each particle index within the unit
-    for (unsigned int p = 0; p < gstride; ++p) {
-      dsti = grid[stride + p];
-      // avoid grid padding area (meaning no particle left in that unit)
-      if (0 > dsti) {
-        break;
+  // for each range of the forward half of the vicinity (neighborhood)
+  for (unsigned int v = 0; v < 2; ++v) {
+    for (int p = from[v]; p < to[v]; ++p) {
+      dsti = index[p];
+      // with a single grid column or row, src has ghosts of its own
+      if (srci == dsti) {
+        continue;
       }
-      // avoid redundant calculations
-      if (srci <= dsti) {
+      dx = (x[p] - srcx) + offx[p];
+      dy = (y[p] - srcy) + offy[p];
+      distsq = (dx * dx) + (dy * dy);
+      // ignore comparisons outside the vicinity scope
+      if (scopesq < distsq) {
         continue;
       }
-      this->plain_seek_tally(scopesq, srci, dsti,
-                             vic[v + 2], vic[v + 3], vic[v + 4], vic[v + 5],
-                             tally);
+      tally(srci, dsti, dx, dy, distsq);
+    }
+  }
+}
+
+
+void
+Proc::vector_seek(unsigned int scope, std::vector<int>& grid,
+                  std::vector<int>& gstart, int& cols, int& rows)
+{
+  State& state = this->state_;
+  unsigned int num = state.num_;
+  std::vector<int>& gcol = state.gcol_;
+  std::vector<int>& grow = state.grow_;
+  unsigned int scopesq = scope * scope;
+
+  // the halo holds the particles in grid order, so that the particles of
+  // each row of the vicinity can be loaded as a block
+  this->plot(scope, grid, gstart, cols, rows);
+  this->halo(grid, gstart, cols, rows, this->halo_);
+
+  // same order as in plain_seek(), so that neighbor lists come out the same
+  for (int srci = 0; srci < num; ++srci) {
+    this->vector_seek_vicinity(scopesq, this->halo_, gcol[srci], grow[srci],
+                               srci);
+  }
+  for (int i = 0; i < num; ++i) {
+    state.pn_[i] = state.pl_[i] + state.pr_[i];
+  }
+  this->list();
+}
+
+
+void
+Proc::vector_seek_vicinity(unsigned int scopesq, Halo& halo,
+                           int col, int row, int srci)
+{
+  // see plain_seek_vicinity()
+  unsigned int unit = (halo.cols * (row + 1)) + col + 1;
+
+  this->vector_seek_block(scopesq, halo, halo.pos[srci] + 1,
+                          halo.start[unit + 2], srci);
+  this->vector_seek_block(scopesq, halo, halo.start[unit + halo.cols - 1],
+                          halo.start[unit + halo.cols + 2], srci);
+}
+
+
+void
+Proc::vector_seek_block(unsigned int scopesq, Halo& halo,
+                        int from, int to, int srci)
+{
+  State& state = this->state_;
+  float srcx = state.px_[srci];
+  float srcy = state.py_[srci];
+  float srcc = state.pc_[srci];
+  float srcs = state.ps_[srci];
+  float distsq[Simd::block];
+  int count;
+  unsigned int in;
+  unsigned int srcright;
+  unsigned int dstright;
+  unsigned int b;
+
+  for (; from < to; from += count) {
+    count = std::min(to - from, static_cast<int>(Simd::block));
+    // leaving out src, see plain_seek_vicinity()
+    Simd::compare(&halo.x[from], &halo.y[from], &halo.c[from], &halo.s[from],
+                  &halo.offx[from], &halo.offy[from], &halo.index[from],
+                  count, srci, srcx, srcy, srcc, srcs, scopesq,
+                  distsq, in, srcright, dstright);
+    while (in) {
+      b = __builtin_ctz(in);
+      in &= in - 1;
+      this->tally_sides(srci, halo.index[from + b], distsq[b],
+                        (srcright >> b) & 1, (dstright >> b) & 1);
     }
   }
 }
 
 
 void
-Proc::plain_seek_tally(unsigned int scopesq, unsigned int srci, unsigned int dsti,
-                       bool cunder, bool cover, bool runder, bool rover,
-                       void (Proc::*tally)(int,int,float,float,float))
+Proc::verlet_seek()
 {
   State& state = this->state_;
+  unsigned int num = state.num_;
   std::vector<float>& px = state.px_;
   std::vector<float>& py = state.py_;
-  float srcx = px[srci];
-  float srcy = py[srci];
-  float dstx = px[dsti];
-  float dsty = py[dsti];
+  std::vector<int>& start = this->verlet_start_;
+  std::vector<int>& pairs = this->verlet_pairs_;
   float width = state.width_;
   float height = state.height_;
-  float dx = dstx - srcx;
-  if (cunder) { dx -= width; }  else if (cover) { dx += width; }
-  float dy = dsty - srcy;
-  if (runder) { dy -= height; } else if (rover) { dy += height; }
-  float distsq = (dx * dx) + (dy * dy);
-
-  // ignore comparisons outside the vicinity scope
-  if (scopesq < distsq) {
+  unsigned int scope = state.scope_;
+  unsigned int scopesq = scope * scope; // as in plain_seek()
+  float srcx;
+  float srcy;
+  float dx;
+  float dy;
+  float distsq;
+  int dsti;
+
+  if (this->verlet_stale()) {
+    this->verlet_build();
+  }
+  if (start.empty()) {
+    this->vector_seek(scope, this->grid_, this->grid_start_,
+                      this->grid_cols_, this->grid_rows_);
     return;
   }
 
-  (this->*tally)(srci, dsti, dx, dy, distsq);
+  for (int srci = 0; srci < num; ++srci) {
+    srcx = px[srci];
+    srcy = py[srci];
+    for (int p = start[srci]; p < start[srci + 1]; ++p) {
+      dsti = pairs[p];
+      dx = this->wrap(px[dsti] - srcx, width);
+      dy = this->wrap(py[dsti] - srcy, height);
+      distsq = (dx * dx) + (dy * dy);
+      if (scopesq < distsq) {
+        continue;
+      }
+      this->tally_neighborhood(srci, dsti, dx, dy, distsq);
+    }
+  }
+  for (int i = 0; i < num; ++i) {
+    state.pn_[i] = state.pl_[i] + state.pr_[i];
+  }
+  this->list();
 }
 
 
-void
-Proc::plain_move()
+bool
+Proc::verlet_stale()
 {
   State& state = this->state_;
+  unsigned int num = state.num_;
   float width = state.width_;
   float height = state.height_;
-  float alpha = state.alpha_;
-  float beta = state.beta_;
-  float speed = state.speed_;
-  float noise = Util::normal_noise(state.noise_);
+  float limit = 0.25f * this->verlet_skin_ * this->verlet_skin_;
+  float dx;
+  float dy;
+
+  if (!this->verlet_built_
+      || num != this->verlet_num_
+      || static_cast<unsigned int>(state.scope_) != this->verlet_scope_
+      || state.width_ != this->verlet_width_
+      || state.height_ != this->verlet_height_) {
+    return true;
+  }
+  if (this->verlet_start_.empty()) {
+    return false; // grid still too small
+  }
+  // lists hold as long as no particle has moved more than skin / 2
+  for (unsigned int i = 0; i < num; ++i) {
+    dx = this->wrap(state.px_[i] - this->verlet_x_[i], width);
+    dy = this->wrap(state.py_[i] - this->verlet_y_[i], height);
+    if (limit < (dx * dx) + (dy * dy)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void
+Proc::verlet_build()
+{
+  State& state = this->state_;
+  unsigned int num = state.num_;
   std::vector<float>& px = state.px_;
   std::vector<float>& py = state.py_;
-  std::vector<float>& pf = state.pf_;
-  std::vector<float>& pc = state.pc_;
-  std::vector<float>& ps = state.ps_;
+  std::vector<int>& gcol = state.gcol_;
+  std::vector<int>& grow = state.grow_;
+  std::vector<int>& grid = this->grid_;
+  std::vector<int>& gstart = this->grid_start_;
+  std::vector<int>& start = this->verlet_start_;
+  std::vector<int>& pairs = this->verlet_pairs_;
+  float width = state.width_;
+  float height = state.height_;
+  float reach = static_cast<unsigned int>(state.scope_) + this->verlet_skin_;
+  float reachsq = reach * reach;
+  int& cols = this->grid_cols_;
+  int& rows = this->grid_rows_;
+
+  this->verlet_num_ = num;
+  this->verlet_scope_ = state.scope_;
+  this->verlet_width_ = state.width_;
+  this->verlet_height_ = state.height_;
+  this->verlet_x_ = px;
+  this->verlet_y_ = py;
+  this->verlet_built_ = true;
+  start.clear();
+
+  // with less than 3 columns or rows, the vicinity would overlap itself
+  this->plot(ceil(reach), grid, gstart, cols, rows);
+  if (3 > cols || 3 > rows) {
+    return;
+  }
+
+  int col;
+  int row;
+  unsigned int unit;
+  float srcx;
+  float srcy;
+  float dx;
+  float dy;
+  int dsti;
+
+  start.resize(num + 1);
+  pairs.clear();
+  for (int srci = 0; srci < num; ++srci) {
+    start[srci] = pairs.size();
+    srcx = px[srci];
+    srcy = py[srci];
+    for (int r = grow[srci] - 1; r <= grow[srci] + 1; ++r) {
+      row = (r + rows) % rows;
+      for (int c = gcol[srci] - 1; c <= gcol[srci] + 1; ++c) {
+        col = (c + cols) % cols;
+        unit = (cols * row) + col;
+        for (int p = gstart[unit]; p < gstart[unit + 1]; ++p) {
+          dsti = grid[p];
+          // one pair per two particles, as in plain_seek()
+          if (srci <= dsti) {
+            continue;
+          }
+          dx = this->wrap(px[dsti] - srcx, width);
+          dy = this->wrap(py[dsti] - srcy, height);
+          if (reachsq >= (dx * dx) + (dy * dy)) {
+            pairs.push_back(dsti);
+          }
+        }
+      }
+    }
+  }
+  start[num] = pairs.size();
+}
+
+
+void
+Proc::thread_seek(unsigned int scope, std::vector<int>& grid,
+                  std::vector<int>& gstart, int& cols, int& rows)
+{
+  State& state = this->state_;
   std::vector<unsigned int>& pn = state.pn_;
   std::vector<unsigned int>& pl = state.pl_;
   std::vector<unsigned int>& pr = state.pr_;
-  float f;
-  float x;
-  float y;
+  unsigned int scopesq = scope * scope;
 
-  for (int i = 0; i < state.num_; ++i) {
-    f = fmod(pf[i] + alpha
-             + (beta * pn[i]
-                * Util::signum(static_cast<int>(pr[i] - pl[i]))), TAU)
-        + noise;
-    if (f < 0) { f += TAU; }
-    pf[i] = f;
-    pc[i] = cosf(f);
-    ps[i] = sinf(f);
-    x = fmod(px[i] + speed * pc[i], width);
-    if (x < 0) { x += width; }
-    px[i] = x;
-    y = fmod(py[i] + speed * ps[i], height);
-    if (y < 0) { y += height; }
-    py[i] = y;
+  this->plot(scope, grid, gstart, cols, rows);
+  this->halo(grid, gstart, cols, rows, this->halo_);
+
+  // several bands per thread, so that threads finishing sparse bands early
+  // can pick up more work
+  int c = cols;
+  int r = rows;
+  unsigned int bands = std::min(static_cast<unsigned int>(r),
+                                4 * this->pool_->size());
+  std::vector<std::vector<Pair>>& pairs = this->band_pairs_;
+
+  // every band records the pairs of its own particles, which are filled in
+  // once all counts are known
+  pairs.resize(bands);
+  this->pool_->run(bands, [&](unsigned int band) {
+    int from = r * band / bands;
+    int to = r * (band + 1) / bands;
+    unsigned int unit;
+    int srci;
+    pairs[band].clear();
+    for (int row = from; row < to; ++row) {
+      for (int col = 0; col < c; ++col) {
+        unit = (c * row) + col;
+        for (int p = gstart[unit]; p < gstart[unit + 1]; ++p) {
+          srci = grid[p];
+          this->thread_seek_vicinity(scopesq, this->halo_, col, row, srci,
+                                     pairs[band]);
+          pn[srci] = pl[srci] + pr[srci];
+        }
+      }
+    }
+  });
+  if (!this->lists_) {
+    return;
+  }
+  this->list_start();
+  this->pool_->run(bands, [&](unsigned int band) {
+    this->list_fill(pairs[band], false);
+  });
+}
+
+
+void
+Proc::thread_seek_vicinity(unsigned int scopesq, Halo& halo,
+                           int col, int row, int srci,
+                           std::vector<Pair>& pairs)
+{
+  std::vector<int>& index = halo.index;
+  std::vector<float>& x = halo.x;
+  std::vector<float>& y = halo.y;
+  std::vector<float>& offx = halo.offx;
+  std::vector<float>& offy = halo.offy;
+  float srcx = this->state_.px_[srci];
+  float srcy = this->state_.py_[srci];
+  float dx;
+  float dy;
+  float distsq;
+  int dsti;
+  // see plain_seek_vicinity()
+  unsigned int unit = (halo.cols * row) + col;
+
+  for (unsigned int r = 0; r < 3; ++r, unit += halo.cols) {
+    for (int p = halo.start[unit]; p < halo.start[unit + 3]; ++p) {
+      dsti = index[p];
+      if (srci == dsti) {
+        continue;
+      }
+      dx = (x[p] - srcx) + offx[p];
+      dy = (y[p] - srcy) + offy[p];
+      distsq = (dx * dx) + (dy * dy);
+      if (scopesq < distsq) {
+        continue;
+      }
+      this->tally_own(srci, dsti, dx, dy, distsq, pairs);
+    }
+  }
+}
+
+
+void
+Proc::plain_move()
+{
+  State& state = this->state_;
+  const unsigned int* pid = nullptr;
+
+  // without noise, the per particle draws would all be 0
+  if (this->each_noise_ && 0.0f != state.noise_) {
+    pid = state.pid_.data();
+  }
+  Simd::move(state.px_.data(), state.py_.data(), state.pf_.data(),
+             state.pc_.data(), state.ps_.data(), state.pn_.data(),
+             state.pl_.data(), state.pr_.data(), state.num_,
+             state.alpha_, state.beta_, this->noise(), pid, state.noise_,
+             Rng::stream(RngStream::Noise, this->world_), this->tick_,
+             state.speed_, state.width_, state.height_, !this->fast_move_);
+}
+
+
+float
+Proc::noise()
+{
+  float noise;
+
+  if (this->each_noise_) {
+    return 0.0f;
   }
+  Rng::normal(&noise, 1, this->state_.noise_,
+              Rng::stream(RngStream::Noise, this->world_), this->tick_);
+  return noise;
 }
 
 
@@ -361,59 +1529,66 @@ Proc::tally_neighborhood(int srci, int dsti, float dx, float dy, float distsq)
   State& state = this->state_;
   std::vector<float>& pc = state.pc_;
   std::vector<float>& ps = state.ps_;
+
+  this->tally_sides(srci, dsti, distsq,
+                    0.0f > (dx * ps[srci]) - (dy * pc[srci]),
+                    0.0f < (dx * ps[dsti]) - (dy * pc[dsti]));
+}
+
+
+void
+Proc::tally_sides(int srci, int dsti, float distsq,
+                  bool srcright, bool dstright)
+{
+  State& state = this->state_;
   std::vector<unsigned int>& pn = state.pn_;
   std::vector<unsigned int>& pl = state.pl_;
   std::vector<unsigned int>& pr = state.pr_;
-  std::vector<int>& pls = state.pls_;
-  std::vector<int>& prs = state.prs_;
-  std::vector<float>& pld = state.pld_;
-  std::vector<float>& prd = state.prd_;
-  unsigned int n_stride = state.n_stride_;
-
-  float srcc = pc[srci];
-  float srcs = ps[srci];
-  float dstc = pc[dsti];
-  float dsts = ps[dsti];
-  unsigned int srcstride = n_stride * srci;
-  unsigned int dststride = n_stride * dsti;
-  unsigned int srcl = pl[srci];
-  unsigned int srcr = pr[srci];
-  unsigned int dstl = pl[dsti];
-  unsigned int dstr = pr[dsti];
-  unsigned int srcli = srcstride + srcl;
-  unsigned int srcri = srcstride + srcr;
-  unsigned int dstli = dststride + dstl;
-  unsigned int dstri = dststride + dstr;
 
   ++pn[srci];
   ++pn[dsti];
-
-  if (0.0f > (dx * srcs) - (dy * srcc)) {
-    if (n_stride > srcr) {
-      prs[srcri] = dsti;
-      prd[srcri] = distsq;
-    }
+  // counted here rather than from the lists, as the OpenCL seek does
+  if (state.ascope_squared_ >= distsq) {
+    ++state.pan_[srci];
+    ++state.pan_[dsti];
+  }
+  if (srcright) {
     ++pr[srci];
   } else {
-    if (n_stride > srcl) {
-      pls[srcli] = dsti;
-      pld[srcli] = distsq;
-    }
     ++pl[srci];
   }
-  if (0.0f < (dx * dsts) - (dy * dstc)) {
-    if (n_stride > dstr) {
-      prs[dstri] = srci;
-      prd[dstri] = distsq;
-    }
+  if (dstright) {
     ++pr[dsti];
   } else {
-    if (n_stride > dstl) {
-      pls[dstli] = srci;
-      pld[dstli] = distsq;
-    }
     ++pl[dsti];
   }
+  if (this->lists_) {
+    this->pairs_.push_back({srci, dsti, distsq, srcright, dstright});
+  }
+}
+
+
+void
+Proc::tally_own(int srci, int dsti, float dx, float dy, float distsq,
+                std::vector<Pair>& pairs)
+{
+  State& state = this->state_;
+  // same sidedness test as for src in tally_neighborhood(); negating dx and
+  // dy is exact, so dst sees src on the same side as tally_neighborhood()
+  // would have decided for it
+  bool srcright = 0.0f > (dx * state.ps_[srci]) - (dy * state.pc_[srci]);
+
+  if (srcright) {
+    ++state.pr_[srci];
+  } else {
+    ++state.pl_[srci];
+  }
+  if (state.ascope_squared_ >= distsq) {
+    ++state.pan_[srci];
+  }
+  if (this->lists_) {
+    pairs.push_back({srci, dsti, distsq, srcright, false});
+  }
 }
 
 
@@ -431,3 +1606,52 @@ Proc::tally_neighbors(int srci, int dsti, float /* dx */, float /* dy */,
   nd[dsti].push_back(dist);
 }
 
+
+void
+Proc::tally_alt(int srci, int dsti, float /* dx */, float /* dy */,
+                float distsq)
+{
+  State& state = this->state_;
+
+  if (state.ascope_squared_ < distsq) {
+    return;
+  }
+  ++state.pan_[srci];
+  ++state.pan_[dsti];
+}
+
+
+void
+Proc::tally_counts(int srci, int dsti, float dx, float dy, float /* distsq */)
+{
+  State& state = this->state_;
+  std::vector<float>& pc = state.pc_;
+  std::vector<float>& ps = state.ps_;
+
+  // same sidedness tests as in tally_neighborhood()
+  if (0.0f > (dx * ps[srci]) - (dy * pc[srci])) {
+    ++state.pr_[srci];
+  } else {
+    ++state.pl_[srci];
+  }
+  if (0.0f < (dx * ps[dsti]) - (dy * pc[dsti])) {
+    ++state.pr_[dsti];
+  } else {
+    ++state.pl_[dsti];
+  }
+}
+
+
+// explicit instantiations of plain_seek() for the tally policies
+template void Proc::plain_seek<TallyNeighborhood>(
+  unsigned int, std::vector<int>&, std::vector<int>&, int&, int&,
+  TallyNeighborhood);
+template void Proc::plain_seek<TallyNeighbors>(
+  unsigned int, std::vector<int>&, std::vector<int>&, int&, int&,
+  TallyNeighbors);
+template void Proc::plain_seek<TallyAlt>(
+  unsigned int, std::vector<int>&, std::vector<int>&, int&, int&,
+  TallyAlt);
+template void Proc::plain_seek<TallyCounts>(
+  unsigned int, std::vector<int>&, std::vector<int>&, int&, int&,
+  TallyCounts);
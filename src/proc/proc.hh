@@ -12,14 +12,105 @@
 #pragma once
 
 #include "cl.hh"
+#include "halo.hh"
+#include "simd.hh"
 #include "../state/state.hh"
 #include "../util/log.hh"
+#include "../util/pool.hh"
+#include <deque>
+#include <memory>
 #include <unordered_map>
 
 
 class Cl;
 class State;
 
+
+/// Pair: Two particles within scope of each other, as recorded by seek until
+///       the neighbor lists are filled, see Proc::list().
+struct Pair
+{
+  int   srci;     // index of the first ("source") particle
+  int   dsti;     // index of the second ("destination") particle
+  float distsq;   // squared distance between src and dst
+  bool  srcright; // whether dst is right of src
+  bool  dstright; // whether src is right of dst
+};
+
+
+#if 1 == CL_ENABLED
+
+/// Flight: Host vectors that an OpenCL tick in flight is downloaded into,
+///         see Proc::inflight().
+struct Flight
+{
+  std::vector<unsigned int> pn;  // N
+  std::vector<unsigned int> pan; // alternative N
+  std::vector<float>        px;  // X (unless shared)
+  std::vector<float>        py;  // Y (unless shared)
+  cl::Event                 done; // event of the downloads, see Cl::move()
+};
+
+
+/// Strip: A horizontal strip of grid rows worked on by a device of its own,
+///        see Proc::split(). The particles of the strip come first, and stay
+///        on the device between ticks, followed by those of the halo, ie.
+///        the grid rows just above and below the strip, which the particles
+///        of the strip need to be seeked.
+struct Strip
+{
+  Cl*                       cl;    // device of the strip
+  std::vector<int>          index; // State index of each particle
+  unsigned int              own;   // number of particles of the strip itself
+  std::vector<int>          leave; // slots of the particles leaving
+  std::vector<int>          come;  // State index of the particles entering
+  std::vector<float>        hx;    // X of the halo
+  std::vector<float>        hy;    // Y of the halo
+  std::vector<unsigned int> pid;
+  std::vector<float>        px;
+  std::vector<float>        py;
+  std::vector<float>        pf;
+  std::vector<float>        pc;
+  std::vector<float>        ps;
+  std::vector<unsigned int> pn;
+  std::vector<unsigned int> pan;
+  std::vector<unsigned int> pl;
+  std::vector<unsigned int> pr;
+  std::vector<int>          pls;
+  std::vector<float>        pld;
+  std::vector<int>          prs;
+  std::vector<float>        prd;
+  std::vector<unsigned int> plo;
+  std::vector<unsigned int> pro;
+  cl::Event                 done; // event of the downloads, see Cl::move()
+};
+
+
+/// Batch: Host vectors that the worlds of Proc::ensemble() are packed into
+///        for a launch, one world after the other. The first world's Proc
+///        keeps them, so that they need not be reallocated every tick.
+struct Batch
+{
+  std::vector<int>          wstart; // index of the first particle of each
+                                    // world, and the number of particles
+  std::vector<float>        wf;     // float parameters of each world
+  std::vector<unsigned int> wu;     // uint parameters of each world
+  std::vector<unsigned int> pw;     // world of each particle
+  std::vector<unsigned int> pid;
+  std::vector<float>        px;
+  std::vector<float>        py;
+  std::vector<float>        pf;
+  std::vector<float>        pc;
+  std::vector<float>        ps;
+  std::vector<unsigned int> pn;
+  std::vector<unsigned int> pan;
+  std::vector<unsigned int> pl;
+  std::vector<unsigned int> pr;
+};
+
+#endif /* CL_ENABLED */
+
+
 class Proc : public Subject
 {
  public:
@@ -28,10 +119,111 @@ class Proc : public Subject
   /// \param state  State object
   /// \param cl  Cl object
   /// \param no_cl  whether user has specified disabling of OpenCL
-  Proc(Log& log, State& state, Cl& cl, bool no_cl);
+  /// \param threads  number of threads for the non-OpenCL seek
+  /// \param reorder  reorder particles in memory every that many ticks
+  ///                 (0 for never)
+  /// \param skin  skin radius of the Verlet lists (0 for not using them)
+  /// \param fast_move  whether the non-OpenCL move may approximate sine and
+  ///                   cosine, see Simd::move()
+  /// \param each_noise  whether each particle gets its own heading noise,
+  ///                    rather than all of them the same
+  Proc(Log& log, State& state, Cl& cl, bool no_cl, unsigned int threads = 1,
+       unsigned int reorder = 0, float skin = 0.0f, bool fast_move = false,
+       bool each_noise = false);
 
   /// next(): Let the system perform one action step.
-  void next();
+  /// \param cleared  whether the counts are already cleared, see
+  ///                 Exp::type_color()
+  void next(bool cleared = false);
+
+  /// sync(): Bring the particle arrays of State up to date with the OpenCL
+  ///         device, which keeps them between ticks and only hands back X, Y,
+  ///         N and the alternative N every tick. Needed before reading PHI,
+  ///         cos(PHI), sin(PHI), L, R, the neighbor lists, or X and Y if
+  ///         shared (see share()), outside of ticking (eg. inspecting or
+  ///         saving), and before changing any particle on the host. The
+  ///         neighbor lists are only pulled if lists_, see Cl::lists(). Does
+  ///         nothing without OpenCL, or if already in sync.
+  void sync();
+
+  /// touch(): Mark the particle arrays of State as changed on the host, so
+  ///          that they are uploaded to the OpenCL device before the next
+  ///          tick. See sync().
+  void touch();
+
+  /// inflight(): Let OpenCL run up to that many ticks ahead of State. Each
+  ///             tick is queued behind the last without waiting for it, and
+  ///             downloaded into its own Flight, which is only taken into
+  ///             State (by swapping) once that many later ticks are queued.
+  ///             Meanwhile, Exp and the Views work on the older tick, while
+  ///             the device works on the newer ones. X, Y, N and the
+  ///             alternative N of State thus lag that many ticks behind the
+  ///             device, until sync() lands all of them. 0 (the default)
+  ///             waits for every tick.
+  /// \param ticks  number of ticks that may be in flight
+  /// \returns  false if OpenCL is not used (and thus nothing is in flight)
+  bool inflight(unsigned int ticks);
+
+  /// ensemble(): Let several independent systems (worlds) perform one
+  ///             action step each, with every world in a single launch of
+  ///             the ensemble kernels (see Cl::ensemble()), or one after the
+  ///             other if the first Proc does not use OpenCL (see no_cl in
+  ///             Proc()). Meant for many small worlds that would not fill
+  ///             the device one at a time. The particle arrays stay on the
+  ///             host between ticks.
+  /// \param cl  Cl object
+  /// \param procs  Proc objects of the worlds, which use cl for nothing else
+  /// \param cleared  whether the counts of each world are already cleared
+  static void ensemble(Cl& cl, std::vector<Proc*>& procs,
+                       const std::vector<bool>& cleared);
+
+  /// split(): Split the world into horizontal strips of grid rows, one for
+  ///          each device, with cl_ taking the first. The particles of each
+  ///          strip stay on its device as they would on a single one (see
+  ///          sync()). Every tick, the particles that have crossed into
+  ///          another strip are handed over to its device, and each device
+  ///          is handed X and Y of its halo, ie. the boundary grid rows of
+  ///          the strips above and below (wrapping around). X and Y of every
+  ///          strip are downloaded as by a single device. The devices work
+  ///          at the same time, but neither inflight() nor share() apply.
+  /// \param cls  Cl objects of the other devices
+  /// \returns  true if split, false if OpenCL is not used or none of cls is
+  ///           good
+  bool split(const std::vector<Cl*>& cls);
+
+  /// share(): Let OpenCL write X and Y straight into an OpenGL vertex buffer
+  ///          every tick instead of handing them back, see Cl::share(). X and
+  ///          Y are then only brought up to date by sync().
+  /// \param vbo  OpenGL vertex buffer of (x, y, z) triplets, or 0 to stop
+  ///             sharing
+  /// \returns  true if shared
+  bool share(unsigned int vbo);
+
+  /// timing(): Start or stop timing the OpenCL commands of every tick, see
+  ///           Cl::timing(). Only cl_ is timed if split().
+  /// \param yesno  whether to time
+  /// \returns  false if OpenCL is not used
+  bool timing(bool yesno);
+
+  /// timings(): Thin wrapper around Cl::timings().
+  /// \returns  timing of each OpenCL command, most device time first
+  std::vector<ClTiming> timings();
+
+  /// keep_lists(): Set whether the seeks fill the neighbor lists of State,
+  ///               which nothing but inspecting particles needs. Turned on,
+  ///               the lists are filled from the next tick on, by the same
+  ///               seek as N, L and R, see listed().
+  /// \param yesno  whether to fill the neighbor lists
+  void keep_lists(bool yesno);
+
+  /// listed(): Whether the neighbor lists of State are those of the last
+  ///           seek, and so agree with N, L and R.
+  /// \returns  false if the lists are off, or were turned on since
+  inline bool
+  listed() const
+  {
+    return this->lists_ && this->lists_tick_ < this->tick_;
+  }
 
   /// done(): Pause the system and notify Views.
   inline void
@@ -42,28 +234,112 @@ class Proc : public Subject
 
   /// plot(): Prepare seek() and move() (for either OpenCL or plain versions).
   ///         Namely, call clear() and (re)generate the grid.
+  ///         The grid is a cell list built by counting sort: the particle
+  ///         indices of grid unit u are grid[gstart[u]] to
+  ///         grid[gstart[u + 1] - 1]. Both vectors are reused, so they are
+  ///         not reallocated unless the system grows.
   /// \param scope  integer divisor of grid
-  /// \param grid  reference to flat grid
+  /// \param grid  reference to particle indices ordered by grid unit
+  /// \param gstart  reference to offsets of each grid unit into grid
   /// \param cols  reference to number of columns in grid
   /// \param rows  reference to number of rows in grid
-  /// \param stride  reference stride (largest grid unit) of grid
-  void plot(unsigned int scope, std::vector<int>& grid, int& cols, int& rows,
-            unsigned int& stride);
+  void plot(unsigned int scope, std::vector<int>& grid,
+            std::vector<int>& gstart, int& cols, int& rows);
+
+  /// halo(): Surround a grid generated by plot() with a halo of ghost grid
+  ///         units, which hold copies of the grid units at the opposite
+  ///         edges, together with the offsets that wrap them across. Grid
+  ///         unit (col, row) becomes halo unit (col + 1, row + 1), so that
+  ///         its vicinity is the three contiguous ranges
+  ///         start[cols * (row + r) + col] to start[cols * (row + r) + col
+  ///         + 3] for r = 0, 1, 2 (cols being the halo's), without any edge
+  ///         wrapping checks. The particle parameters are copied alongside,
+  ///         so that they can be read in order, and padded with
+  ///         Simd::pad entries at the end. Where each particle itself (not
+  ///         a ghost of it) ended up is kept in pos. The vectors of halo are
+  ///         reused.
+  /// \param grid  particle indices ordered by grid unit
+  /// \param gstart  offsets of each grid unit into grid
+  /// \param cols  number of columns in grid
+  /// \param rows  number of rows in grid
+  /// \param halo  reference to the grid with a halo
+  void halo(std::vector<int>& grid, std::vector<int>& gstart,
+            int cols, int rows, Halo& halo);
+
+  /// reorder(): Sort the particles in memory by grid unit, so that seeking
+  ///            walks through memory mostly in order. Particles keep their
+  ///            IDs (see State::pid_).
+  void reorder();
 
   /// plain_seek(): Non-OpenCL version of seek.
   ///               Entry point of seeking. Also used by Exp.
+  ///               Every pair of particles within scope is handed to a tally
+  ///               policy (see tally.hh), which is a template parameter so
+  ///               that it gets inlined into the loop. Instantiated for the
+  ///               policies in tally.hh. The neighbor lists are filled
+  ///               afterwards if the policy records pairs and lists_ is
+  ///               set.
+  /// \param scope  integer divisor of grid
+  /// \param grid  reference to particle indices ordered by grid unit
+  /// \param gstart  reference to offsets of each grid unit into grid
+  /// \param cols  reference to number of columns in grid
+  /// \param rows  reference to number of rows in grid
+  /// \param tally  tally policy
+  template <typename Tally>
+  void plain_seek(unsigned int scope, std::vector<int>& grid,
+                  std::vector<int>& gstart, int& cols, int& rows,
+                  Tally tally);
+
+  /// plain_seek(): Version of plain_seek() taking a tallying function, which
+  ///               is mapped onto its tally policy where there is one.
   /// \param scope  integer divisor of grid
-  /// \param grid  reference to flat grid
+  /// \param grid  reference to particle indices ordered by grid unit
+  /// \param gstart  reference to offsets of each grid unit into grid
   /// \param cols  reference to number of columns in grid
   /// \param rows  reference to number of rows in grid
-  /// \param stride  reference stride (largest grid unit) of grid
   /// \param tally  pointer to tallying function
   void plain_seek(unsigned int scope, std::vector<int>& grid,
-                  int& cols, int& rows, unsigned int& stride,
+                  std::vector<int>& gstart, int& cols, int& rows,
                   void (Proc::*tally)(int,int,float,float,float));
 
-  /// tally_neighborhood(): Update N, L, R, and related data structures of the
-  ///                       two particles being compared.
+  /// thread_seek(): Threaded non-OpenCL version of seek.
+  ///                The grid rows are split into bands that are processed by
+  ///                the worker pool, and every particle tallies only its own
+  ///                neighborhood, so that no two threads write to the same
+  ///                particle. N, L, R come out the same as in plain_seek().
+  /// \param scope  integer divisor of grid
+  /// \param grid  reference to particle indices ordered by grid unit
+  /// \param gstart  reference to offsets of each grid unit into grid
+  /// \param cols  reference to number of columns in grid
+  /// \param rows  reference to number of rows in grid
+  void thread_seek(unsigned int scope, std::vector<int>& grid,
+                   std::vector<int>& gstart, int& cols, int& rows);
+
+  /// vector_seek(): Vectorised non-OpenCL version of seek.
+  ///                Like plain_seek() with tally_neighborhood(), but src is
+  ///                compared to the particles of each grid unit in blocks by
+  ///                Simd::compare(). N, L, R and the neighbor lists come out
+  ///                the same as in plain_seek().
+  /// \param scope  integer divisor of grid
+  /// \param grid  reference to particle indices ordered by grid unit
+  /// \param gstart  reference to offsets of each grid unit into grid
+  /// \param cols  reference to number of columns in grid
+  /// \param rows  reference to number of rows in grid
+  void vector_seek(unsigned int scope, std::vector<int>& grid,
+                   std::vector<int>& gstart, int& cols, int& rows);
+
+  /// verlet_seek(): Non-OpenCL version of seek using Verlet lists.
+  ///                The pairs of particles within scope + skin of each other
+  ///                are listed, and the lists are reused until a particle
+  ///                has moved more than skin / 2, so that in between only the
+  ///                listed pairs are compared. N, L, R come out the same as
+  ///                in plain_seek(). Falls back to vector_seek() if the grid
+  ///                is too small (less than 3x3 units of scope + skin).
+  void verlet_seek();
+
+  /// tally_neighborhood(): Update N, L, R and the alternative N of the two
+  ///                       particles being compared, and record them as a
+  ///                       pair for the neighbor lists (if lists_).
   ///                       Also used by Exp.
   /// \param srci  index of the first ("source") particle
   /// \param dsti  index of the second ("destination") particle
@@ -82,68 +358,274 @@ class Proc : public Subject
   /// \param distsq  squared distance between src and dst
   void tally_neighbors(int srci, int dsti, float dx, float dy, float distsq);
 
+  /// tally_alt(): Update the alternative N of the two particles being
+  ///              compared, if they are within the alternative vicinity
+  ///              radius of each other.
+  /// \param srci  index of the first ("source") particle
+  /// \param dsti  index of the second ("destination") particle
+  /// \param dx  x difference between src and dst
+  /// \param dy  y difference between src and dst
+  /// \param distsq  squared distance between src and dst
+  void tally_alt(int srci, int dsti, float dx, float dy, float distsq);
+
+  /// tally_counts(): Update only N, L, R of the two particles being
+  ///                 compared, leaving out the neighbor lists.
+  /// \param srci  index of the first ("source") particle
+  /// \param dsti  index of the second ("destination") particle
+  /// \param dx  x difference between src and dst
+  /// \param dy  y difference between src and dst
+  /// \param distsq  squared distance between src and dst
+  void tally_counts(int srci, int dsti, float dx, float dy, float distsq);
+
   State& state_;
   bool   cl_good_; // retain value of Cl::good()
+  bool   lists_;   // whether the seeks fill the neighbor lists (only
+                   // inspected by Gui), see keep_lists()
+  unsigned int world_; // world of an Ensemble, whose random numbers are
+                       // its own (see Rng::stream()), or 0
   std::unordered_map<int,std::vector<int>> neighbors_sets_;    // used by Exp
   std::unordered_map<int,std::vector<float>> neighbors_dists_; // used by Exp
 
  private:
-  /// clear(): Clear out seek data. Namely, reinitialise N, L, R, and related
-  ///          data structures.
+  /// clear(): Clear out seek data. Namely, reinitialise N, L, R, and the
+  ///          alternative N. The neighbor lists are replaced by the next
+  ///          list() anyway.
   void clear();
 
+  /// dims(): Size the grid generated by plot(), so that its units are at
+  ///         least scope wide and high.
+  /// \param scope  integer divisor of grid
+  /// \param cols  reference to number of columns in grid
+  /// \param rows  reference to number of rows in grid
+  void dims(unsigned int scope, int& cols, int& rows);
+
+  /// list(): Fill the neighbor lists from the pairs recorded by seek, in
+  ///         two passes over the particles: the lists are sized from the
+  ///         counts L and R, each particle's lists being placed after those
+  ///         of the particles before it (see list_start()), and then the
+  ///         pairs are copied into them in recorded order (see list_fill()).
+  ///         The recorded pairs are dropped afterwards. When lists_ is
+  ///         off, seek records no pairs and list() returns without doing
+  ///         anything.
+  void list();
+
+  /// list_start(): Size the neighbor lists to hold L and R entries for each
+  ///               particle, and set their offsets to the sums of L and R of
+  ///               the particles before.
+  void list_start();
+
+  /// list_fill(): Copy recorded pairs into the neighbor lists sized by
+  ///              list_start(), behind the entries copied before. Different
+  ///              threads may fill in pairs of different source particles.
+  /// \param pairs  recorded pairs
+  /// \param both  whether to fill in dst too, or only src
+  void list_fill(std::vector<Pair>& pairs, bool both);
+
 #if 1 == CL_ENABLED
 
   /// seek(): Entry point for OpenCL version of seek.
-  ///         Calculate new N, L, R (seek data) for each particle.
-  void seek();
+  ///         Calculate new N, L, R (seek data) for each particle. The grid
+  ///         is generated on the device, see Cl::plot().
+  /// \param pn  N particle parameter vector to download into
+  /// \param pan  alternative N particle parameter vector to download into
+  void seek(std::vector<unsigned int>& pn, std::vector<unsigned int>& pan);
 
   /// move(): Entry point for OpenCL version of move.
   ///         Update to new X, Y, PHI (move data) for each particle.
-  void move();
+  /// \param px  X particle parameter vector to download into
+  /// \param py  Y particle parameter vector to download into
+  /// \param done  event of the downloads, or nullptr to block, see
+  ///              Cl::move()
+  void move(std::vector<float>& px, std::vector<float>& py,
+            cl::Event* done = nullptr);
+
+  /// launch(): Queue a tick into the next Flight, and land the oldest one if
+  ///           more than inflight_ are then in flight. See inflight().
+  void launch();
+
+  /// land(): Wait for the oldest tick in flight, and take it into State.
+  void land();
+
+  /// cl_ensemble(): OpenCL version of ensemble().
+  /// \param cl  Cl object
+  /// \param procs  Proc objects of the worlds
+  /// \param cleared  whether the counts of each world are already cleared
+  static void cl_ensemble(Cl& cl, std::vector<Proc*>& procs,
+                          const std::vector<bool>& cleared);
+
+  /// strip_next(): OpenCL tick split across strips_, see split(). Each
+  ///               particle belongs to the strip of its grid row as
+  ///               Cl::plot() works it out.
+  void strip_next();
+
+  /// strip_deal(): Upload the particles of State to the devices of their
+  ///               strips, see strip_next().
+  void strip_deal();
+
+  /// strip_trade(): Hand the particles that have crossed into another strip
+  ///                over to its device, see strip_next().
+  void strip_trade();
+
+  /// strip_sync(): sync() for strips_.
+  void strip_sync();
+
+  /// strip_lists(): Put the neighbor lists of every strip together into
+  ///                those of State, see strip_next().
+  void strip_lists();
 
 #endif /* CL_ENABLED */
 
   /// plain_seek_vicinity(): For the non-OpenCL version of seek.
-  ///                        Iterate through every other particle in the
+  ///                        Iterate through the forward half of the
   ///                        vicinity, ie. the 3x3 neighboring subset of the
-  ///                        grid centered around src.
+  ///                        grid centered around src, and tally the
+  ///                        particles within scope. The forward half is the
+  ///                        particles after src in its own grid unit, and
+  ///                        the e, nw, n and ne grid units, so that every
+  ///                        pair of particles is compared once.
   /// \param scopesq  squared grid divisor
-  /// \param grid  flat vector representing the grid
-  /// \param stride  stride between each grid unit
-  /// \param col  grid columns vector
-  /// \param row  grid rows vector
-  /// \param cols  number of grid columns
-  /// \param rows  number of grid rows
+  /// \param halo  grid with a halo, see halo()
+  /// \param col  grid column of src
+  /// \param row  grid row of src
   /// \param srci  index of the source particle
-  /// \param tally  pointer to tallying function
-  void plain_seek_vicinity(unsigned int scopesq, std::vector<int>& grid,
-                           unsigned int gstride,
-                           int col, int row, int cols, int rows, int srci,
-                           void (Proc::*tally)(int,int,float,float,float));
+  /// \param tally  tally policy
+  template <typename Tally>
+  void plain_seek_vicinity(unsigned int scopesq, Halo& halo,
+                           int col, int row, int srci, Tally& tally);
+
+  /// thread_seek_vicinity(): For the threaded non-OpenCL version of seek.
+  ///                         Like plain_seek_vicinity(), but every other
+  ///                         particle in the whole vicinity is compared, and
+  ///                         only src is tallied.
+  /// \param scopesq  squared grid divisor
+  /// \param halo  grid with a halo, see halo()
+  /// \param col  grid column of src
+  /// \param row  grid row of src
+  /// \param srci  index of the source particle
+  /// \param pairs  reference to the pairs recorded by the calling thread
+  void thread_seek_vicinity(unsigned int scopesq, Halo& halo,
+                            int col, int row, int srci,
+                            std::vector<Pair>& pairs);
+
+  /// vector_seek_vicinity(): For the vectorised non-OpenCL version of seek.
+  ///                         Like plain_seek_vicinity(), but goes through
+  ///                         the vicinity in blocks.
+  /// \param scopesq  squared grid divisor
+  /// \param halo  grid with a halo, see halo()
+  /// \param col  grid column of src
+  /// \param row  grid row of src
+  /// \param srci  index of the source particle
+  void vector_seek_vicinity(unsigned int scopesq, Halo& halo,
+                            int col, int row, int srci);
 
-  /// plain_seek_tally(): For the non-OpenCL version of seek.
+  /// vector_seek_block(): For the vectorised non-OpenCL version of seek.
+  ///                      Compare src to a range of particles of the halo.
   /// \param scopesq  squared grid divisor
+  /// \param halo  grid with a halo, see halo()
+  /// \param from  start of the range in halo
+  /// \param to  end of the range in halo
+  /// \param srci  index of the source particle
+  void vector_seek_block(unsigned int scopesq, Halo& halo,
+                         int from, int to, int srci);
+
+  /// verlet_stale(): Whether the Verlet lists need to be rebuilt.
+  /// \returns  true if the Verlet lists need to be rebuilt
+  bool verlet_stale();
+
+  /// verlet_build(): Rebuild the Verlet lists. They are left empty if the
+  ///                 grid is too small for them.
+  void verlet_build();
+
+  /// wrap(): Shortest difference between two coordinates in the wrapping
+  ///         space. For particles within scope, this is the same difference
+  ///         that plain_seek_vicinity() gets by wrapping across grid edges.
+  /// \param d  difference between two coordinates
+  /// \param size  width or height of space
+  /// \returns  shortest difference
+  inline float
+  wrap(float d, float size)
+  {
+    if      (d >  0.5f * size) { d -= size; }
+    else if (d < -0.5f * size) { d += size; }
+    return d;
+  }
+
+  /// tally_sides(): Update N, L, R and the alternative N of the two particles
+  ///                being compared, given on which side of each other they
+  ///                are, and record them as a pair for list() (if lists_).
+  ///                Used by tally_neighborhood() and vector_seek().
+  /// \param srci  index of the first ("source") particle
+  /// \param dsti  index of the second ("destination") particle
+  /// \param distsq  squared distance between src and dst
+  /// \param srcright  whether dst is right of src
+  /// \param dstright  whether src is right of dst
+  void tally_sides(int srci, int dsti, float distsq,
+                   bool srcright, bool dstright);
+
+  /// tally_own(): Update L, R and the alternative N of only the source
+  ///              particle, and record the pair for list_fill() (if lists_).
+  ///              Used by thread_seek().
   /// \param srci  index of the source particle
   /// \param dsti  index of the destination particle
-  /// \param cunder  whether the column is underflowing
-  /// \param cover  whether the column is overflowing
-  /// \param runder  whether the row is underflowing
-  /// \param rover  whether the row is overflowing
-  /// \param tally  pointer to tallying function
-  void plain_seek_tally(unsigned int scopesq,
-                        unsigned int srci, unsigned int dsti,
-                        bool cunder, bool cover, bool runder, bool rover,
-                        void (Proc::*tally)(int,int,float,float,float));
+  /// \param dx  x difference between src and dst
+  /// \param dy  y difference between src and dst
+  /// \param distsq  squared distance between src and dst
+  /// \param pairs  reference to the pairs recorded by the calling thread
+  void tally_own(int srci, int dsti, float dx, float dy, float distsq,
+                 std::vector<Pair>& pairs);
+
+  /// noise(): Heading noise of the current tick, the same for every
+  ///          particle (0 if each_noise_). Drawn from the Noise stream at
+  ///          tick_.
+  /// \returns  normally distributed heading noise (radians)
+  float noise();
 
   /// plain_move(): Non-OpenCL version of move.
-  ///               Update X, Y, PHI of every particle.
+  ///               Update X, Y, PHI of every particle, in blocks by
+  ///               Simd::move(). If each_noise_, the heading noise of every
+  ///               particle is drawn there from its stable ID, so that
+  ///               reorder() leaves it be.
   void plain_move();
 
   Cl&              cl_; // NOTE: if a pointer instead, clCreateBuffer fails
-  std::vector<int> grid_;        // flat vector of the vicinity overlay grid
+  std::vector<int> grid_;        // particle indices ordered by grid unit
+  std::vector<int> grid_start_;  // offsets of each grid unit into grid_
   int              grid_cols_;   // number of grid columns
   int              grid_rows_;   // number of grid rows
-  unsigned int     grid_stride_; // size of a flattened grid unit
+  std::unique_ptr<Pool> pool_;   // worker threads for thread_seek()
+  Halo             halo_;        // grid_ with a halo, see halo()
+  std::vector<Pair> pairs_;      // pairs recorded by tally_sides()
+  std::vector<std::vector<Pair>> band_pairs_; // pairs per thread_seek() band
+  std::vector<unsigned int> list_l_; // next free entry of each L list
+  std::vector<unsigned int> list_r_; // next free entry of each R list
+  unsigned int     reorder_;     // ticks between reorder() calls (0: never)
+  unsigned int     reorder_tick_; // ticks since last reorder() call
+  float            verlet_skin_;  // skin radius of Verlet lists (0: off)
+  bool             verlet_built_; // false if Verlet lists must be rebuilt
+  std::vector<int> verlet_start_; // offsets of each particle's pairs
+  std::vector<int> verlet_pairs_; // lower particle indices of pairs
+  std::vector<float> verlet_x_;   // X parameters at last build
+  std::vector<float> verlet_y_;   // Y parameters at last build
+  unsigned int     verlet_num_;   // # particles at last build
+  unsigned int     verlet_scope_; // vicinity radius at last build
+  unsigned int     verlet_width_; // space width at last build
+  unsigned int     verlet_height_; // space height at last build
+  bool             fast_move_;    // whether plain_move() may approximate
+  bool             each_noise_;   // whether noise is drawn per particle
+  unsigned long long tick_;       // ticks so far, keying random numbers
+  unsigned long long lists_tick_; // tick_ when lists_ was turned on
+  bool             cl_pushed_;    // whether the device has State's particles
+  bool             cl_synced_;    // whether State has the device's particles
+  bool             cl_shared_;    // whether X and Y go to a vertex buffer
+  unsigned int     inflight_;     // max ticks in flight, see inflight()
+#if 1 == CL_ENABLED
+  std::vector<Flight> flights_;   // inflight_ + 1 Flights, used in turn
+  std::deque<unsigned int> flying_; // Flights in flight, oldest first
+  unsigned int     flight_;       // next Flight to launch into
+  std::vector<Strip> strips_;     // strips of the world, see split()
+  std::vector<unsigned int> strip_of_row_; // strip of each grid row
+  std::vector<int> strip_row_;    // grid row of each particle
+  Batch            batch_;        // worlds packed by ensemble()
+#endif /* CL_ENABLED */
 };
 
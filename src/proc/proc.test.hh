@@ -1,4 +1,6 @@
 #include "proc.hh"
+#include "tally.hh"
+#include "../util/common.hh"
 #include "../util/util.hh"
 
 
@@ -10,14 +12,905 @@ TEST_CASE("Proc::plot")
   auto cl = Cl(log);
   auto proc = Proc(log, state, cl, false);
   auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
   int cols;
   int rows;
-  unsigned int gstride;
 
-  proc.plot(state.scope_, grid, cols, rows, gstride);
+  proc.plot(state.scope_, grid, gstart, cols, rows);
   REQUIRE(static_cast<int>(state.width_ / state.scope_) == cols);
   REQUIRE(static_cast<int>(state.height_ / state.scope_) == rows);
-  REQUIRE(0 < gstride);
-  REQUIRE(cols * rows * gstride == grid.size());
+  REQUIRE(state.num_ == grid.size());
+  REQUIRE(cols * rows + 1 == gstart.size());
+  REQUIRE(0 == gstart.front());
+  REQUIRE(state.num_ == gstart.back());
+  for (int u = 0; u < cols * rows; ++u) {
+    REQUIRE(gstart[u] <= gstart[u + 1]);
+    for (int p = gstart[u]; p < gstart[u + 1]; ++p) {
+      REQUIRE(u == cols * state.grow_[grid[p]] + state.gcol_[grid[p]]);
+      if (p > gstart[u]) {
+        REQUIRE(grid[p - 1] < grid[p]);
+      }
+    }
+  }
 }
 
+
+
+#if 1 == CL_ENABLED
+
+TEST_CASE("Cl::plot")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, false);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  auto gcol = std::vector<int>();
+  auto grow = std::vector<int>();
+  auto cl_grid = std::vector<int>();
+  auto cl_gstart = std::vector<int>();
+  auto cl_gcol = std::vector<int>();
+  auto cl_grow = std::vector<int>();
+  int cols;
+  int rows;
+
+  if (!cl.good()) {
+    WARN("no OpenCL device, skipped");
+    return;
+  }
+  proc.plot(state.scope_, grid, gstart, cols, rows);
+  gcol = state.gcol_;
+  grow = state.grow_;
+  cl.push(state.num_, state.pid_, state.px_, state.py_,
+          state.pf_, state.pc_, state.ps_);
+  cl.plot(state.num_, state.width_, state.height_, cols, rows);
+  cl.grid(state.num_, cols * rows, cl_grid, cl_gstart, cl_gcol, cl_grow);
+  REQUIRE(gstart == cl_gstart);
+  REQUIRE(gcol == cl_gcol);
+  REQUIRE(grow == cl_grow);
+  // particles within a grid unit come in any order on the device
+  for (int u = 0; u < cols * rows; ++u) {
+    std::sort(cl_grid.begin() + cl_gstart[u],
+              cl_grid.begin() + cl_gstart[u + 1]);
+  }
+  REQUIRE(grid == cl_grid);
+}
+
+#endif /* CL_ENABLED */
+
+
+TEST_CASE("Proc::halo")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, false);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  auto halo = Halo();
+  int cols;
+  int rows;
+  int col;
+  int row;
+  int unit;
+  float offx;
+  float offy;
+
+  proc.plot(state.scope_, grid, gstart, cols, rows);
+  proc.halo(grid, gstart, cols, rows, halo);
+  REQUIRE(cols + 2 == halo.cols);
+  REQUIRE(rows + 2 == halo.rows);
+  REQUIRE(halo.cols * halo.rows + 1 == halo.start.size());
+  REQUIRE(0 == halo.start.front());
+  REQUIRE(halo.start.back() + Simd::pad == halo.index.size());
+  for (int hrow = 0; hrow < halo.rows; ++hrow) {
+    for (int hcol = 0; hcol < halo.cols; ++hcol) {
+      // ghost units copy the grid unit at the opposite edge
+      col = (hcol + cols - 1) % cols;
+      row = (hrow + rows - 1) % rows;
+      offx = 0 == hcol ? -1.0f * state.width_
+           : halo.cols - 1 == hcol ? 1.0f * state.width_ : 0.0f;
+      offy = 0 == hrow ? -1.0f * state.height_
+           : halo.rows - 1 == hrow ? 1.0f * state.height_ : 0.0f;
+      unit = cols * row + col;
+      int p = halo.start[halo.cols * hrow + hcol];
+      REQUIRE(gstart[unit + 1] - gstart[unit]
+              == halo.start[halo.cols * hrow + hcol + 1] - p);
+      for (int g = gstart[unit]; g < gstart[unit + 1]; ++g, ++p) {
+        REQUIRE(grid[g] == halo.index[p]);
+        REQUIRE(state.px_[grid[g]] == halo.x[p]);
+        REQUIRE(state.py_[grid[g]] == halo.y[p]);
+        REQUIRE(state.pc_[grid[g]] == halo.c[p]);
+        REQUIRE(state.ps_[grid[g]] == halo.s[p]);
+        REQUIRE(offx == halo.offx[p]);
+        REQUIRE(offy == halo.offy[p]);
+      }
+    }
+  }
+}
+
+TEST_CASE("Proc::plain_seek")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_;
+
+  proc.lists_ = true;
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  TallyNeighborhood(proc));
+  std::vector<unsigned int> pn = state.pn_;
+  std::vector<unsigned int> pl = state.pl_;
+  std::vector<unsigned int> pr = state.pr_;
+  std::vector<int> pls = state.pls_;
+  std::vector<int> prs = state.prs_;
+  std::vector<unsigned int> pan(num, 0);
+  REQUIRE(num + 1 == state.plo_.size());
+  REQUIRE(num + 1 == state.pro_.size());
+  REQUIRE(state.plo_[num] == state.pls_.size());
+  REQUIRE(state.pro_[num] == state.prs_.size());
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(pl[i] == state.plo_[i + 1] - state.plo_[i]);
+    REQUIRE(pr[i] == state.pro_[i + 1] - state.pro_[i]);
+    for (unsigned int j = state.plo_[i]; j < state.plo_[i + 1]; ++j) {
+      pan[i] += state.ascope_squared_ >= state.pld_[j];
+    }
+    for (unsigned int j = state.pro_[i]; j < state.pro_[i + 1]; ++j) {
+      pan[i] += state.ascope_squared_ >= state.prd_[j];
+    }
+  }
+  std::fill(state.pn_.begin(), state.pn_.end(), 0);
+  std::fill(state.pl_.begin(), state.pl_.end(), 0);
+  std::fill(state.pr_.begin(), state.pr_.end(), 0);
+  std::fill(state.pan_.begin(), state.pan_.end(), 0);
+
+  // counts only, through the tallying function
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  &Proc::tally_counts);
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(pn[i] == state.pn_[i]);
+    REQUIRE(pl[i] == state.pl_[i]);
+    REQUIRE(pr[i] == state.pr_[i]);
+    REQUIRE(0 == state.pan_[i]);
+  }
+  // the neighbor lists are left alone
+  REQUIRE(pls == state.pls_);
+  REQUIRE(prs == state.prs_);
+
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows, TallyAlt(proc));
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(pan[i] == state.pan_[i]);
+  }
+
+  // without the lists, the counts are still made, alternative N included
+  std::fill(state.pn_.begin(), state.pn_.end(), 0);
+  std::fill(state.pl_.begin(), state.pl_.end(), 0);
+  std::fill(state.pr_.begin(), state.pr_.end(), 0);
+  std::fill(state.pan_.begin(), state.pan_.end(), 0);
+  std::fill(state.pls_.begin(), state.pls_.end(), -1);
+  proc.lists_ = false;
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  TallyNeighborhood(proc));
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(pn[i] == state.pn_[i]);
+    REQUIRE(pl[i] == state.pl_[i]);
+    REQUIRE(pr[i] == state.pr_[i]);
+    REQUIRE(pan[i] == state.pan_[i]);
+  }
+  REQUIRE(std::vector<int>(pls.size(), -1) == state.pls_);
+  proc.lists_ = true;
+
+  // crowds are listed in full, however many neighbors there are
+  for (unsigned int i = 0; i < 150; ++i) {
+    state.px_[i] = 100.0f + 0.01f * i;
+    state.py_[i] = 100.0f;
+  }
+  std::fill(state.pn_.begin(), state.pn_.end(), 0);
+  std::fill(state.pl_.begin(), state.pl_.end(), 0);
+  std::fill(state.pr_.begin(), state.pr_.end(), 0);
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  TallyNeighborhood(proc));
+  for (unsigned int i = 0; i < 150; ++i) {
+    REQUIRE(149 <= state.pn_[i]);
+    REQUIRE(state.pl_[i] == state.plo_[i + 1] - state.plo_[i]);
+    REQUIRE(state.pr_[i] == state.pro_[i + 1] - state.pro_[i]);
+  }
+}
+
+TEST_CASE("Proc::keep_lists")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  unsigned int num = state.num_;
+
+  // the last tick kept no lists, so the next one is the first listed
+  proc.next();
+  REQUIRE(!proc.listed());
+  proc.keep_lists(true);
+  REQUIRE(!proc.listed());
+  proc.next();
+  REQUIRE(proc.listed());
+
+  // counts and lists come from the same seek
+  REQUIRE(num + 1 == state.plo_.size());
+  REQUIRE(num + 1 == state.pro_.size());
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(state.pl_[i] == state.plo_[i + 1] - state.plo_[i]);
+    REQUIRE(state.pr_[i] == state.pro_[i + 1] - state.pro_[i]);
+  }
+
+  proc.keep_lists(false);
+  REQUIRE(!proc.listed());
+}
+
+TEST_CASE("Proc::thread_seek")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto threaded = Proc(log, state, cl, true, 4);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_;
+
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  &Proc::tally_neighborhood);
+  std::vector<unsigned int> pn = state.pn_;
+  std::vector<unsigned int> pl = state.pl_;
+  std::vector<unsigned int> pr = state.pr_;
+  std::vector<unsigned int> pan = state.pan_;
+  std::fill(state.pn_.begin(), state.pn_.end(), 0);
+  std::fill(state.pl_.begin(), state.pl_.end(), 0);
+  std::fill(state.pr_.begin(), state.pr_.end(), 0);
+  std::fill(state.pan_.begin(), state.pan_.end(), 0);
+
+  threaded.thread_seek(state.scope_, grid, gstart, cols, rows);
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(pn[i] == state.pn_[i]);
+    REQUIRE(pl[i] == state.pl_[i]);
+    REQUIRE(pr[i] == state.pr_[i]);
+    REQUIRE(pan[i] == state.pan_[i]);
+  }
+}
+
+#if 1 == CL_ENABLED
+
+TEST_CASE("Cl::gather")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  auto px = std::vector<float>(state.num_);
+  auto py = std::vector<float>(state.num_);
+  auto pf = std::vector<float>(state.num_);
+  auto pc = std::vector<float>(state.num_);
+  auto ps = std::vector<float>(state.num_);
+  auto pn = std::vector<unsigned int>(state.num_);
+  auto pan = std::vector<unsigned int>(state.num_);
+  auto pl = std::vector<unsigned int>(state.num_);
+  auto pr = std::vector<unsigned int>(state.num_);
+  auto pls = std::vector<int>();
+  auto prs = std::vector<int>();
+  auto pld = std::vector<float>();
+  auto prd = std::vector<float>();
+  auto plo = std::vector<unsigned int>();
+  auto pro = std::vector<unsigned int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_;
+
+  if (!cl.good()) {
+    WARN("no OpenCL device, skipped");
+    return;
+  }
+  proc.lists_ = true;
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  &Proc::tally_neighborhood);
+  cl.push(num, state.pid_, state.px_, state.py_,
+          state.pf_, state.pc_, state.ps_);
+  cl.gather(num, state.scope_squared_, state.ascope_squared_,
+            state.width_, state.height_, cols, rows, true, pn, pan);
+  cl.pull(num, px, py, pf, pc, ps, pl, pr);
+  cl.lists(num, pls, pld, prs, prd, plo, pro);
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(state.pn_[i] == pn[i]);
+    REQUIRE(state.pl_[i] == pl[i]);
+    REQUIRE(state.pr_[i] == pr[i]);
+    REQUIRE(state.pan_[i] == pan[i]);
+    REQUIRE(pl[i] == plo[i + 1] - plo[i]);
+    REQUIRE(pr[i] == pro[i + 1] - pro[i]);
+    // neighbors come in another order on the device
+    std::vector<int> cl_l(pls.begin() + plo[i], pls.begin() + plo[i + 1]);
+    std::vector<int> cl_r(prs.begin() + pro[i], prs.begin() + pro[i + 1]);
+    std::vector<int> l(state.pls_.begin() + state.plo_[i],
+                       state.pls_.begin() + state.plo_[i + 1]);
+    std::vector<int> r(state.prs_.begin() + state.pro_[i],
+                       state.prs_.begin() + state.pro_[i + 1]);
+    std::sort(cl_l.begin(), cl_l.end());
+    std::sort(cl_r.begin(), cl_r.end());
+    std::sort(l.begin(), l.end());
+    std::sort(r.begin(), r.end());
+    REQUIRE(l == cl_l);
+    REQUIRE(r == cl_r);
+  }
+
+  std::fill(pn.begin(), pn.end(), 0);
+  std::fill(pan.begin(), pan.end(), 0);
+  cl.tile(num, state.scope_squared_, state.ascope_squared_,
+          state.width_, state.height_, cols, rows, false, pn, pan);
+  cl.pull(num, px, py, pf, pc, ps, pl, pr);
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(state.pn_[i] == pn[i]);
+    REQUIRE(state.pl_[i] == pl[i]);
+    REQUIRE(state.pr_[i] == pr[i]);
+    REQUIRE(state.pan_[i] == pan[i]);
+  }
+}
+
+
+TEST_CASE("Proc::inflight")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto px = state.px_;
+  auto py = state.py_;
+  auto pf = state.pf_;
+  auto pc = state.pc_;
+  auto ps = state.ps_;
+  std::vector<float> waited_x;
+  std::vector<float> waited_y;
+  std::vector<float> waited_f;
+  std::vector<unsigned int> waited_n;
+
+  if (!cl.good()) {
+    WARN("no OpenCL device, skipped");
+    return;
+  }
+  {
+    auto proc = Proc(log, state, cl, false);
+    for (unsigned int tick = 0; tick < 5; ++tick) {
+      proc.next();
+    }
+    proc.sync();
+  }
+  waited_x = state.px_;
+  waited_y = state.py_;
+  waited_f = state.pf_;
+  waited_n = state.pn_;
+
+  // the same ticks from the same particles, but up to 2 in flight
+  state.px_ = px;
+  state.py_ = py;
+  state.pf_ = pf;
+  state.pc_ = pc;
+  state.ps_ = ps;
+  auto proc = Proc(log, state, cl, false);
+  REQUIRE(proc.inflight(2));
+  for (unsigned int tick = 0; tick < 5; ++tick) {
+    proc.next();
+  }
+  proc.sync();
+  REQUIRE(state.px_ == waited_x);
+  REQUIRE(state.py_ == waited_y);
+  REQUIRE(state.pf_ == waited_f);
+  REQUIRE(state.pn_ == waited_n);
+}
+
+
+TEST_CASE("Proc::split")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto other = Cl(log);
+  auto px = state.px_;
+  auto py = state.py_;
+  auto pf = state.pf_;
+  auto pc = state.pc_;
+  auto ps = state.ps_;
+  std::vector<float> whole_x;
+  std::vector<float> whole_y;
+  std::vector<float> whole_f;
+  std::vector<unsigned int> whole_n;
+  std::vector<unsigned int> whole_l;
+  std::vector<Cl*> others = {&other};
+
+  if (!cl.good()) {
+    WARN("no OpenCL device, skipped");
+    return;
+  }
+  {
+    auto proc = Proc(log, state, cl, false);
+    for (unsigned int tick = 0; tick < 50; ++tick) {
+      proc.next();
+    }
+    proc.sync();
+  }
+  whole_x = state.px_;
+  whole_y = state.py_;
+  whole_f = state.pf_;
+  whole_n = state.pn_;
+  whole_l = state.pl_;
+
+  // the same ticks from the same particles, in two strips, between which
+  // particles cross on the way
+  state.px_ = px;
+  state.py_ = py;
+  state.pf_ = pf;
+  state.pc_ = pc;
+  state.ps_ = ps;
+  auto proc = Proc(log, state, cl, false);
+  REQUIRE(proc.split(others));
+  for (unsigned int tick = 0; tick < 50; ++tick) {
+    proc.next();
+  }
+  REQUIRE(state.px_ == whole_x);
+  REQUIRE(state.py_ == whole_y);
+  REQUIRE(state.pn_ == whole_n);
+  proc.sync();
+  REQUIRE(state.pf_ == whole_f);
+  REQUIRE(state.pl_ == whole_l);
+}
+
+
+TEST_CASE("Proc::ensemble")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto a = State(log, expctrl);
+  auto b = State(log, expctrl);
+  auto plain = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc_a = Proc(log, a, cl, false);
+  auto proc_b = Proc(log, b, cl, false);
+  auto proc = Proc(log, plain, cl, true);
+  std::vector<Proc*> procs = {&proc_a, &proc_b};
+  std::vector<bool> cleared = {false, false};
+  std::vector<State*> states = {&a, &b};
+  std::vector<std::vector<unsigned int>> n;
+  std::vector<std::vector<unsigned int>> an;
+  std::vector<std::vector<unsigned int>> l;
+  std::vector<std::vector<unsigned int>> r;
+
+  if (!cl.good()) {
+    WARN("no OpenCL device, skipped");
+    return;
+  }
+  // the counts of each world on its own, without OpenCL
+  proc_b.world_ = 1;
+  for (State* state : states) {
+    plain.px_ = state->px_;
+    plain.py_ = state->py_;
+    plain.pf_ = state->pf_;
+    plain.pc_ = state->pc_;
+    plain.ps_ = state->ps_;
+    proc.next();
+    n.push_back(plain.pn_);
+    an.push_back(plain.pan_);
+    l.push_back(plain.pl_);
+    r.push_back(plain.pr_);
+  }
+
+  // both worlds in one launch
+  Proc::ensemble(cl, procs, cleared);
+  for (unsigned int w = 0; w < states.size(); ++w) {
+    REQUIRE(states[w]->pn_ == n[w]);
+    REQUIRE(states[w]->pan_ == an[w]);
+    REQUIRE(states[w]->pl_ == l[w]);
+    REQUIRE(states[w]->pr_ == r[w]);
+  }
+}
+
+
+TEST_CASE("Cl::timings")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, false);
+  std::vector<ClTiming> timings;
+  float share = 0.0f;
+  bool moved = false;
+
+  if (!cl.good()) {
+    WARN("no OpenCL device, skipped");
+    return;
+  }
+  REQUIRE(proc.timing(true));
+  for (unsigned int tick = 0; tick < 5; ++tick) {
+    proc.next();
+  }
+  timings = proc.timings();
+  REQUIRE(!timings.empty());
+  for (ClTiming& timing : timings) {
+    REQUIRE(0 < timing.count);
+    REQUIRE(timing.run[0] <= timing.run[1]);
+    REQUIRE(timing.run[1] <= timing.run[2]);
+    REQUIRE(timing.wait[0] <= timing.wait[2]);
+    share += timing.share;
+    moved = moved || "particles_move" == timing.name;
+  }
+  REQUIRE(moved);
+  REQUIRE(Approx(1.0f) == share);
+  REQUIRE(timings.front().share >= timings.back().share);
+}
+
+#endif /* CL_ENABLED */
+
+
+TEST_CASE("Proc::plain_seek forward half")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto threaded = Proc(log, state, cl, true, 4);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = 200;
+  float scope = state.scope_;
+  float sizes[5][2] = {{250.0f, 250.0f},
+                       {scope, 250.0f}, {2.0f * scope, 250.0f},
+                       {250.0f, scope}, {250.0f, 2.0f * scope}};
+  std::vector<float> px = state.px_;
+  std::vector<float> py = state.py_;
+
+  proc.lists_ = true;
+  threaded.lists_ = true;
+  // narrow spaces too, where the grid has only one or two columns or rows,
+  // so that the vicinity holds ghosts of src or the same unit twice
+  state.num_ = num;
+  for (auto& size : sizes) {
+    state.width_ = size[0];
+    state.height_ = size[1];
+    for (unsigned int i = 0; i < num; ++i) {
+      state.px_[i] = fmod(px[i], size[0]);
+      state.py_[i] = fmod(py[i], size[1]);
+    }
+    std::vector<std::vector<std::pair<int,float>>> lists(num);
+    std::fill(state.pn_.begin(), state.pn_.end(), 0);
+    std::fill(state.pl_.begin(), state.pl_.end(), 0);
+    std::fill(state.pr_.begin(), state.pr_.end(), 0);
+    proc.plain_seek(scope, grid, gstart, cols, rows,
+                    &Proc::tally_neighborhood);
+    std::vector<unsigned int> pn = state.pn_;
+    std::vector<unsigned int> pl = state.pl_;
+    std::vector<unsigned int> pr = state.pr_;
+    for (unsigned int i = 0; i < num; ++i) {
+      for (unsigned int j = state.plo_[i]; j < state.plo_[i + 1]; ++j) {
+        lists[i].push_back({state.pls_[j], state.pld_[j]});
+      }
+      for (unsigned int j = state.pro_[i]; j < state.pro_[i + 1]; ++j) {
+        lists[i].push_back({-1 - state.prs_[j], state.prd_[j]});
+      }
+      std::sort(lists[i].begin(), lists[i].end());
+    }
+    std::fill(state.pn_.begin(), state.pn_.end(), 0);
+    std::fill(state.pl_.begin(), state.pl_.end(), 0);
+    std::fill(state.pr_.begin(), state.pr_.end(), 0);
+
+    // the whole vicinity of every particle, see thread_seek()
+    threaded.thread_seek(scope, grid, gstart, cols, rows);
+    for (unsigned int i = 0; i < num; ++i) {
+      REQUIRE(pn[i] == state.pn_[i]);
+      REQUIRE(pl[i] == state.pl_[i]);
+      REQUIRE(pr[i] == state.pr_[i]);
+      std::vector<std::pair<int,float>> list;
+      for (unsigned int j = state.plo_[i]; j < state.plo_[i + 1]; ++j) {
+        list.push_back({state.pls_[j], state.pld_[j]});
+      }
+      for (unsigned int j = state.pro_[i]; j < state.pro_[i + 1]; ++j) {
+        list.push_back({-1 - state.prs_[j], state.prd_[j]});
+      }
+      std::sort(list.begin(), list.end());
+      REQUIRE(lists[i] == list);
+    }
+  }
+}
+
+TEST_CASE("Proc::reorder")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_;
+
+  proc.lists_ = true;
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  &Proc::tally_neighborhood);
+  std::vector<float> px = state.px_;
+  std::vector<unsigned int> pn = state.pn_;
+  std::vector<int> pls = state.pls_;
+  std::vector<unsigned int> plo = state.plo_;
+
+  proc.reorder();
+  std::vector<unsigned int>& pid = state.pid_;
+  std::vector<unsigned int>& pidx = state.pidx_;
+  REQUIRE(num == pid.size());
+  REQUIRE(num == pidx.size());
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(i == pidx[pid[i]]);
+    REQUIRE(px[pid[i]] == state.px_[i]);
+    REQUIRE(pn[pid[i]] == state.pn_[i]);
+    REQUIRE(plo[pid[i] + 1] - plo[pid[i]]
+            == state.plo_[i + 1] - state.plo_[i]);
+    for (unsigned int j = 0; j < state.plo_[i + 1] - state.plo_[i]; ++j) {
+      int n = state.pls_[state.plo_[i] + j];
+      int old = pls[plo[pid[i]] + j];
+      REQUIRE(static_cast<int>(pid[n]) == old);
+    }
+    if (0 < i) {
+      REQUIRE(cols * state.grow_[i - 1] + state.gcol_[i - 1]
+              <= cols * state.grow_[i] + state.gcol_[i]);
+    }
+  }
+
+  std::fill(state.pn_.begin(), state.pn_.end(), 0);
+  std::fill(state.pl_.begin(), state.pl_.end(), 0);
+  std::fill(state.pr_.begin(), state.pr_.end(), 0);
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  &Proc::tally_neighborhood);
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE(pn[pid[i]] == state.pn_[i]);
+  }
+}
+
+TEST_CASE("Proc::vector_seek")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_;
+  SimdLevel best = Simd::level();
+
+  proc.lists_ = true;
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  &Proc::tally_neighborhood);
+  std::vector<unsigned int> pn = state.pn_;
+  std::vector<unsigned int> pl = state.pl_;
+  std::vector<unsigned int> pr = state.pr_;
+  std::vector<int> pls = state.pls_;
+  std::vector<int> prs = state.prs_;
+  std::vector<float> pld = state.pld_;
+
+  for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse,
+                          SimdLevel::Avx2}) {
+    Simd::level(level);
+    std::fill(state.pn_.begin(), state.pn_.end(), 0);
+    std::fill(state.pl_.begin(), state.pl_.end(), 0);
+    std::fill(state.pr_.begin(), state.pr_.end(), 0);
+    proc.vector_seek(state.scope_, grid, gstart, cols, rows);
+    for (unsigned int i = 0; i < num; ++i) {
+      REQUIRE(pn[i] == state.pn_[i]);
+      REQUIRE(pl[i] == state.pl_[i]);
+      REQUIRE(pr[i] == state.pr_[i]);
+    }
+    REQUIRE(pls == state.pls_);
+    REQUIRE(prs == state.prs_);
+    REQUIRE(pld == state.pld_);
+  }
+  Simd::level(best);
+}
+
+TEST_CASE("Proc::verlet_seek")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto verlet = Proc(log, state, cl, true, 1, 0, 2.0f);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_;
+  float w = state.width_;
+  float h = state.height_;
+
+  for (int tick = 0; tick < 10; ++tick) {
+    std::fill(state.pn_.begin(), state.pn_.end(), 0);
+    std::fill(state.pl_.begin(), state.pl_.end(), 0);
+    std::fill(state.pr_.begin(), state.pr_.end(), 0);
+    proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                    TallyNeighborhood(proc));
+    std::vector<unsigned int> pn = state.pn_;
+    std::vector<unsigned int> pl = state.pl_;
+    std::vector<unsigned int> pr = state.pr_;
+    std::fill(state.pn_.begin(), state.pn_.end(), 0);
+    std::fill(state.pl_.begin(), state.pl_.end(), 0);
+    std::fill(state.pr_.begin(), state.pr_.end(), 0);
+
+    verlet.verlet_seek();
+    for (unsigned int i = 0; i < num; ++i) {
+      REQUIRE(pn[i] == state.pn_[i]);
+      REQUIRE(pl[i] == state.pl_[i]);
+      REQUIRE(pr[i] == state.pr_[i]);
+    }
+
+    // move every particle less than the skin, across the edges too
+    for (unsigned int i = 0; i < num; ++i) {
+      state.px_[i] = fmod(state.px_[i] + 0.67f * state.pc_[i] + w, w);
+      state.py_[i] = fmod(state.py_[i] + 0.67f * state.ps_[i] + h, h);
+    }
+  }
+}
+
+TEST_CASE("Simd::move")
+{
+  auto log = Log(1, QUIET);
+  auto expctrl = ExpControl(log, 0);
+  auto state = State(log, expctrl);
+  auto cl = Cl(log);
+  auto proc = Proc(log, state, cl, true);
+  auto grid = std::vector<int>();
+  auto gstart = std::vector<int>();
+  int cols;
+  int rows;
+  unsigned int num = state.num_ - 3; // leaving a tail
+  float w = state.width_;
+  float h = state.height_;
+  SimdLevel best = Simd::level();
+
+  proc.lists_ = true;
+  proc.plain_seek(state.scope_, grid, gstart, cols, rows,
+                  TallyNeighborhood(proc));
+  // headings and positions that need more than one wrap
+  state.pn_[0] = 100;
+  state.pl_[0] = 100;
+  state.pn_[9] = 100;
+  state.pr_[9] = 100;
+  state.px_[1] = 0.0f;
+  state.px_[2] = w - 0.001f;
+  state.py_[3] = 0.0f;
+  state.py_[num - 1] = h - 0.001f;
+  std::vector<float> px = state.px_;
+  std::vector<float> py = state.py_;
+  std::vector<float> pf = state.pf_;
+
+  Simd::level(SimdLevel::Scalar);
+  Simd::move(state.px_.data(), state.py_.data(), state.pf_.data(),
+             state.pc_.data(), state.ps_.data(), state.pn_.data(),
+             state.pl_.data(), state.pr_.data(), num, state.alpha_,
+             state.beta_, 0.01f, nullptr, 0.0f, RngStream::Noise, 0,
+             state.speed_, w, h, true);
+  std::vector<float> x = state.px_;
+  std::vector<float> y = state.py_;
+  std::vector<float> f = state.pf_;
+  std::vector<float> c = state.pc_;
+  std::vector<float> s = state.ps_;
+  for (unsigned int i = 0; i < num; ++i) {
+    REQUIRE((0.0f <= x[i] && x[i] <= w));
+    REQUIRE((0.0f <= y[i] && y[i] <= h));
+  }
+
+  for (SimdLevel level : {SimdLevel::Sse, SimdLevel::Avx2}) {
+    Simd::level(level);
+    for (bool exact : {true, false}) {
+      state.px_ = px;
+      state.py_ = py;
+      state.pf_ = pf;
+      Simd::move(state.px_.data(), state.py_.data(), state.pf_.data(),
+                 state.pc_.data(), state.ps_.data(), state.pn_.data(),
+                 state.pl_.data(), state.pr_.data(), num, state.alpha_,
+                 state.beta_, 0.01f, nullptr, 0.0f, RngStream::Noise, 0,
+                 state.speed_, w, h, exact);
+      REQUIRE(f == state.pf_);
+      if (exact) {
+        REQUIRE(c == state.pc_);
+        REQUIRE(s == state.ps_);
+        REQUIRE(x == state.px_);
+        REQUIRE(y == state.py_);
+        continue;
+      }
+      for (unsigned int i = 0; i < num; ++i) {
+        REQUIRE(c[i] == Approx(state.pc_[i]).margin(1e-6));
+        REQUIRE(s[i] == Approx(state.ps_[i]).margin(1e-6));
+        REQUIRE(x[i] == Approx(state.px_[i]).margin(1e-4));
+        REQUIRE(y[i] == Approx(state.py_[i]).margin(1e-4));
+      }
+    }
+  }
+
+  // heading noise of each particle, drawn by stable ID
+  std::vector<unsigned int> pid(num);
+  std::vector<float> pe(num);
+  for (unsigned int i = 0; i < num; ++i) {
+    pid[i] = num - 1 - i;
+  }
+  Rng::normal(pe.data(), num, 0.5f, RngStream::Noise, 7);
+  for (unsigned int i = 0; i < num; ++i) {
+    f[i] = fmod(pf[i] + state.alpha_ + state.beta_ * state.pn_[i]
+                * ((state.pl_[i] < state.pr_[i])
+                   - (state.pr_[i] < state.pl_[i])), TAU)
+           + pe[pid[i]];
+    f[i] = f[i] < 0 ? f[i] + TAU : f[i];
+  }
+  for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse,
+                          SimdLevel::Avx2}) {
+    Simd::level(level);
+    for (bool exact : {true, false}) {
+      state.px_ = px;
+      state.py_ = py;
+      state.pf_ = pf;
+      Simd::move(state.px_.data(), state.py_.data(), state.pf_.data(),
+                 state.pc_.data(), state.ps_.data(), state.pn_.data(),
+                 state.pl_.data(), state.pr_.data(), num, state.alpha_,
+                 state.beta_, 0.01f, pid.data(), 0.5f, RngStream::Noise, 7,
+                 state.speed_, w, h, exact);
+      for (unsigned int i = 0; i < num; ++i) {
+        if (exact) {
+          REQUIRE(f[i] == state.pf_[i]);
+          continue;
+        }
+        REQUIRE(f[i] == Approx(state.pf_[i]).margin(1e-5));
+      }
+    }
+  }
+  Simd::level(best);
+}
+
+
+TEST_CASE("Simd::normal")
+{
+  unsigned int count = 1003; // leaving a tail
+  std::vector<float> want(count);
+  std::vector<float> got(count);
+  SimdLevel best = Simd::level();
+
+  Rng::normal(want.data(), count, 2.0f, RngStream::Noise, 12);
+  for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse,
+                          SimdLevel::Avx2}) {
+    Simd::level(level);
+    for (bool exact : {true, false}) {
+      Simd::normal(got.data(), count, 2.0f, RngStream::Noise, 12, exact);
+      if (exact) {
+        REQUIRE(want == got);
+        continue;
+      }
+      for (unsigned int i = 0; i < count; ++i) {
+        REQUIRE(want[i] == Approx(got[i]).margin(1e-5));
+      }
+    }
+  }
+  Simd::level(best);
+}
@@ -0,0 +1,1276 @@
+#include "simd.hh"
+#include "../util/common.hh"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+
+SimdLevel Simd::level_ = Simd::detect();
+
+
+void
+Simd::compare(const float* x, const float* y,
+              const float* c, const float* s,
+              const float* offx, const float* offy,
+              const int* index, unsigned int count, int skip,
+              float srcx, float srcy, float srcc, float srcs,
+              float scopesq, float* distsq,
+              unsigned int& in, unsigned int& srcright,
+              unsigned int& dstright)
+{
+  if (SimdLevel::Avx2 == Simd::level_) {
+    Simd::compare_avx2(x, y, c, s, offx, offy, index, count, skip,
+                       srcx, srcy, srcc, srcs, scopesq,
+                       distsq, in, srcright, dstright);
+  } else if (SimdLevel::Sse == Simd::level_) {
+    Simd::compare_sse(x, y, c, s, offx, offy, index, count, skip,
+                      srcx, srcy, srcc, srcs, scopesq,
+                      distsq, in, srcright, dstright);
+  } else {
+    in = 0;
+    srcright = 0;
+    dstright = 0;
+    Simd::compare_scalar(x, y, c, s, offx, offy, index, 0, count, skip,
+                         srcx, srcy, srcc, srcs, scopesq,
+                         distsq, in, srcright, dstright);
+  }
+}
+
+
+void
+Simd::move(float* px, float* py, float* pf, float* pc, float* ps,
+           const unsigned int* pn, const unsigned int* pl,
+           const unsigned int* pr, unsigned int count,
+           float alpha, float beta, float noise, const unsigned int* pid,
+           float stddev, RngStream stream, unsigned long long tick,
+           float speed, float width, float height, bool exact)
+{
+  if (SimdLevel::Avx2 == Simd::level_) {
+    Simd::move_avx2(px, py, pf, pc, ps, pn, pl, pr, count, alpha, beta,
+                    noise, pid, stddev, stream, tick, speed, width, height,
+                    exact);
+  } else if (SimdLevel::Sse == Simd::level_) {
+    Simd::move_sse(px, py, pf, pc, ps, pn, pl, pr, count, alpha, beta,
+                   noise, pid, stddev, stream, tick, speed, width, height,
+                   exact);
+  } else {
+    Simd::move_ids(px, py, pf, pc, ps, pn, pl, pr, count, alpha, beta,
+                   noise, pid, stddev, stream, tick, speed, width, height);
+  }
+}
+
+
+void
+Simd::normal(float* out, unsigned int count, float stddev,
+             RngStream stream, unsigned long long tick, bool exact)
+{
+  if (SimdLevel::Avx2 == Simd::level_) {
+    Simd::normal_avx2(out, count, stddev, stream, tick, exact);
+  } else if (SimdLevel::Sse == Simd::level_) {
+    Simd::normal_sse(out, count, stddev, stream, tick, exact);
+  } else {
+    Rng::normal(out, count, stddev, stream, tick);
+  }
+}
+
+
+SimdLevel
+Simd::level()
+{
+  return Simd::level_;
+}
+
+
+SimdLevel
+Simd::level(SimdLevel level)
+{
+  SimdLevel best = Simd::detect();
+  Simd::level_ = level < best ? level : best;
+  return Simd::level_;
+}
+
+
+std::string
+Simd::name(SimdLevel level)
+{
+  if (SimdLevel::Avx2 == level) { return "AVX2"; }
+  if (SimdLevel::Sse  == level) { return "SSE"; }
+  return "scalar";
+}
+
+
+SimdLevel
+Simd::detect()
+{
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) { return SimdLevel::Avx2; }
+  if (__builtin_cpu_supports("sse2")) { return SimdLevel::Sse; }
+#endif /* SIMD_X86 */
+  return SimdLevel::Scalar;
+}
+
+
+void
+Simd::compare_scalar(const float* x, const float* y,
+                     const float* c, const float* s,
+                     const float* offx, const float* offy,
+                     const int* index, unsigned int from,
+                     unsigned int count, int skip,
+                     float srcx, float srcy, float srcc, float srcs,
+                     float scopesq, float* distsq, unsigned int& in,
+                     unsigned int& srcright, unsigned int& dstright)
+{
+  float dx;
+  float dy;
+  float dsq;
+
+  for (unsigned int i = from; i < count; ++i) {
+    dx = (x[i] - srcx) + offx[i];
+    dy = (y[i] - srcy) + offy[i];
+    dsq = (dx * dx) + (dy * dy);
+    distsq[i] = dsq;
+    in       |= static_cast<unsigned int>(
+      skip != index[i] && scopesq >= dsq) << i;
+    srcright |= static_cast<unsigned int>(
+      0.0f > (dx * srcs) - (dy * srcc)) << i;
+    dstright |= static_cast<unsigned int>(
+      0.0f < (dx * s[i]) - (dy * c[i])) << i;
+  }
+}
+
+
+void
+Simd::move_scalar(float* px, float* py, float* pf, float* pc, float* ps,
+                  const unsigned int* pn, const unsigned int* pl,
+                  const unsigned int* pr, unsigned int from,
+                  unsigned int count, float alpha, float beta, float noise,
+                  const float* pe, float speed, float width, float height)
+{
+  float f;
+  float x;
+  float y;
+  int side;
+
+  for (unsigned int i = from; i < count; ++i) {
+    side = static_cast<int>(pr[i] - pl[i]);
+    side = (0 < side) - (side < 0);
+    f = std::fmod(pf[i] + alpha + (beta * pn[i] * side), TAU)
+        + (nullptr == pe ? noise : pe[i]);
+    if (f < 0) { f += TAU; }
+    pf[i] = f;
+    pc[i] = cosf(f);
+    ps[i] = sinf(f);
+    x = std::fmod(px[i] + speed * pc[i], width);
+    if (x < 0) { x += width; }
+    px[i] = x;
+    y = std::fmod(py[i] + speed * ps[i], height);
+    if (y < 0) { y += height; }
+    py[i] = y;
+  }
+}
+
+
+void
+Simd::move_ids(float* px, float* py, float* pf, float* pc, float* ps,
+               const unsigned int* pn, const unsigned int* pl,
+               const unsigned int* pr, unsigned int count,
+               float alpha, float beta, float noise, const unsigned int* pid,
+               float stddev, RngStream stream, unsigned long long tick,
+               float speed, float width, float height)
+{
+  float e;
+
+  if (nullptr == pid) {
+    Simd::move_scalar(px, py, pf, pc, ps, pn, pl, pr, 0, count,
+                      alpha, beta, noise, nullptr, speed, width, height);
+    return;
+  }
+  for (unsigned int i = 0; i < count; ++i) {
+    Rng::normal(&e, 1, stddev, stream, tick, pid[i]);
+    Simd::move_scalar(px + i, py + i, pf + i, pc + i, ps + i,
+                      pn + i, pl + i, pr + i, 0, 1,
+                      alpha, beta, noise, &e, speed, width, height);
+  }
+}
+
+
+#ifdef SIMD_X86
+
+// NOTE: Only the plain vector instructions are enabled (no FMA), so that
+//       multiplications and additions get rounded just like in the scalar
+//       version.
+
+__attribute__((target("sse2"))) void
+Simd::compare_sse(const float* x, const float* y,
+                  const float* c, const float* s,
+                  const float* offx, const float* offy,
+                  const int* index, unsigned int count, int skip,
+                  float srcx, float srcy, float srcc, float srcs,
+                  float scopesq, float* distsq, unsigned int& in,
+                  unsigned int& srcright, unsigned int& dstright)
+{
+  __m128 vsrcx = _mm_set1_ps(srcx);
+  __m128 vsrcy = _mm_set1_ps(srcy);
+  __m128 vsrcc = _mm_set1_ps(srcc);
+  __m128 vsrcs = _mm_set1_ps(srcs);
+  __m128 vscopesq = _mm_set1_ps(scopesq);
+  __m128i vskip = _mm_set1_epi32(skip);
+  __m128 zero = _mm_setzero_ps();
+  __m128 dx;
+  __m128 dy;
+  __m128 dsq;
+  __m128 cross;
+  __m128 mask;
+  unsigned int lanes;
+  unsigned int i = 0;
+
+  in = 0;
+  srcright = 0;
+  dstright = 0;
+  // the tail is done in one more step, and masked out
+  for (; i < count; i += 4) {
+    dx = _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(x + i), vsrcx),
+                    _mm_loadu_ps(offx + i));
+    dy = _mm_add_ps(_mm_sub_ps(_mm_loadu_ps(y + i), vsrcy),
+                    _mm_loadu_ps(offy + i));
+    dsq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    _mm_storeu_ps(distsq + i, dsq);
+    mask = _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(index + i)), vskip)),
+                         _mm_cmple_ps(dsq, vscopesq));
+    lanes = count - i < 4 ? (1u << (count - i)) - 1 : 0xf;
+    in |= (static_cast<unsigned int>(_mm_movemask_ps(mask)) & lanes) << i;
+    cross = _mm_sub_ps(_mm_mul_ps(dx, vsrcs), _mm_mul_ps(dy, vsrcc));
+    srcright |= (static_cast<unsigned int>(
+      _mm_movemask_ps(_mm_cmplt_ps(cross, zero))) & lanes) << i;
+    cross = _mm_sub_ps(_mm_mul_ps(dx, _mm_loadu_ps(s + i)),
+                       _mm_mul_ps(dy, _mm_loadu_ps(c + i)));
+    dstright |= (static_cast<unsigned int>(
+      _mm_movemask_ps(_mm_cmpgt_ps(cross, zero))) & lanes) << i;
+  }
+}
+
+
+__attribute__((target("avx2"))) void
+Simd::compare_avx2(const float* x, const float* y,
+                   const float* c, const float* s,
+                   const float* offx, const float* offy,
+                   const int* index, unsigned int count, int skip,
+                   float srcx, float srcy, float srcc, float srcs,
+                   float scopesq, float* distsq, unsigned int& in,
+                   unsigned int& srcright, unsigned int& dstright)
+{
+  __m256 vsrcx = _mm256_set1_ps(srcx);
+  __m256 vsrcy = _mm256_set1_ps(srcy);
+  __m256 vsrcc = _mm256_set1_ps(srcc);
+  __m256 vsrcs = _mm256_set1_ps(srcs);
+  __m256 vscopesq = _mm256_set1_ps(scopesq);
+  __m256i vskip = _mm256_set1_epi32(skip);
+  __m256 zero = _mm256_setzero_ps();
+  __m256 dx;
+  __m256 dy;
+  __m256 dsq;
+  __m256 cross;
+  __m256 mask;
+  unsigned int lanes;
+  unsigned int i = 0;
+
+  in = 0;
+  srcright = 0;
+  dstright = 0;
+  // the tail is done in one more step, and masked out
+  for (; i < count; i += 8) {
+    dx = _mm256_add_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), vsrcx),
+                       _mm256_loadu_ps(offx + i));
+    dy = _mm256_add_ps(_mm256_sub_ps(_mm256_loadu_ps(y + i), vsrcy),
+                       _mm256_loadu_ps(offy + i));
+    dsq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    _mm256_storeu_ps(distsq + i, dsq);
+    mask = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + i)),
+      vskip)), _mm256_cmp_ps(dsq, vscopesq, _CMP_LE_OQ));
+    lanes = count - i < 8 ? (1u << (count - i)) - 1 : 0xff;
+    in |= (static_cast<unsigned int>(_mm256_movemask_ps(mask)) & lanes) << i;
+    cross = _mm256_sub_ps(_mm256_mul_ps(dx, vsrcs), _mm256_mul_ps(dy, vsrcc));
+    srcright |= (static_cast<unsigned int>(_mm256_movemask_ps(
+      _mm256_cmp_ps(cross, zero, _CMP_LT_OQ))) & lanes) << i;
+    cross = _mm256_sub_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(s + i)),
+                          _mm256_mul_ps(dy, _mm256_loadu_ps(c + i)));
+    dstright |= (static_cast<unsigned int>(_mm256_movemask_ps(
+      _mm256_cmp_ps(cross, zero, _CMP_GT_OQ))) & lanes) << i;
+  }
+  _mm256_zeroupper(); // avoid AVX-SSE transition penalties afterwards
+}
+
+
+// Constants of the polynomial approximations of sin() and cos() on
+// [-pi/4, pi/4], and of the reduction to that range, from the Cephes library.
+
+static const float sincos_fopi = 1.27323954473516f; // 4 / pi
+static const float sincos_dp1 = -0.78515625f;
+static const float sincos_dp2 = -2.4187564849853515625e-4f;
+static const float sincos_dp3 = -3.77489497744594108e-8f;
+static const float sincos_sin0 = -1.9515295891e-4f;
+static const float sincos_sin1 = 8.3321608736e-3f;
+static const float sincos_sin2 = -1.6666654611e-1f;
+static const float sincos_cos0 = 2.443315711809948e-5f;
+static const float sincos_cos1 = -1.388731625493765e-3f;
+static const float sincos_cos2 = 4.166664568298827e-2f;
+
+
+// sincos_sse(): Approximate cos() and sin() of four non-negative angles.
+
+__attribute__((target("sse2"))) static inline void
+sincos_sse(__m128 f, __m128& c, __m128& s)
+{
+  __m128i j;
+  __m128 y;
+  __m128 z;
+  __m128 polyc;
+  __m128 polys;
+  __m128 swap;
+  __m128 signs;
+  __m128 signc;
+
+  // even octant j, and f reduced to [-pi/4, pi/4] around it
+  j = _mm_cvttps_epi32(_mm_mul_ps(f, _mm_set1_ps(sincos_fopi)));
+  j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+  y = _mm_cvtepi32_ps(j);
+  f = _mm_add_ps(f, _mm_mul_ps(y, _mm_set1_ps(sincos_dp1)));
+  f = _mm_add_ps(f, _mm_mul_ps(y, _mm_set1_ps(sincos_dp2)));
+  f = _mm_add_ps(f, _mm_mul_ps(y, _mm_set1_ps(sincos_dp3)));
+  // in octants 2, 3, 6, 7 the polynomials swap roles
+  swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+    _mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+  signs = _mm_castsi128_ps(_mm_slli_epi32(
+    _mm_and_si128(j, _mm_set1_epi32(4)), 29));
+  signc = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(
+    _mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+  z = _mm_mul_ps(f, f);
+  polyc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sincos_cos0), z),
+                     _mm_set1_ps(sincos_cos1));
+  polyc = _mm_add_ps(_mm_mul_ps(polyc, z), _mm_set1_ps(sincos_cos2));
+  polyc = _mm_mul_ps(_mm_mul_ps(polyc, z), z);
+  polyc = _mm_sub_ps(polyc, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  polyc = _mm_add_ps(polyc, _mm_set1_ps(1.0f));
+  polys = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sincos_sin0), z),
+                     _mm_set1_ps(sincos_sin1));
+  polys = _mm_add_ps(_mm_mul_ps(polys, z), _mm_set1_ps(sincos_sin2));
+  polys = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(polys, z), f), f);
+  s = _mm_or_ps(_mm_and_ps(swap, polys), _mm_andnot_ps(swap, polyc));
+  c = _mm_or_ps(_mm_and_ps(swap, polyc), _mm_andnot_ps(swap, polys));
+  s = _mm_xor_ps(s, signs);
+  c = _mm_xor_ps(c, signc);
+}
+
+
+// sincos_avx2(): Approximate cos() and sin() of eight non-negative angles.
+
+__attribute__((target("avx2"))) static inline void
+sincos_avx2(__m256 f, __m256& c, __m256& s)
+{
+  __m256i j;
+  __m256 y;
+  __m256 z;
+  __m256 polyc;
+  __m256 polys;
+  __m256 swap;
+  __m256 signs;
+  __m256 signc;
+
+  // see sincos_sse()
+  j = _mm256_cvttps_epi32(_mm256_mul_ps(f, _mm256_set1_ps(sincos_fopi)));
+  j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)),
+                       _mm256_set1_epi32(~1));
+  y = _mm256_cvtepi32_ps(j);
+  f = _mm256_add_ps(f, _mm256_mul_ps(y, _mm256_set1_ps(sincos_dp1)));
+  f = _mm256_add_ps(f, _mm256_mul_ps(y, _mm256_set1_ps(sincos_dp2)));
+  f = _mm256_add_ps(f, _mm256_mul_ps(y, _mm256_set1_ps(sincos_dp3)));
+  swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+    _mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+  signs = _mm256_castsi256_ps(_mm256_slli_epi32(
+    _mm256_and_si256(j, _mm256_set1_epi32(4)), 29));
+  signc = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(
+    _mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+  z = _mm256_mul_ps(f, f);
+  polyc = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(sincos_cos0), z),
+                        _mm256_set1_ps(sincos_cos1));
+  polyc = _mm256_add_ps(_mm256_mul_ps(polyc, z), _mm256_set1_ps(sincos_cos2));
+  polyc = _mm256_mul_ps(_mm256_mul_ps(polyc, z), z);
+  polyc = _mm256_sub_ps(polyc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+  polyc = _mm256_add_ps(polyc, _mm256_set1_ps(1.0f));
+  polys = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(sincos_sin0), z),
+                        _mm256_set1_ps(sincos_sin1));
+  polys = _mm256_add_ps(_mm256_mul_ps(polys, z), _mm256_set1_ps(sincos_sin2));
+  polys = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(polys, z), f), f);
+  s = _mm256_blendv_ps(polyc, polys, swap);
+  c = _mm256_blendv_ps(polys, polyc, swap);
+  s = _mm256_xor_ps(s, signs);
+  c = _mm256_xor_ps(c, signc);
+}
+
+
+// Constants of the polynomial approximation of log() on [sqrt(1/2) - 1,
+// sqrt(2) - 1], and of the reconstruction from the exponent, from the
+// Cephes library.
+
+static const float log_sqrthf = 0.707106781186547524f; // sqrt(1/2)
+static const float log_poly[9] = {
+  7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f,
+  -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f,
+  2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f
+};
+static const float log_q1 = -2.12194440e-4f;
+static const float log_q2 = 0.693359375f;
+
+
+// log_sse(): Approximate log() of four positive normal numbers.
+
+__attribute__((target("sse2"))) static inline __m128
+log_sse(__m128 x)
+{
+  __m128i bits = _mm_castps_si128(x);
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 e;
+  __m128 y;
+  __m128 z;
+  __m128 mask;
+
+  // x = m * 2^e with m in [1/2, 1), then m - 1 moved to around 0
+  e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23),
+                                    _mm_set1_epi32(126)));
+  x = _mm_castsi128_ps(_mm_or_si128(
+    _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+    _mm_set1_epi32(0x3f000000)));
+  mask = _mm_cmplt_ps(x, _mm_set1_ps(log_sqrthf));
+  e = _mm_sub_ps(e, _mm_and_ps(mask, one));
+  x = _mm_add_ps(_mm_sub_ps(x, one), _mm_and_ps(mask, x));
+  z = _mm_mul_ps(x, x);
+  y = _mm_set1_ps(log_poly[0]);
+  for (unsigned int k = 1; k < 9; ++k) {
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(log_poly[k]));
+  }
+  y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+  y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(log_q1)));
+  y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  x = _mm_add_ps(x, y);
+  return _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(log_q2)));
+}
+
+
+// log_avx2(): Approximate log() of eight positive normal numbers.
+
+__attribute__((target("avx2"))) static inline __m256
+log_avx2(__m256 x)
+{
+  __m256i bits = _mm256_castps_si256(x);
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 e;
+  __m256 y;
+  __m256 z;
+  __m256 mask;
+
+  // see log_sse()
+  e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+                                          _mm256_set1_epi32(126)));
+  x = _mm256_castsi256_ps(_mm256_or_si256(
+    _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+    _mm256_set1_epi32(0x3f000000)));
+  mask = _mm256_cmp_ps(x, _mm256_set1_ps(log_sqrthf), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(mask, one));
+  x = _mm256_add_ps(_mm256_sub_ps(x, one), _mm256_and_ps(mask, x));
+  z = _mm256_mul_ps(x, x);
+  y = _mm256_set1_ps(log_poly[0]);
+  for (unsigned int k = 1; k < 9; ++k) {
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(log_poly[k]));
+  }
+  y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+  y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(log_q1)));
+  y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+  x = _mm256_add_ps(x, y);
+  return _mm256_add_ps(x, _mm256_mul_ps(e, _mm256_set1_ps(log_q2)));
+}
+
+
+// philox_sse(): The Philox4x32-10 bijection of four counters, see
+//               Rng::philox(). Each word is kept in the low half of a double
+//               word, as an unsigned multiply only reads those and then gives
+//               both halves of the product without shuffling; the high halves
+//               hold garbage. The counters of even and odd elements are run
+//               side by side, for their chains of multiplies to overlap.
+
+__attribute__((target("sse2"))) static inline void
+philox_sse(__m128i even[4], __m128i odd[4], const unsigned int key[2])
+{
+  __m128i m0 = _mm_set1_epi64x(0xD2511F53u);
+  __m128i m1 = _mm_set1_epi64x(0xCD9E8D57u);
+  __m128i k0;
+  __m128i k1;
+  __m128i pe0;
+  __m128i pe1;
+  __m128i po0;
+  __m128i po1;
+
+  for (unsigned int round = 0; round < 10; ++round) {
+    k0 = _mm_set1_epi32(static_cast<int>(key[0] + round * 0x9E3779B9u));
+    k1 = _mm_set1_epi32(static_cast<int>(key[1] + round * 0xBB67AE85u));
+    pe0 = _mm_mul_epu32(even[0], m0);
+    po0 = _mm_mul_epu32(odd[0], m0);
+    pe1 = _mm_mul_epu32(even[2], m1);
+    po1 = _mm_mul_epu32(odd[2], m1);
+    even[0] = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(pe1, 32), even[1]),
+                            k0);
+    odd[0] = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(po1, 32), odd[1]),
+                           k0);
+    even[2] = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(pe0, 32), even[3]),
+                            k1);
+    odd[2] = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(po0, 32), odd[3]),
+                           k1);
+    even[1] = pe1;
+    odd[1] = po1;
+    even[3] = pe0;
+    odd[3] = po0;
+  }
+}
+
+
+// philox_avx2(): The Philox4x32-10 bijection of eight counters, see
+//                philox_sse().
+
+__attribute__((target("avx2"))) static inline void
+philox_avx2(__m256i even[4], __m256i odd[4], const unsigned int key[2])
+{
+  __m256i m0 = _mm256_set1_epi64x(0xD2511F53u);
+  __m256i m1 = _mm256_set1_epi64x(0xCD9E8D57u);
+  __m256i k0;
+  __m256i k1;
+  __m256i pe0;
+  __m256i pe1;
+  __m256i po0;
+  __m256i po1;
+
+  for (unsigned int round = 0; round < 10; ++round) {
+    k0 = _mm256_set1_epi32(static_cast<int>(key[0] + round * 0x9E3779B9u));
+    k1 = _mm256_set1_epi32(static_cast<int>(key[1] + round * 0xBB67AE85u));
+    pe0 = _mm256_mul_epu32(even[0], m0);
+    po0 = _mm256_mul_epu32(odd[0], m0);
+    pe1 = _mm256_mul_epu32(even[2], m1);
+    po1 = _mm256_mul_epu32(odd[2], m1);
+    even[0] = _mm256_xor_si256(
+      _mm256_xor_si256(_mm256_srli_epi64(pe1, 32), even[1]), k0);
+    odd[0] = _mm256_xor_si256(
+      _mm256_xor_si256(_mm256_srli_epi64(po1, 32), odd[1]), k0);
+    even[2] = _mm256_xor_si256(
+      _mm256_xor_si256(_mm256_srli_epi64(pe0, 32), even[3]), k1);
+    odd[2] = _mm256_xor_si256(
+      _mm256_xor_si256(_mm256_srli_epi64(po0, 32), odd[3]), k1);
+    even[1] = pe1;
+    odd[1] = po1;
+    even[3] = pe0;
+    odd[3] = po0;
+  }
+}
+
+
+// noise_block_sse(): Heading noise of four particles, see Simd::move(). The
+//                    number of a particle is element pid of Rng::normal(),
+//                    ie. lane pid % 4 of counter pid / 4, as in the OpenCL
+//                    move kernel.
+
+__attribute__((target("sse2"))) static inline __m128
+noise_block_sse(const unsigned int* pid, float stddev, RngStream stream,
+                unsigned long long tick, bool exact)
+{
+  __m128i low = _mm_set1_epi64x(0xffffffffu);
+  __m128i one = _mm_set1_epi32(1);
+  __m128i two = _mm_set1_epi32(2);
+  __m128i id = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pid));
+  __m128i even[4];
+  __m128i odd[4];
+  __m128i w[4];
+  __m128i hi;
+  __m128i u;
+  __m128i v;
+  __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+  __m128 sine;
+  __m128 r;
+  __m128 a;
+  __m128 c;
+  __m128 s;
+  unsigned int cu[4];
+  unsigned int cv[4];
+  float z[2];
+  float e[4];
+
+  even[0] = _mm_srli_epi32(id, 2);
+  odd[0] = _mm_srli_epi64(even[0], 32);
+  even[1] = odd[1] = _mm_set1_epi32(static_cast<int>(stream));
+  even[2] = odd[2] = _mm_set1_epi32(static_cast<int>(tick));
+  even[3] = odd[3] = _mm_set1_epi32(static_cast<int>(tick >> 32));
+  philox_sse(even, odd, Rng::key());
+  for (unsigned int k = 0; k < 4; ++k) {
+    w[k] = _mm_or_si128(_mm_and_si128(even[k], low),
+                        _mm_slli_epi64(odd[k], 32));
+  }
+  // lanes 2 and 3 of a counter are the pair of words 2 and 3, lanes 1 and 3
+  // the sines
+  hi = _mm_cmpeq_epi32(_mm_and_si128(id, two), two);
+  u = _mm_or_si128(_mm_and_si128(hi, w[2]), _mm_andnot_si128(hi, w[0]));
+  v = _mm_or_si128(_mm_and_si128(hi, w[3]), _mm_andnot_si128(hi, w[1]));
+  if (exact) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(cu), u);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(cv), v);
+    for (unsigned int i = 0; i < 4; ++i) {
+      Rng::gauss(cu[i], cv[i], z[0], z[1]);
+      e[i] = stddev * z[pid[i] & 1];
+    }
+    return _mm_loadu_ps(e);
+  }
+  // see normal_block_sse()
+  sine = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(id, one), one));
+  r = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(
+    _mm_cvtepi32_ps(_mm_srli_epi32(u, 8)), scale));
+  r = _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), log_sse(r)));
+  a = _mm_mul_ps(_mm_set1_ps(TAU), _mm_mul_ps(
+    _mm_cvtepi32_ps(_mm_srli_epi32(v, 8)), scale));
+  sincos_sse(a, c, s);
+  return _mm_mul_ps(_mm_set1_ps(stddev), _mm_mul_ps(
+    r, _mm_or_ps(_mm_and_ps(sine, s), _mm_andnot_ps(sine, c))));
+}
+
+
+// noise_block_avx2(): Heading noise of eight particles, see
+//                     noise_block_sse().
+
+__attribute__((target("avx2"))) static inline __m256
+noise_block_avx2(const unsigned int* pid, float stddev, RngStream stream,
+                 unsigned long long tick, bool exact)
+{
+  __m256i one = _mm256_set1_epi32(1);
+  __m256i two = _mm256_set1_epi32(2);
+  __m256i id = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pid));
+  __m256i even[4];
+  __m256i odd[4];
+  __m256i w[4];
+  __m256i hi;
+  __m256i u;
+  __m256i v;
+  __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f);
+  __m256 sine;
+  __m256 r;
+  __m256 a;
+  __m256 c;
+  __m256 s;
+  unsigned int cu[8];
+  unsigned int cv[8];
+  float z[2];
+  float e[8];
+
+  even[0] = _mm256_srli_epi32(id, 2);
+  odd[0] = _mm256_srli_epi64(even[0], 32);
+  even[1] = odd[1] = _mm256_set1_epi32(static_cast<int>(stream));
+  even[2] = odd[2] = _mm256_set1_epi32(static_cast<int>(tick));
+  even[3] = odd[3] = _mm256_set1_epi32(static_cast<int>(tick >> 32));
+  philox_avx2(even, odd, Rng::key());
+  for (unsigned int k = 0; k < 4; ++k) {
+    w[k] = _mm256_blend_epi32(even[k], _mm256_slli_epi64(odd[k], 32), 0xaa);
+  }
+  hi = _mm256_cmpeq_epi32(_mm256_and_si256(id, two), two);
+  u = _mm256_blendv_epi8(w[0], w[2], hi);
+  v = _mm256_blendv_epi8(w[1], w[3], hi);
+  if (exact) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(cu), u);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(cv), v);
+    for (unsigned int i = 0; i < 8; ++i) {
+      Rng::gauss(cu[i], cv[i], z[0], z[1]);
+      e[i] = stddev * z[pid[i] & 1];
+    }
+    return _mm256_loadu_ps(e);
+  }
+  sine = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(id, one),
+                                                one));
+  r = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(
+    _mm256_cvtepi32_ps(_mm256_srli_epi32(u, 8)), scale));
+  r = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), log_avx2(r)));
+  a = _mm256_mul_ps(_mm256_set1_ps(TAU), _mm256_mul_ps(
+    _mm256_cvtepi32_ps(_mm256_srli_epi32(v, 8)), scale));
+  sincos_avx2(a, c, s);
+  return _mm256_mul_ps(_mm256_set1_ps(stddev), _mm256_mul_ps(
+    r, _mm256_blendv_ps(c, s, sine)));
+}
+
+
+// move_block_sse(): Move four particles, see Simd::move(). Particles out of
+//                   the usual ranges keep their X, Y, PHI parameters, and
+//                   are marked for the scalar code.
+
+__attribute__((target("sse2"))) static inline unsigned int
+move_block_sse(float* px, float* py, float* pf, float* pc, float* ps,
+               const unsigned int* pn, const unsigned int* pl,
+               const unsigned int* pr, float alpha, float beta, __m128 e,
+               float speed, float width, float height, bool exact)
+{
+  __m128 vtau = _mm_set1_ps(TAU);
+  __m128 vwidth = _mm_set1_ps(width);
+  __m128 vheight = _mm_set1_ps(height);
+  __m128 vspeed = _mm_set1_ps(speed);
+  __m128 zero = _mm_setzero_ps();
+  __m128 f0 = _mm_loadu_ps(pf);
+  __m128 x0 = _mm_loadu_ps(px);
+  __m128 y0 = _mm_loadu_ps(py);
+  __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pl));
+  __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pr));
+  __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pn));
+  __m128 side;
+  __m128 f;
+  __m128 x;
+  __m128 y;
+  __m128 c;
+  __m128 s;
+  __m128 mask;
+  __m128 ok;
+  float cf[4];
+
+  // same order of operations as in move_scalar(); fmod() is exact, and so
+  // is subtracting the divisor once where the dividend is less than twice
+  // the divisor, so the results are the same within these ranges
+  side = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_cmpgt_epi32(l, r),
+                                       _mm_cmpgt_epi32(r, l)));
+  f = _mm_add_ps(_mm_add_ps(f0, _mm_set1_ps(alpha)),
+                 _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(beta),
+                                       _mm_cvtepi32_ps(n)), side));
+  ok = _mm_and_ps(_mm_cmpgt_ps(f, _mm_sub_ps(zero, vtau)),
+                  _mm_cmplt_ps(f, _mm_add_ps(vtau, vtau)));
+  mask = _mm_cmpge_ps(f, vtau);
+  f = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(f, vtau)),
+                _mm_andnot_ps(mask, f));
+  f = _mm_add_ps(f, e);
+  mask = _mm_cmplt_ps(f, zero);
+  f = _mm_or_ps(_mm_and_ps(mask, _mm_add_ps(f, vtau)),
+                _mm_andnot_ps(mask, f));
+  if (exact) {
+    _mm_storeu_ps(cf, f);
+    c = _mm_setr_ps(cosf(cf[0]), cosf(cf[1]), cosf(cf[2]), cosf(cf[3]));
+    s = _mm_setr_ps(sinf(cf[0]), sinf(cf[1]), sinf(cf[2]), sinf(cf[3]));
+  } else {
+    sincos_sse(f, c, s);
+  }
+  x = _mm_add_ps(x0, _mm_mul_ps(vspeed, c));
+  y = _mm_add_ps(y0, _mm_mul_ps(vspeed, s));
+  ok = _mm_and_ps(ok, _mm_and_ps(
+    _mm_cmpgt_ps(x, _mm_sub_ps(zero, vwidth)),
+    _mm_cmplt_ps(x, _mm_add_ps(vwidth, vwidth))));
+  ok = _mm_and_ps(ok, _mm_and_ps(
+    _mm_cmpgt_ps(y, _mm_sub_ps(zero, vheight)),
+    _mm_cmplt_ps(y, _mm_add_ps(vheight, vheight))));
+  mask = _mm_cmpge_ps(x, vwidth);
+  x = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(x, vwidth)),
+                _mm_andnot_ps(mask, x));
+  mask = _mm_cmplt_ps(x, zero);
+  x = _mm_or_ps(_mm_and_ps(mask, _mm_add_ps(x, vwidth)),
+                _mm_andnot_ps(mask, x));
+  mask = _mm_cmpge_ps(y, vheight);
+  y = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(y, vheight)),
+                _mm_andnot_ps(mask, y));
+  mask = _mm_cmplt_ps(y, zero);
+  y = _mm_or_ps(_mm_and_ps(mask, _mm_add_ps(y, vheight)),
+                _mm_andnot_ps(mask, y));
+  _mm_storeu_ps(pf, _mm_or_ps(_mm_and_ps(ok, f), _mm_andnot_ps(ok, f0)));
+  _mm_storeu_ps(px, _mm_or_ps(_mm_and_ps(ok, x), _mm_andnot_ps(ok, x0)));
+  _mm_storeu_ps(py, _mm_or_ps(_mm_and_ps(ok, y), _mm_andnot_ps(ok, y0)));
+  _mm_storeu_ps(pc, c);
+  _mm_storeu_ps(ps, s);
+  return ~static_cast<unsigned int>(_mm_movemask_ps(ok)) & 0xf;
+}
+
+
+// move_block_avx2(): Move eight particles, see move_block_sse().
+
+__attribute__((target("avx2"))) static inline unsigned int
+move_block_avx2(float* px, float* py, float* pf, float* pc, float* ps,
+                const unsigned int* pn, const unsigned int* pl,
+                const unsigned int* pr, float alpha, float beta, __m256 e,
+                float speed, float width, float height, bool exact)
+{
+  __m256 vtau = _mm256_set1_ps(TAU);
+  __m256 vwidth = _mm256_set1_ps(width);
+  __m256 vheight = _mm256_set1_ps(height);
+  __m256 vspeed = _mm256_set1_ps(speed);
+  __m256 zero = _mm256_setzero_ps();
+  __m256 f0 = _mm256_loadu_ps(pf);
+  __m256 x0 = _mm256_loadu_ps(px);
+  __m256 y0 = _mm256_loadu_ps(py);
+  __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pl));
+  __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pr));
+  __m256i n = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pn));
+  __m256 side;
+  __m256 f;
+  __m256 x;
+  __m256 y;
+  __m256 c;
+  __m256 s;
+  __m256 ok;
+  float cf[8];
+  float cc[8];
+  float cs[8];
+
+  // see move_block_sse()
+  side = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_cmpgt_epi32(l, r),
+                                             _mm256_cmpgt_epi32(r, l)));
+  f = _mm256_add_ps(_mm256_add_ps(f0, _mm256_set1_ps(alpha)),
+                    _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(beta),
+                                                _mm256_cvtepi32_ps(n)),
+                                  side));
+  ok = _mm256_and_ps(
+    _mm256_cmp_ps(f, _mm256_sub_ps(zero, vtau), _CMP_GT_OQ),
+    _mm256_cmp_ps(f, _mm256_add_ps(vtau, vtau), _CMP_LT_OQ));
+  f = _mm256_blendv_ps(f, _mm256_sub_ps(f, vtau),
+                       _mm256_cmp_ps(f, vtau, _CMP_GE_OQ));
+  f = _mm256_add_ps(f, e);
+  f = _mm256_blendv_ps(f, _mm256_add_ps(f, vtau),
+                       _mm256_cmp_ps(f, zero, _CMP_LT_OQ));
+  if (exact) {
+    _mm256_storeu_ps(cf, f);
+    for (unsigned int i = 0; i < 8; ++i) {
+      cc[i] = cosf(cf[i]);
+      cs[i] = sinf(cf[i]);
+    }
+    c = _mm256_loadu_ps(cc);
+    s = _mm256_loadu_ps(cs);
+  } else {
+    sincos_avx2(f, c, s);
+  }
+  x = _mm256_add_ps(x0, _mm256_mul_ps(vspeed, c));
+  y = _mm256_add_ps(y0, _mm256_mul_ps(vspeed, s));
+  ok = _mm256_and_ps(ok, _mm256_and_ps(
+    _mm256_cmp_ps(x, _mm256_sub_ps(zero, vwidth), _CMP_GT_OQ),
+    _mm256_cmp_ps(x, _mm256_add_ps(vwidth, vwidth), _CMP_LT_OQ)));
+  ok = _mm256_and_ps(ok, _mm256_and_ps(
+    _mm256_cmp_ps(y, _mm256_sub_ps(zero, vheight), _CMP_GT_OQ),
+    _mm256_cmp_ps(y, _mm256_add_ps(vheight, vheight), _CMP_LT_OQ)));
+  x = _mm256_blendv_ps(x, _mm256_sub_ps(x, vwidth),
+                       _mm256_cmp_ps(x, vwidth, _CMP_GE_OQ));
+  x = _mm256_blendv_ps(x, _mm256_add_ps(x, vwidth),
+                       _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+  y = _mm256_blendv_ps(y, _mm256_sub_ps(y, vheight),
+                       _mm256_cmp_ps(y, vheight, _CMP_GE_OQ));
+  y = _mm256_blendv_ps(y, _mm256_add_ps(y, vheight),
+                       _mm256_cmp_ps(y, zero, _CMP_LT_OQ));
+  _mm256_storeu_ps(pf, _mm256_blendv_ps(f0, f, ok));
+  _mm256_storeu_ps(px, _mm256_blendv_ps(x0, x, ok));
+  _mm256_storeu_ps(py, _mm256_blendv_ps(y0, y, ok));
+  _mm256_storeu_ps(pc, c);
+  _mm256_storeu_ps(ps, s);
+  return ~static_cast<unsigned int>(_mm256_movemask_ps(ok)) & 0xff;
+}
+
+
+__attribute__((target("sse2"))) void
+Simd::move_sse(float* px, float* py, float* pf, float* pc, float* ps,
+               const unsigned int* pn, const unsigned int* pl,
+               const unsigned int* pr, unsigned int count,
+               float alpha, float beta, float noise, const unsigned int* pid,
+               float stddev, RngStream stream, unsigned long long tick,
+               float speed, float width, float height, bool exact)
+{
+  __m128 vnoise = _mm_set1_ps(noise);
+  __m128 e;
+  float x[4];
+  float y[4];
+  float f[4];
+  float c[4];
+  float s[4];
+  float ev[4];
+  unsigned int n[4];
+  unsigned int l[4];
+  unsigned int r[4];
+  unsigned int id[4];
+  unsigned int bad;
+  unsigned int b;
+  unsigned int i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    e = nullptr == pid ? vnoise
+                       : noise_block_sse(pid + i, stddev, stream, tick, exact);
+    bad = move_block_sse(px + i, py + i, pf + i, pc + i, ps + i,
+                         pn + i, pl + i, pr + i, alpha, beta, e,
+                         speed, width, height, exact);
+    if (bad) {
+      _mm_storeu_ps(ev, e);
+    }
+    while (bad) {
+      b = __builtin_ctz(bad);
+      bad &= bad - 1;
+      Simd::move_scalar(px + i, py + i, pf + i, pc + i, ps + i,
+                        pn + i, pl + i, pr + i, b, b + 1,
+                        alpha, beta, noise, ev, speed, width, height);
+    }
+  }
+  if (i == count) {
+    return;
+  }
+  // the tail is done in one more step on copies, so that the particle
+  // parameters need no padding
+  for (b = 0; b < 4; ++b) {
+    x[b] = i + b < count ? px[i + b] : 0.0f;
+    y[b] = i + b < count ? py[i + b] : 0.0f;
+    f[b] = i + b < count ? pf[i + b] : 0.0f;
+    n[b] = i + b < count ? pn[i + b] : 0;
+    l[b] = i + b < count ? pl[i + b] : 0;
+    r[b] = i + b < count ? pr[i + b] : 0;
+    id[b] = i + b < count && nullptr != pid ? pid[i + b] : 0;
+  }
+  e = nullptr == pid ? vnoise
+                     : noise_block_sse(id, stddev, stream, tick, exact);
+  _mm_storeu_ps(ev, e);
+  bad = move_block_sse(x, y, f, c, s, n, l, r, alpha, beta, e,
+                       speed, width, height, exact);
+  for (b = 0; i + b < count; ++b) {
+    px[i + b] = x[b];
+    py[i + b] = y[b];
+    pf[i + b] = f[b];
+    pc[i + b] = c[b];
+    ps[i + b] = s[b];
+    if ((bad >> b) & 1) {
+      Simd::move_scalar(px + i, py + i, pf + i, pc + i, ps + i,
+                        pn + i, pl + i, pr + i, b, b + 1,
+                        alpha, beta, noise, ev, speed, width, height);
+    }
+  }
+}
+
+
+__attribute__((target("avx2"))) void
+Simd::move_avx2(float* px, float* py, float* pf, float* pc, float* ps,
+                const unsigned int* pn, const unsigned int* pl,
+                const unsigned int* pr, unsigned int count,
+                float alpha, float beta, float noise, const unsigned int* pid,
+                float stddev, RngStream stream, unsigned long long tick,
+                float speed, float width, float height, bool exact)
+{
+  __m256 vnoise = _mm256_set1_ps(noise);
+  __m256 e;
+  float x[8];
+  float y[8];
+  float f[8];
+  float c[8];
+  float s[8];
+  float ev[8];
+  unsigned int n[8];
+  unsigned int l[8];
+  unsigned int r[8];
+  unsigned int id[8];
+  unsigned int bad;
+  unsigned int b;
+  unsigned int i = 0;
+
+  // see move_sse()
+  for (; i + 8 <= count; i += 8) {
+    e = nullptr == pid ? vnoise
+                       : noise_block_avx2(pid + i, stddev, stream, tick,
+                                          exact);
+    bad = move_block_avx2(px + i, py + i, pf + i, pc + i, ps + i,
+                          pn + i, pl + i, pr + i, alpha, beta, e,
+                          speed, width, height, exact);
+    if (bad) {
+      _mm256_storeu_ps(ev, e);
+    }
+    while (bad) {
+      b = __builtin_ctz(bad);
+      bad &= bad - 1;
+      Simd::move_scalar(px + i, py + i, pf + i, pc + i, ps + i,
+                        pn + i, pl + i, pr + i, b, b + 1,
+                        alpha, beta, noise, ev, speed, width, height);
+    }
+  }
+  if (i < count) {
+    for (b = 0; b < 8; ++b) {
+      x[b] = i + b < count ? px[i + b] : 0.0f;
+      y[b] = i + b < count ? py[i + b] : 0.0f;
+      f[b] = i + b < count ? pf[i + b] : 0.0f;
+      n[b] = i + b < count ? pn[i + b] : 0;
+      l[b] = i + b < count ? pl[i + b] : 0;
+      r[b] = i + b < count ? pr[i + b] : 0;
+      id[b] = i + b < count && nullptr != pid ? pid[i + b] : 0;
+    }
+    e = nullptr == pid ? vnoise
+                       : noise_block_avx2(id, stddev, stream, tick, exact);
+    _mm256_storeu_ps(ev, e);
+    bad = move_block_avx2(x, y, f, c, s, n, l, r, alpha, beta, e,
+                          speed, width, height, exact);
+    for (b = 0; i + b < count; ++b) {
+      px[i + b] = x[b];
+      py[i + b] = y[b];
+      pf[i + b] = f[b];
+      pc[i + b] = c[b];
+      ps[i + b] = s[b];
+      if ((bad >> b) & 1) {
+        Simd::move_scalar(px + i, py + i, pf + i, pc + i, ps + i,
+                          pn + i, pl + i, pr + i, b, b + 1,
+                          alpha, beta, noise, ev, speed, width, height);
+      }
+    }
+  }
+  _mm256_zeroupper(); // avoid AVX-SSE transition penalties afterwards
+}
+
+
+// normal_block_sse(): Normally distributed numbers of the sixteen elements
+//                     of four counters from ctr on, see Simd::normal(). Same
+//                     as Rng::words() and Rng::gauss(), lane by lane.
+
+__attribute__((target("sse2"))) static inline void
+normal_block_sse(float* out, unsigned int ctr, float stddev, RngStream stream,
+                 unsigned long long tick, bool exact)
+{
+  __m128i low = _mm_set1_epi64x(0xffffffffu);
+  __m128i id = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(ctr)),
+                             _mm_setr_epi32(0, 1, 2, 3));
+  __m128i even[4];
+  __m128i odd[4];
+  __m128i w[4];
+  __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+  __m128 vstddev = _mm_set1_ps(stddev);
+  __m128 r;
+  __m128 a;
+  __m128 c;
+  __m128 s;
+  __m128 z[4];
+  unsigned int cw[4][4];
+
+  even[0] = id;
+  odd[0] = _mm_srli_epi64(id, 32);
+  even[1] = odd[1] = _mm_set1_epi32(static_cast<int>(stream));
+  even[2] = odd[2] = _mm_set1_epi32(static_cast<int>(tick));
+  even[3] = odd[3] = _mm_set1_epi32(static_cast<int>(tick >> 32));
+  philox_sse(even, odd, Rng::key());
+  for (unsigned int k = 0; k < 4; ++k) {
+    w[k] = _mm_or_si128(_mm_and_si128(even[k], low),
+                        _mm_slli_epi64(odd[k], 32));
+  }
+  if (exact) {
+    for (unsigned int k = 0; k < 4; ++k) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(cw[k]), w[k]);
+    }
+    for (unsigned int i = 0; i < 4; ++i) {
+      Rng::gauss(cw[0][i], cw[1][i], out[4 * i], out[4 * i + 1]);
+      Rng::gauss(cw[2][i], cw[3][i], out[4 * i + 2], out[4 * i + 3]);
+      for (unsigned int k = 0; k < 4; ++k) {
+        out[4 * i + k] = stddev * out[4 * i + k];
+      }
+    }
+    return;
+  }
+  // the words are shifted to 24 bits, which convert as signed just as well
+  for (unsigned int k = 0; k < 4; k += 2) {
+    r = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(
+      _mm_cvtepi32_ps(_mm_srli_epi32(w[k], 8)), scale));
+    r = _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2.0f), log_sse(r)));
+    a = _mm_mul_ps(_mm_set1_ps(TAU), _mm_mul_ps(
+      _mm_cvtepi32_ps(_mm_srli_epi32(w[k + 1], 8)), scale));
+    sincos_sse(a, c, s);
+    z[k] = _mm_mul_ps(vstddev, _mm_mul_ps(r, c));
+    z[k + 1] = _mm_mul_ps(vstddev, _mm_mul_ps(r, s));
+  }
+  // from a number of each counter per vector to the numbers of a counter
+  _MM_TRANSPOSE4_PS(z[0], z[1], z[2], z[3]);
+  for (unsigned int k = 0; k < 4; ++k) {
+    _mm_storeu_ps(out + 4 * k, z[k]);
+  }
+}
+
+
+// normal_block_avx2(): Normally distributed numbers of the 32 elements of
+//                      eight counters from ctr on, see normal_block_sse().
+
+__attribute__((target("avx2"))) static inline void
+normal_block_avx2(float* out, unsigned int ctr, float stddev,
+                  RngStream stream, unsigned long long tick, bool exact)
+{
+  __m256i id = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(ctr)),
+                                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  __m256i even[4];
+  __m256i odd[4];
+  __m256i w[4];
+  __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f);
+  __m256 vstddev = _mm256_set1_ps(stddev);
+  __m256 r;
+  __m256 a;
+  __m256 c;
+  __m256 s;
+  __m256 z[4];
+  __m256 t[4];
+  unsigned int cw[4][8];
+
+  even[0] = id;
+  odd[0] = _mm256_srli_epi64(id, 32);
+  even[1] = odd[1] = _mm256_set1_epi32(static_cast<int>(stream));
+  even[2] = odd[2] = _mm256_set1_epi32(static_cast<int>(tick));
+  even[3] = odd[3] = _mm256_set1_epi32(static_cast<int>(tick >> 32));
+  philox_avx2(even, odd, Rng::key());
+  for (unsigned int k = 0; k < 4; ++k) {
+    w[k] = _mm256_blend_epi32(even[k], _mm256_slli_epi64(odd[k], 32), 0xaa);
+  }
+  if (exact) {
+    for (unsigned int k = 0; k < 4; ++k) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(cw[k]), w[k]);
+    }
+    for (unsigned int i = 0; i < 8; ++i) {
+      Rng::gauss(cw[0][i], cw[1][i], out[4 * i], out[4 * i + 1]);
+      Rng::gauss(cw[2][i], cw[3][i], out[4 * i + 2], out[4 * i + 3]);
+      for (unsigned int k = 0; k < 4; ++k) {
+        out[4 * i + k] = stddev * out[4 * i + k];
+      }
+    }
+    return;
+  }
+  for (unsigned int k = 0; k < 4; k += 2) {
+    r = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(
+      _mm256_cvtepi32_ps(_mm256_srli_epi32(w[k], 8)), scale));
+    r = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), log_avx2(r)));
+    a = _mm256_mul_ps(_mm256_set1_ps(TAU), _mm256_mul_ps(
+      _mm256_cvtepi32_ps(_mm256_srli_epi32(w[k + 1], 8)), scale));
+    sincos_avx2(a, c, s);
+    z[k] = _mm256_mul_ps(vstddev, _mm256_mul_ps(r, c));
+    z[k + 1] = _mm256_mul_ps(vstddev, _mm256_mul_ps(r, s));
+  }
+  // transposed within each half as in normal_block_sse(), which leaves
+  // counters 0 to 3 in the low halves and 4 to 7 in the high ones
+  t[0] = _mm256_unpacklo_ps(z[0], z[1]);
+  t[1] = _mm256_unpackhi_ps(z[0], z[1]);
+  t[2] = _mm256_unpacklo_ps(z[2], z[3]);
+  t[3] = _mm256_unpackhi_ps(z[2], z[3]);
+  z[0] = _mm256_shuffle_ps(t[0], t[2], _MM_SHUFFLE(1, 0, 1, 0));
+  z[1] = _mm256_shuffle_ps(t[0], t[2], _MM_SHUFFLE(3, 2, 3, 2));
+  z[2] = _mm256_shuffle_ps(t[1], t[3], _MM_SHUFFLE(1, 0, 1, 0));
+  z[3] = _mm256_shuffle_ps(t[1], t[3], _MM_SHUFFLE(3, 2, 3, 2));
+  _mm256_storeu_ps(out, _mm256_permute2f128_ps(z[0], z[1], 0x20));
+  _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(z[2], z[3], 0x20));
+  _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(z[0], z[1], 0x31));
+  _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(z[2], z[3], 0x31));
+}
+
+
+__attribute__((target("sse2"))) void
+Simd::normal_sse(float* out, unsigned int count, float stddev,
+                 RngStream stream, unsigned long long tick, bool exact)
+{
+  float o[16];
+  unsigned int i = 0;
+
+  for (; i + 16 <= count; i += 16) {
+    normal_block_sse(out + i, i / 4, stddev, stream, tick, exact);
+  }
+  if (i == count) {
+    return;
+  }
+  // the tail is done in one more step into a copy
+  normal_block_sse(o, i / 4, stddev, stream, tick, exact);
+  for (unsigned int b = 0; i + b < count; ++b) {
+    out[i + b] = o[b];
+  }
+}
+
+
+__attribute__((target("avx2"))) void
+Simd::normal_avx2(float* out, unsigned int count, float stddev,
+                  RngStream stream, unsigned long long tick, bool exact)
+{
+  float o[32];
+  unsigned int i = 0;
+
+  // see normal_sse()
+  for (; i + 32 <= count; i += 32) {
+    normal_block_avx2(out + i, i / 4, stddev, stream, tick, exact);
+  }
+  if (i < count) {
+    normal_block_avx2(o, i / 4, stddev, stream, tick, exact);
+    for (unsigned int b = 0; i + b < count; ++b) {
+      out[i + b] = o[b];
+    }
+  }
+  _mm256_zeroupper(); // avoid AVX-SSE transition penalties afterwards
+}
+
+#else
+
+void
+Simd::compare_sse(const float* x, const float* y,
+                  const float* c, const float* s,
+                  const float* offx, const float* offy,
+                  const int* index, unsigned int count, int skip,
+                  float srcx, float srcy, float srcc, float srcs,
+                  float scopesq, float* distsq, unsigned int& in,
+                  unsigned int& srcright, unsigned int& dstright)
+{
+  in = 0;
+  srcright = 0;
+  dstright = 0;
+  Simd::compare_scalar(x, y, c, s, offx, offy, index, 0, count, skip,
+                       srcx, srcy, srcc, srcs, scopesq,
+                       distsq, in, srcright, dstright);
+}
+
+
+void
+Simd::compare_avx2(const float* x, const float* y,
+                   const float* c, const float* s,
+                   const float* offx, const float* offy,
+                   const int* index, unsigned int count, int skip,
+                   float srcx, float srcy, float srcc, float srcs,
+                   float scopesq, float* distsq, unsigned int& in,
+                   unsigned int& srcright, unsigned int& dstright)
+{
+  Simd::compare_sse(x, y, c, s, offx, offy, index, count, skip,
+                    srcx, srcy, srcc, srcs, scopesq,
+                    distsq, in, srcright, dstright);
+}
+
+
+void
+Simd::move_sse(float* px, float* py, float* pf, float* pc, float* ps,
+               const unsigned int* pn, const unsigned int* pl,
+               const unsigned int* pr, unsigned int count,
+               float alpha, float beta, float noise, const unsigned int* pid,
+               float stddev, RngStream stream, unsigned long long tick,
+               float speed, float width, float height, bool /* exact */)
+{
+  Simd::move_ids(px, py, pf, pc, ps, pn, pl, pr, count, alpha, beta,
+                 noise, pid, stddev, stream, tick, speed, width, height);
+}
+
+
+void
+Simd::move_avx2(float* px, float* py, float* pf, float* pc, float* ps,
+                const unsigned int* pn, const unsigned int* pl,
+                const unsigned int* pr, unsigned int count,
+                float alpha, float beta, float noise, const unsigned int* pid,
+                float stddev, RngStream stream, unsigned long long tick,
+                float speed, float width, float height, bool exact)
+{
+  Simd::move_sse(px, py, pf, pc, ps, pn, pl, pr, count, alpha, beta,
+                 noise, pid, stddev, stream, tick, speed, width, height,
+                 exact);
+}
+
+
+void
+Simd::normal_sse(float* out, unsigned int count, float stddev,
+                 RngStream stream, unsigned long long tick, bool /* exact */)
+{
+  Rng::normal(out, count, stddev, stream, tick);
+}
+
+
+void
+Simd::normal_avx2(float* out, unsigned int count, float stddev,
+                  RngStream stream, unsigned long long tick, bool exact)
+{
+  Simd::normal_sse(out, count, stddev, stream, tick, exact);
+}
+
+#endif /* SIMD_X86 */
@@ -0,0 +1,224 @@
+//===-- proc/simd.hh - Simd class declaration ------------------*- C++ -*-===//
+///
+/// \file
+/// Declaration of the Simd class, which provides vectorised versions of the
+/// innermost seek calculations, of the move, and of the bulk generation of
+/// normally distributed random numbers. The instruction set is
+/// picked at runtime, falling back to plain scalar code if no suitable one
+/// is available.
+///
+//===---------------------------------------------------------------------===//
+
+#pragma once
+
+#include "../util/rng.hh"
+#include <string>
+
+
+// SimdLevel: Instruction set used by Simd.
+
+enum class SimdLevel
+{
+  Scalar = 0,
+  Sse,
+  Avx2
+};
+
+
+class Simd
+{
+ public:
+  /// block: Maximum number of candidates per compare() call, which is the
+  ///        number of bits in each of its masks.
+  static const unsigned int block = 32;
+
+  /// pad: Number of entries past the last candidate that compare() may
+  ///      read, so that it can do the last few candidates in one step.
+  static const unsigned int pad = 8;
+
+  /// compare(): Compare a source particle to a contiguous block of candidate
+  ///            particles. The calculations are the same as the ones of
+  ///            Proc::plain_seek_vicinity() and Proc::tally_neighborhood(), so
+  ///            the results are identical whichever level is in use.
+  ///            The candidate arrays must be readable for Simd::pad entries
+  ///            past count, whatever they hold there.
+  /// \param x  candidate X parameters
+  /// \param y  candidate Y parameters
+  /// \param c  candidate cos(PHI) parameters
+  /// \param s  candidate sin(PHI) parameters
+  /// \param offx  candidate x wrapping offsets (-width, 0, or width)
+  /// \param offy  candidate y wrapping offsets (-height, 0, or height)
+  /// \param index  candidate particle indices
+  /// \param count  number of candidates (at most Simd::block)
+  /// \param skip  candidates with this index are left out (ie. src)
+  /// \param srcx  source X parameter
+  /// \param srcy  source Y parameter
+  /// \param srcc  source cos(PHI) parameter
+  /// \param srcs  source sin(PHI) parameter
+  /// \param scopesq  squared vicinity radius
+  /// \param distsq  squared distances to the candidates, for up to
+  ///                Simd::block of them (output)
+  /// \param in  bit i set if candidate i is within scope and not skipped
+  ///            (output)
+  /// \param srcright  bit i set if candidate i is right of src (output)
+  /// \param dstright  bit i set if src is right of candidate i (output)
+  static void compare(const float* x, const float* y,
+                      const float* c, const float* s,
+                      const float* offx, const float* offy,
+                      const int* index, unsigned int count, int skip,
+                      float srcx, float srcy, float srcc, float srcs,
+                      float scopesq, float* distsq,
+                      unsigned int& in, unsigned int& srcright,
+                      unsigned int& dstright);
+
+  /// move(): Move particles, ie. turn them by the main formula and step them
+  ///         forward, as in Proc::plain_move(). Headings and positions are
+  ///         wrapped by comparing and subtracting, which gives the same
+  ///         result as fmod() for the usual ranges; particles outside of
+  ///         them are moved by the scalar code. If exact, cos(PHI) and
+  ///         sin(PHI) come from cosf() and sinf(), so that the results are
+  ///         identical to the scalar ones whichever level is in use, else
+  ///         from a vectorised polynomial approximation (within a few units
+  ///         in the last place).
+  /// \param px  X parameters
+  /// \param py  Y parameters
+  /// \param pf  PHI parameters
+  /// \param pc  cos(PHI) parameters
+  /// \param ps  sin(PHI) parameters
+  /// \param pn  N parameters
+  /// \param pl  L parameters
+  /// \param pr  R parameters
+  /// \param count  number of particles
+  /// \param alpha  alpha in main formula (radians)
+  /// \param beta  beta in main formula (radians)
+  /// \param noise  heading noise added to every particle (radians)
+  /// \param pid  stable IDs; unless nullptr, the heading noise of particle i
+  ///             is added instead of noise, drawn in the vector registers
+  ///             as element pid[i] of Rng::normal() (radians)
+  /// \param stddev  standard deviation of the noise of each particle
+  /// \param stream  stream of the noise of each particle
+  /// \param tick  tick of the noise of each particle
+  /// \param speed  movement multiplier
+  /// \param width  space width
+  /// \param height  space height
+  /// \param exact  whether to stay identical to the scalar code
+  static void move(float* px, float* py, float* pf, float* pc, float* ps,
+                   const unsigned int* pn, const unsigned int* pl,
+                   const unsigned int* pr, unsigned int count,
+                   float alpha, float beta, float noise,
+                   const unsigned int* pid, float stddev, RngStream stream,
+                   unsigned long long tick, float speed, float width,
+                   float height, bool exact);
+
+  /// normal(): Fill with normally distributed numbers, as Rng::normal() does
+  ///           from element 0. The Philox counters are run in vector
+  ///           registers. If exact, the Box-Muller transform uses logf(),
+  ///           cosf() and sinf(), so that the results are identical to
+  ///           Rng::normal() whichever level is in use, else a vectorised
+  ///           polynomial approximation.
+  /// \param out  numbers (output)
+  /// \param count  number of elements
+  /// \param stddev  standard deviation
+  /// \param stream  stream
+  /// \param tick  tick
+  /// \param exact  whether to stay identical to Rng::normal()
+  static void normal(float* out, unsigned int count, float stddev,
+                     RngStream stream, unsigned long long tick, bool exact);
+
+  /// level(): Get the instruction set in use.
+  /// \returns  instruction set in use
+  static SimdLevel level();
+
+  /// level(): Set the instruction set to use, eg. for testing. Levels that
+  ///          the CPU does not support are lowered to the best one it does.
+  /// \param level  instruction set to use
+  /// \returns  instruction set in use
+  static SimdLevel level(SimdLevel level);
+
+  /// name(): Get name of an instruction set.
+  /// \param level  instruction set
+  /// \returns  name of instruction set
+  static std::string name(SimdLevel level);
+
+ private:
+  /// detect(): Find the best instruction set supported by the CPU.
+  /// \returns  best supported instruction set
+  static SimdLevel detect();
+
+  /// compare_scalar(): Scalar version of compare().
+  static void compare_scalar(const float* x, const float* y,
+                             const float* c, const float* s,
+                             const float* offx, const float* offy,
+                             const int* index, unsigned int from,
+                             unsigned int count, int skip,
+                             float srcx, float srcy, float srcc, float srcs,
+                             float scopesq, float* distsq, unsigned int& in,
+                             unsigned int& srcright, unsigned int& dstright);
+
+  /// compare_sse(): SSE version of compare().
+  static void compare_sse(const float* x, const float* y,
+                          const float* c, const float* s,
+                          const float* offx, const float* offy,
+                          const int* index, unsigned int count, int skip,
+                          float srcx, float srcy, float srcc, float srcs,
+                          float scopesq, float* distsq, unsigned int& in,
+                          unsigned int& srcright, unsigned int& dstright);
+
+  /// compare_avx2(): AVX2 version of compare().
+  static void compare_avx2(const float* x, const float* y,
+                           const float* c, const float* s,
+                           const float* offx, const float* offy,
+                           const int* index, unsigned int count, int skip,
+                           float srcx, float srcy, float srcc, float srcs,
+                           float scopesq, float* distsq, unsigned int& in,
+                           unsigned int& srcright, unsigned int& dstright);
+
+  /// move_scalar(): Scalar version of move(), for particles from to count,
+  ///                with the heading noise pe of each unless nullptr.
+  static void move_scalar(float* px, float* py, float* pf,
+                          float* pc, float* ps, const unsigned int* pn,
+                          const unsigned int* pl, const unsigned int* pr,
+                          unsigned int from, unsigned int count,
+                          float alpha, float beta, float noise,
+                          const float* pe, float speed,
+                          float width, float height);
+
+  /// move_ids(): Scalar version of move().
+  static void move_ids(float* px, float* py, float* pf, float* pc,
+                       float* ps, const unsigned int* pn,
+                       const unsigned int* pl, const unsigned int* pr,
+                       unsigned int count, float alpha, float beta,
+                       float noise, const unsigned int* pid, float stddev,
+                       RngStream stream, unsigned long long tick,
+                       float speed, float width, float height);
+
+  /// move_sse(): SSE version of move().
+  static void move_sse(float* px, float* py, float* pf, float* pc, float* ps,
+                       const unsigned int* pn, const unsigned int* pl,
+                       const unsigned int* pr, unsigned int count,
+                       float alpha, float beta, float noise,
+                       const unsigned int* pid, float stddev,
+                       RngStream stream, unsigned long long tick,
+                       float speed, float width, float height, bool exact);
+
+  /// move_avx2(): AVX2 version of move().
+  static void move_avx2(float* px, float* py, float* pf, float* pc,
+                        float* ps, const unsigned int* pn,
+                        const unsigned int* pl, const unsigned int* pr,
+                        unsigned int count, float alpha, float beta,
+                        float noise, const unsigned int* pid, float stddev,
+                        RngStream stream, unsigned long long tick,
+                        float speed, float width, float height, bool exact);
+
+  /// normal_sse(): SSE version of normal().
+  static void normal_sse(float* out, unsigned int count, float stddev,
+                         RngStream stream, unsigned long long tick,
+                         bool exact);
+
+  /// normal_avx2(): AVX2 version of normal().
+  static void normal_avx2(float* out, unsigned int count, float stddev,
+                          RngStream stream, unsigned long long tick,
+                          bool exact);
+
+  static SimdLevel level_; // instruction set in use
+};
@@ -0,0 +1,120 @@
+//===-- proc/tally.hh - tally policy classes -------------------*- C++ -*-===//
+///
+/// \file
+/// Declaration and definition of the tally policies, which decide what
+/// Proc::plain_seek() does with every pair of particles within scope. Being
+/// template parameters rather than function pointers, they are resolved at
+/// compile time and inlined into the seek loop. Policies with lists set
+/// record the pairs they are handed, from which Proc::list() then fills the
+/// neighbor lists.
+///
+//===---------------------------------------------------------------------===//
+
+#pragma once
+
+#include "proc.hh"
+
+
+// TallyNeighborhood: Update N, L, R and the neighbor lists, see
+//                    Proc::tally_neighborhood().
+
+class TallyNeighborhood
+{
+ public:
+  static const bool lists = true;
+
+  TallyNeighborhood(Proc& proc) : proc_(proc) {}
+
+  inline void
+  operator()(int srci, int dsti, float dx, float dy, float distsq)
+  {
+    this->proc_.tally_neighborhood(srci, dsti, dx, dy, distsq);
+  }
+
+ private:
+  Proc& proc_;
+};
+
+
+// TallyNeighbors: Update the neighbor sets used by DBSCAN, see
+//                 Proc::tally_neighbors().
+
+class TallyNeighbors
+{
+ public:
+  static const bool lists = false;
+
+  TallyNeighbors(Proc& proc) : proc_(proc) {}
+
+  inline void
+  operator()(int srci, int dsti, float dx, float dy, float distsq)
+  {
+    this->proc_.tally_neighbors(srci, dsti, dx, dy, distsq);
+  }
+
+ private:
+  Proc& proc_;
+};
+
+
+// TallyAlt: Update the alternative N, see Proc::tally_alt().
+
+class TallyAlt
+{
+ public:
+  static const bool lists = false;
+
+  TallyAlt(Proc& proc) : proc_(proc) {}
+
+  inline void
+  operator()(int srci, int dsti, float dx, float dy, float distsq)
+  {
+    this->proc_.tally_alt(srci, dsti, dx, dy, distsq);
+  }
+
+ private:
+  Proc& proc_;
+};
+
+
+// TallyCounts: Update N, L, R only, see Proc::tally_counts().
+
+class TallyCounts
+{
+ public:
+  static const bool lists = false;
+
+  TallyCounts(Proc& proc) : proc_(proc) {}
+
+  inline void
+  operator()(int srci, int dsti, float dx, float dy, float distsq)
+  {
+    this->proc_.tally_counts(srci, dsti, dx, dy, distsq);
+  }
+
+ private:
+  Proc& proc_;
+};
+
+
+// TallyFunction: Call any tallying function of Proc, for which there is no
+//                policy of its own. Not inlined.
+
+class TallyFunction
+{
+ public:
+  static const bool lists = false;
+
+  TallyFunction(Proc& proc, void (Proc::*tally)(int,int,float,float,float))
+    : proc_(proc), tally_(tally) {}
+
+  inline void
+  operator()(int srci, int dsti, float dx, float dy, float distsq)
+  {
+    (this->proc_.*(this->tally_))(srci, dsti, dx, dy, distsq);
+  }
+
+ private:
+  Proc& proc_;
+  void (Proc::*tally_)(int,int,float,float,float);
+};
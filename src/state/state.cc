@@ -1,5 +1,6 @@
 #include "state.hh"
 #include "../util/common.hh"
+#include "../util/rng.hh"
 #include "../util/util.hh"
 
 
@@ -21,8 +22,9 @@ State::State(Log& log, ExpControl& expctrl)
   // derived
   this->scope_squared_ = this->scope_ * this->scope_;
   this->ascope_squared_ = this->ascope_ * this->ascope_;
-  // fixed
-  this->n_stride_ = 100;
+  // neighbor lists, all empty so far
+  this->plo_.assign(1, 0);
+  this->pro_.assign(1, 0);
 
   expctrl.state(*this);
   this->spawn();
@@ -37,26 +39,26 @@ State::spawn()
   float w = static_cast<float>(this->width_);
   float h = static_cast<float>(this->height_);
   unsigned int num = this->num_;
-  unsigned int n_stride = this->n_stride_;
+  unsigned long long tick = Rng::ticket();
 
+  // drawn in bulk, each particle from its own counter
   if (!this->expctrl_.spawn(*this)) {
-    for (int i = 0; i < num; ++i) {
-      this->px_.push_back(Util::distr(0.0f, w));
-      this->py_.push_back(Util::distr(0.0f, h));
-    }
+    this->px_.resize(num);
+    this->py_.resize(num);
+    Rng::uniform(this->px_.data(), num, 0.0f, w, RngStream::SpawnX, tick);
+    Rng::uniform(this->py_.data(), num, 0.0f, h, RngStream::SpawnY, tick);
   }
+  this->pf_.resize(num);
+  Rng::uniform(this->pf_.data(), num, 0.0f, TAU, RngStream::SpawnPhi, tick);
   for (int i = 0; i < num; ++i) {
-    this->pf_.push_back(Util::distr(0.0f, TAU));
     this->pc_.push_back(cosf(this->pf_[i]));
     this->ps_.push_back(sinf(this->pf_[i]));
     this->pn_.push_back(0);
     this->pl_.push_back(0);
     this->pr_.push_back(0);
     this->pan_.push_back(0);
-    for (int j = 0; j < n_stride; ++j) { this->pls_.push_back(-1); }
-    for (int j = 0; j < n_stride; ++j) { this->prs_.push_back(-1); }
-    for (int j = 0; j < n_stride; ++j) { this->pld_.push_back(-1.0f); }
-    for (int j = 0; j < n_stride; ++j) { this->prd_.push_back(-1.0f); }
+    this->plo_.push_back(this->plo_.back());
+    this->pro_.push_back(this->pro_.back());
     this->pt_.push_back(Type::None);
     this->gcol_.push_back(0);
     this->grow_.push_back(0);
@@ -64,6 +66,8 @@ State::spawn()
     this->xg_.push_back(1.0f);
     this->xb_.push_back(1.0f);
     this->xa_.push_back(0.5f);
+    this->pid_.push_back(i);
+    this->pidx_.push_back(i);
   }
 }
 
@@ -84,6 +88,8 @@ State::clear()
   this->prs_.clear();
   this->pld_.clear();
   this->prd_.clear();
+  this->plo_.assign(1, 0);
+  this->pro_.assign(1, 0);
   this->pt_.clear();
   this->gcol_.clear();
   this->grow_.clear();
@@ -91,6 +97,8 @@ State::clear()
   this->xg_.clear();
   this->xb_.clear();
   this->xa_.clear();
+  this->pid_.clear();
+  this->pidx_.clear();
 }
 
 
@@ -144,3 +152,78 @@ State::dpe()
   return static_cast<float>(this->num_) / this->width_ / this->height_;
 }
 
+
+
+void
+State::reorder(const std::vector<int>& order)
+{
+  unsigned int num = this->num_;
+
+  State::permute(this->px_, order);
+  State::permute(this->py_, order);
+  State::permute(this->pf_, order);
+  State::permute(this->pc_, order);
+  State::permute(this->ps_, order);
+  State::permute(this->pn_, order);
+  State::permute(this->pl_, order);
+  State::permute(this->pr_, order);
+  State::permute(this->pan_, order);
+  State::permute(this->pt_, order);
+  State::permute(this->gcol_, order);
+  State::permute(this->grow_, order);
+  State::permute(this->xr_, order);
+  State::permute(this->xg_, order);
+  State::permute(this->xb_, order);
+  State::permute(this->xa_, order);
+  State::permute(this->pid_, order);
+
+  // neighbor indices still point to old indices
+  std::vector<int> moved(num);
+  for (unsigned int i = 0; i < num; ++i) {
+    moved[order[i]] = i;
+  }
+  State::permute_lists(this->pls_, this->pld_, this->plo_, order, moved);
+  State::permute_lists(this->prs_, this->prd_, this->pro_, order, moved);
+
+  for (unsigned int i = 0; i < num; ++i) {
+    this->pidx_[this->pid_[i]] = i;
+  }
+}
+
+
+template <typename T>
+void
+State::permute(std::vector<T>& param, const std::vector<int>& order)
+{
+  std::vector<T> old(param);
+  unsigned int num = order.size();
+
+  for (unsigned int i = 0; i < num; ++i) {
+    param[i] = old[order[i]];
+  }
+}
+
+
+void
+State::permute_lists(std::vector<int>& ns, std::vector<float>& nd,
+                     std::vector<unsigned int>& no,
+                     const std::vector<int>& order,
+                     const std::vector<int>& moved)
+{
+  std::vector<int> oldns(ns);
+  std::vector<float> oldnd(nd);
+  std::vector<unsigned int> oldno(no);
+  unsigned int num = order.size();
+  unsigned int j = 0;
+
+  // the lists keep their lengths, so only their offsets change
+  for (unsigned int i = 0; i < num; ++i) {
+    no[i] = j;
+    for (unsigned int k = oldno[order[i]]; k < oldno[order[i] + 1]; ++k) {
+      ns[j] = moved[oldns[k]];
+      nd[j] = oldnd[k];
+      ++j;
+    }
+  }
+  no[num] = j;
+}
@@ -86,6 +86,13 @@ class State : public Subject
   /// \returns  dpe
   float dpe();
 
+  /// reorder(): Rearrange all particle parameters into a new memory order,
+  ///            so that particles that are close in space are also close in
+  ///            memory. Neighbor indices are remapped, and particle IDs move
+  ///            along with their particles, so pidx_ keeps finding them.
+  /// \param order  old index of the particle to be placed at each new index
+  void reorder(const std::vector<int>& order);
+
   //// particle (volatile)
   // location & direction
   std::vector<float> px_;         // X parameter
@@ -98,10 +105,12 @@ class State : public Subject
   std::vector<unsigned int> pl_;  // L parameter
   std::vector<unsigned int> pr_;  // R parameter
   std::vector<unsigned int> pan_; // alternative N parameter (for spores)
-  std::vector<int>          pls_; // L neighbor indices (signed!)
-  std::vector<int>          prs_; // R neighbor indices (signed!)
+  std::vector<int>          pls_; // L neighbor indices
+  std::vector<int>          prs_; // R neighbor indices
   std::vector<float>        pld_; // L neighbor distances
   std::vector<float>        prd_; // R neighbor distances
+  std::vector<unsigned int> plo_; // offsets of each L neighbor list (num + 1)
+  std::vector<unsigned int> pro_; // offsets of each R neighbor list (num + 1)
   std::vector<Type>         pt_;  // type (nutrient, mature spore, ring, etc.)
   // grid
   std::vector<int> gcol_;         // grid column the particle is in
@@ -111,6 +120,9 @@ class State : public Subject
   std::vector<float> xg_;         // green
   std::vector<float> xb_;         // blue
   std::vector<float> xa_;         // opacity
+  // identity
+  std::vector<unsigned int> pid_;  // stable ID of the particle at an index
+  std::vector<unsigned int> pidx_; // current index of the particle with an ID
 
   // transportable
   int          num_;      // # particles (negative for encoding input error)
@@ -129,10 +141,25 @@ class State : public Subject
   float scope_squared_;
   float ascope_squared_;
 
-  // fixed
-  unsigned int n_stride_;         // neighbor list stride
-
  private:
+  /// permute(): Rearrange a particle parameter into a new memory order.
+  /// \param param  particle parameter
+  /// \param order  old index of the particle to be placed at each new index
+  template <typename T>
+  static void permute(std::vector<T>& param, const std::vector<int>& order);
+
+  /// permute_lists(): Rearrange neighbor lists into a new memory order, and
+  ///                  remap the neighbor indices in them.
+  /// \param ns  neighbor indices
+  /// \param nd  neighbor distances
+  /// \param no  offsets of each neighbor list
+  /// \param order  old index of the particle to be placed at each new index
+  /// \param moved  new index of the particle at each old index
+  static void permute_lists(std::vector<int>& ns, std::vector<float>& nd,
+                            std::vector<unsigned int>& no,
+                            const std::vector<int>& order,
+                            const std::vector<int>& moved);
+
   ExpControl& expctrl_;
   Log&        log_;
 };
@@ -0,0 +1,91 @@
+#include "pool.hh"
+
+
+Pool::Pool(unsigned int size)
+  : task_(NULL), tasks_(0), next_(0), busy_(0), generation_(0), quit_(false)
+{
+  for (unsigned int i = 1; i < size; ++i) {
+    this->workers_.push_back(std::thread(&Pool::work, this));
+  }
+}
+
+
+Pool::~Pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->quit_ = true;
+  }
+  this->wake_.notify_all();
+  for (std::thread& worker : this->workers_) {
+    worker.join();
+  }
+}
+
+
+void
+Pool::run(unsigned int tasks, const std::function<void(unsigned int)>& task)
+{
+  if (this->workers_.empty()) {
+    for (unsigned int i = 0; i < tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->task_ = &task;
+    this->tasks_ = tasks;
+    this->next_ = 0;
+    this->busy_ = this->workers_.size();
+    ++this->generation_;
+  }
+  this->wake_.notify_all();
+
+  this->take();
+
+  std::unique_lock<std::mutex> lock(this->mutex_);
+  this->done_.wait(lock, [this] { return 0 == this->busy_; });
+  this->task_ = NULL;
+}
+
+
+void
+Pool::work()
+{
+  unsigned long seen = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(this->mutex_);
+      this->wake_.wait(lock, [this, seen] {
+        return this->quit_ || seen != this->generation_;
+      });
+      if (this->quit_) {
+        return;
+      }
+      seen = this->generation_;
+    }
+
+    this->take();
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    if (0 == --this->busy_) {
+      this->done_.notify_one();
+    }
+  }
+}
+
+
+void
+Pool::take()
+{
+  const std::function<void(unsigned int)>& task = *this->task_;
+  unsigned int tasks = this->tasks_;
+  unsigned int i;
+
+  while ((i = this->next_.fetch_add(1)) < tasks) {
+    task(i);
+  }
+}
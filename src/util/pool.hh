@@ -0,0 +1,61 @@
+//===-- util/pool.hh - Pool class declaration ------------------*- C++ -*-===//
+///
+/// \file
+/// Declaration of the Pool class, which keeps a fixed set of worker threads
+/// around so that processing can be split into independent tasks without
+/// spawning threads every tick.
+///
+//===---------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class Pool
+{
+ public:
+  /// constructor: Start the worker threads.
+  /// \param size  total number of threads, including the calling thread
+  Pool(unsigned int size);
+
+  /// destructor: Stop and join the worker threads.
+  ~Pool();
+
+  /// run(): Perform a batch of tasks and block until all of them are done.
+  ///        The calling thread takes part in the work.
+  /// \param tasks  number of tasks
+  /// \param task  function called once with the index of every task
+  void run(unsigned int tasks, const std::function<void(unsigned int)>& task);
+
+  /// size(): Number of threads performing tasks.
+  /// \returns  number of threads, including the calling thread
+  inline unsigned int
+  size() const
+  {
+    return this->workers_.size() + 1;
+  }
+
+ private:
+  /// work(): Worker thread loop.
+  void work();
+
+  /// take(): Perform tasks until none are left in the current batch.
+  void take();
+
+  std::vector<std::thread> workers_;
+  std::mutex               mutex_;
+  std::condition_variable  wake_;       // a new batch is available
+  std::condition_variable  done_;       // all workers finished the batch
+  const std::function<void(unsigned int)>* task_; // current batch function
+  unsigned int             tasks_;      // number of tasks in current batch
+  std::atomic<unsigned int> next_;      // index of next task to be taken
+  unsigned int             busy_;       // workers still on current batch
+  unsigned long            generation_; // batch counter
+  bool                     quit_;       // whether workers should stop
+};
@@ -0,0 +1,110 @@
+#include "rng.hh"
+#include "common.hh"
+#include <math.h> // cosf, logf, sinf, sqrtf
+#include <random>
+
+
+unsigned int Rng::key_[2] = {std::random_device()(), std::random_device()()};
+std::atomic<unsigned long long> Rng::draws_(0);
+
+
+void
+Rng::seed(unsigned long long seed)
+{
+  Rng::key_[0] = static_cast<unsigned int>(seed);
+  Rng::key_[1] = static_cast<unsigned int>(seed >> 32);
+  Rng::draws_ = 0;
+}
+
+
+unsigned long long
+Rng::seed()
+{
+  return (static_cast<unsigned long long>(Rng::key_[1]) << 32)
+         | Rng::key_[0];
+}
+
+
+void
+Rng::uniform(float* out, unsigned int count, float a, float b,
+             RngStream stream, unsigned long long tick,
+             unsigned int first /* = 0 */)
+{
+  unsigned int w[4];
+
+  for (unsigned int i = 0; i < count; ++i) {
+    Rng::words(stream, tick, first + i, w);
+    out[i] = a + (b - a) * Rng::unit(w[0]);
+  }
+}
+
+
+void
+Rng::normal(float* out, unsigned int count, float stddev,
+            RngStream stream, unsigned long long tick,
+            unsigned int first /* = 0 */)
+{
+  unsigned int w[4];
+  float z[4];
+  unsigned int k;
+
+  for (unsigned int i = 0; i < count; ++i) {
+    k = first + i;
+    if (0 == i || 0 == (k & 3)) {
+      Rng::words(stream, tick, k >> 2, w);
+      Rng::gauss(w[0], w[1], z[0], z[1]);
+      Rng::gauss(w[2], w[3], z[2], z[3]);
+    }
+    out[i] = stddev * z[k & 3];
+  }
+}
+
+
+unsigned long long
+Rng::ticket()
+{
+  return Rng::draws_++;
+}
+
+
+float
+Rng::uniform(float a, float b)
+{
+  float n;
+
+  Rng::uniform(&n, 1, a, b, RngStream::Draw, Rng::ticket());
+  return n;
+}
+
+
+int
+Rng::uniform(int a, int b)
+{
+  unsigned long long range = static_cast<long long>(b) - a + 1;
+  unsigned int w[4];
+
+  Rng::words(RngStream::Draw, Rng::ticket(), 0, w);
+  return a + static_cast<int>((w[0] * range) >> 32);
+}
+
+
+float
+Rng::normal(float stddev)
+{
+  float n;
+
+  Rng::normal(&n, 1, stddev, RngStream::Draw, Rng::ticket());
+  return n;
+}
+
+
+void
+Rng::gauss(unsigned int w0, unsigned int w1, float& z0, float& z1)
+{
+  // 1 - unit() is in (0, 1], so that the logarithm is finite
+  float r = sqrtf(-2.0f * logf(1.0f - Rng::unit(w0)));
+  float a = TAU * Rng::unit(w1);
+
+  z0 = r * cosf(a);
+  z1 = r * sinf(a);
+}
@@ -0,0 +1,174 @@
+//===-- util/rng.hh - Rng class declaration --------------------*- C++ -*-===//
+///
+/// \file
+/// Declaration of the Rng class, a counter-based random number generator
+/// (Philox4x32-10). Every number is a pure function of the seed, a stream, a
+/// tick and an element (eg. particle) index, so that numbers can be drawn in
+/// bulk, in any order and from any thread, and whole runs can be reproduced
+/// from the seed.
+///
+//===---------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+
+
+// RngStream: Purposes of random numbers, each of which draws from its own
+//            stream.
+
+enum class RngStream : unsigned int
+{
+  Draw = 0, // one-off draws, see Rng::uniform(float, float)
+  SpawnX,
+  SpawnY,
+  SpawnPhi,
+  Noise
+};
+
+
+class Rng
+{
+ public:
+  /// seed(): Set the seed of all streams. Unless set, it is picked from
+  ///         std::random_device at startup.
+  /// \param seed  seed
+  static void seed(unsigned long long seed);
+
+  /// seed(): Get the seed of all streams.
+  /// \returns  seed
+  static unsigned long long seed();
+
+  /// key(): Get the Philox key, ie. the seed split in words, for generators
+  ///        that run the counters themselves (eg. in vector registers or in
+  ///        OpenCL kernels).
+  /// \returns  two key words
+  static inline const unsigned int*
+  key()
+  {
+    return Rng::key_;
+  }
+
+  /// philox(): The Philox4x32-10 bijection, which turns a counter into four
+  ///           random words under a key.
+  /// \param ctr  counter, replaced by the random words
+  /// \param key  key
+  static inline void
+  philox(unsigned int ctr[4], const unsigned int key[2])
+  {
+    unsigned int k0 = key[0];
+    unsigned int k1 = key[1];
+    unsigned long long p0;
+    unsigned long long p1;
+
+    for (unsigned int round = 0; round < 10; ++round) {
+      p0 = 0xD2511F53ull * ctr[0];
+      p1 = 0xCD9E8D57ull * ctr[2];
+      ctr[0] = static_cast<unsigned int>(p1 >> 32) ^ ctr[1] ^ k0;
+      ctr[2] = static_cast<unsigned int>(p0 >> 32) ^ ctr[3] ^ k1;
+      ctr[1] = static_cast<unsigned int>(p1);
+      ctr[3] = static_cast<unsigned int>(p0);
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+  }
+
+  /// words(): The four random words of an element at a tick of a stream.
+  /// \param stream  stream
+  /// \param tick  tick
+  /// \param id  element index
+  /// \param words  random words (output)
+  static inline void
+  words(RngStream stream, unsigned long long tick, unsigned int id,
+        unsigned int words[4])
+  {
+    words[0] = id;
+    words[1] = static_cast<unsigned int>(stream);
+    words[2] = static_cast<unsigned int>(tick);
+    words[3] = static_cast<unsigned int>(tick >> 32);
+    Rng::philox(words, Rng::key_);
+  }
+
+  /// stream(): A stream of one of several independent worlds (see
+  ///           Ensemble), so that their numbers differ. World 0 is the
+  ///           stream itself.
+  /// \param stream  stream
+  /// \param world  index of the world
+  /// \returns  stream of the world
+  static inline RngStream
+  stream(RngStream stream, unsigned int world)
+  {
+    return static_cast<RngStream>(static_cast<unsigned int>(stream)
+                                  | (world << 8));
+  }
+
+  /// uniform(): Fill with uniformly distributed numbers in [a, b), element
+  ///            i getting the number of element first + i at tick.
+  /// \param out  numbers (output)
+  /// \param count  number of elements
+  /// \param a  start of range
+  /// \param b  end of range
+  /// \param stream  stream
+  /// \param tick  tick
+  /// \param first  index of the first element
+  static void uniform(float* out, unsigned int count, float a, float b,
+                      RngStream stream, unsigned long long tick,
+                      unsigned int first = 0);
+
+  /// normal(): Fill with normally distributed numbers of mean 0, element i
+  ///           getting the number of element first + i at tick. Each counter
+  ///           gives four numbers (two Box-Muller pairs), so element k comes
+  ///           from counter k / 4.
+  /// \param out  numbers (output)
+  /// \param count  number of elements
+  /// \param stddev  standard deviation
+  /// \param stream  stream
+  /// \param tick  tick
+  /// \param first  index of the first element
+  static void normal(float* out, unsigned int count, float stddev,
+                     RngStream stream, unsigned long long tick,
+                     unsigned int first = 0);
+
+  /// ticket(): Take a fresh tick of the Draw stream, for bulk draws that are
+  ///           not tied to a tick of processing (eg. spawning).
+  /// \returns  unused tick
+  static unsigned long long ticket();
+
+  /// uniform(): Draw a uniformly distributed number in [a, b).
+  /// \param a  start of range
+  /// \param b  end of range
+  /// \returns  uniformly distributed random number
+  static float uniform(float a, float b);
+
+  /// uniform(): Draw a uniformly distributed integer in [a, b].
+  /// \param a  start of range
+  /// \param b  end of range (included)
+  /// \returns  uniformly distributed random integer
+  static int uniform(int a, int b);
+
+  /// normal(): Draw a normally distributed number of mean 0.
+  /// \param stddev  standard deviation
+  /// \returns  normally distributed random number
+  static float normal(float stddev);
+
+  /// unit(): Map a random word to [0, 1).
+  /// \param word  random word
+  /// \returns  number in [0, 1)
+  static inline float
+  unit(unsigned int word)
+  {
+    return static_cast<float>(word >> 8) * (1.0f / 16777216.0f);
+  }
+
+  /// gauss(): Map two random words to two independent standard normal
+  ///          numbers by the Box-Muller transform.
+  /// \param w0  random word
+  /// \param w1  random word
+  /// \param z0  standard normal number, from the cosine (output)
+  /// \param z1  standard normal number, from the sine (output)
+  static void gauss(unsigned int w0, unsigned int w1, float& z0, float& z1);
+
+ private:
+  static unsigned int key_[2];                  // the seed, split in words
+  static std::atomic<unsigned long long> draws_; // ticks taken of Draw
+};
@@ -10,8 +10,8 @@
 #include <GL/glew.h>
 #include <iomanip>
 #include <iostream>
+#include "rng.hh"
 #include <math.h> // cosf, sinf, floor, fmod
-#include <random>
 #include <regex>
 #include <unistd.h> // readlink
 
@@ -54,7 +54,8 @@ class Util
 
   // math /////////////////////////////////////////////////////////////////////
 
-  /// distr(): Pick a number from a uniformly distributed range.
+  /// distr(): Pick a number from a uniformly distributed range, see
+  ///          Rng::uniform().
   /// \param a  start of range
   /// \param b  end of range
   /// \returns  uniformly distributed random number
@@ -65,20 +66,14 @@ class Util
   template<> inline int
   distr<int>(int a, int b)
   {
-    static std::random_device rd;
-    static std::mt19937 rng(rd());
-    std::uniform_int_distribution<int> distribution(a, b);
-    return distribution(rng);
+    return Rng::uniform(a, b);
   }
 
   /// float version of distr().
   template<> inline float
   distr<float>(float a, float b)
   {
-    static std::random_device rd;
-    static std::mt19937 rng(rd());
-    std::uniform_real_distribution<float> distribution(a, b);
-    return distribution(rng);
+    return Rng::uniform(a, b);
   }
 
   /// deg_to_rad(): Convert from degrees to radians.
@@ -119,15 +114,14 @@ class Util
     return (0 < n) - (n < 0);
   }
 
-  /// normal_noise(): Gaussian noise of heading, used by experiment 5.
-  /// \param
+  /// normal_noise(): Gaussian noise of heading, used by experiment 5. See
+  ///                 Rng::normal().
+  /// \param stddev  standard deviation
+  /// \returns  normally distributed random number
   static inline float
   normal_noise(float stddev)
   {
-    static std::random_device rd;
-    static std::mt19937 rng(rd());
-    std::normal_distribution<float> distribution(0.0f, stddev);
-    return distribution(rng);
+    return Rng::normal(stddev);
   }
 
   // string ///////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 #include "common.hh"
 #include "log.hh"
 #include "observation.hh"
+#include "rng.hh"
 #include "util.hh"
 
 
@@ -85,6 +86,93 @@ TEST_CASE("observation cycle")
 }
 
 
+// rng
+
+TEST_CASE("Rng::philox")
+{
+  // known answers of Philox4x32-10
+  unsigned int ctr[4] = {0, 0, 0, 0};
+  unsigned int key[2] = {0, 0};
+  Rng::philox(ctr, key);
+  REQUIRE(0x6627e8d5u == ctr[0]);
+  REQUIRE(0xe169c58du == ctr[1]);
+  REQUIRE(0xbc57ac4cu == ctr[2]);
+  REQUIRE(0x9b00dbd8u == ctr[3]);
+  unsigned int ctr_ones[4] = {0xffffffffu, 0xffffffffu,
+                              0xffffffffu, 0xffffffffu};
+  unsigned int key_ones[2] = {0xffffffffu, 0xffffffffu};
+  Rng::philox(ctr_ones, key_ones);
+  REQUIRE(0x408f276du == ctr_ones[0]);
+  REQUIRE(0x41c83b0eu == ctr_ones[1]);
+  REQUIRE(0xa20bc7c6u == ctr_ones[2]);
+  REQUIRE(0x6d5451fdu == ctr_ones[3]);
+  unsigned int ctr_pi[4] = {0x243f6a88u, 0x85a308d3u,
+                            0x13198a2eu, 0x03707344u};
+  unsigned int key_pi[2] = {0xa4093822u, 0x299f31d0u};
+  Rng::philox(ctr_pi, key_pi);
+  REQUIRE(0xd16cfe09u == ctr_pi[0]);
+  REQUIRE(0x94fdccebu == ctr_pi[1]);
+  REQUIRE(0x5001e420u == ctr_pi[2]);
+  REQUIRE(0x24126ea1u == ctr_pi[3]);
+}
+
+TEST_CASE("Rng fills")
+{
+  unsigned long long old = Rng::seed();
+  std::vector<float> a(1000);
+  std::vector<float> b(1000);
+  std::vector<float> c(1000);
+  Rng::seed(42);
+  Rng::uniform(a.data(), 1000, -1.0f, 3.0f, RngStream::SpawnX, 7);
+  Rng::seed(43);
+  Rng::uniform(c.data(), 1000, -1.0f, 3.0f, RngStream::SpawnX, 7);
+  Rng::seed(42);
+  Rng::uniform(b.data(), 1000, -1.0f, 3.0f, RngStream::SpawnX, 7);
+  REQUIRE(a == b);
+  REQUIRE(a != c);
+  // a fill of a subrange picks the same numbers
+  Rng::uniform(c.data(), 100, -1.0f, 3.0f, RngStream::SpawnX, 7, 500);
+  REQUIRE(std::equal(c.begin(), c.begin() + 100, a.begin() + 500));
+  // other streams and ticks differ
+  Rng::uniform(b.data(), 1000, -1.0f, 3.0f, RngStream::SpawnY, 7);
+  REQUIRE(a != b);
+  Rng::uniform(b.data(), 1000, -1.0f, 3.0f, RngStream::SpawnX, 8);
+  REQUIRE(a != b);
+  // and so do those of other worlds, but for the first
+  Rng::uniform(b.data(), 1000, -1.0f, 3.0f,
+               Rng::stream(RngStream::SpawnX, 0), 7);
+  REQUIRE(a == b);
+  Rng::uniform(b.data(), 1000, -1.0f, 3.0f,
+               Rng::stream(RngStream::SpawnX, 1), 7);
+  REQUIRE(a != b);
+  float sum = 0.0f;
+  for (float n : a) {
+    REQUIRE(-1.0f <= n);
+    REQUIRE(3.0f > n);
+    sum += n;
+  }
+  REQUIRE(Approx(1.0f).margin(0.1f) == sum / 1000);
+  std::vector<float> d(10000);
+  Rng::normal(d.data(), 10000, 2.0f, RngStream::Noise, 0);
+  float mean = 0.0f;
+  float var = 0.0f;
+  for (float n : d) {
+    mean += n / 10000;
+  }
+  for (float n : d) {
+    var += (n - mean) * (n - mean) / 10000;
+  }
+  REQUIRE(Approx(0.0f).margin(0.1f) == mean);
+  REQUIRE(Approx(4.0f).margin(0.2f) == var);
+  for (unsigned int i = 0; i < 1000; ++i) {
+    int n = Rng::uniform(-2, 2);
+    REQUIRE(-2 <= n);
+    REQUIRE(2 >= n);
+  }
+  Rng::seed(old);
+}
+
+
 // math
 
 TEST_CASE("Util::deg_to_rad")
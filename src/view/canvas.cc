@@ -27,6 +27,7 @@ Canvas::Canvas(Log& log, Control& ctrl, UiState& uistate,
   this->trail_ = false;
   this->trail_count_ = 0;
   this->trail_end_ = false;
+  this->shared_ = false;
   this->shift_counts_ = 5;
   this->shift_count_ = 0;
 
@@ -113,6 +114,9 @@ Canvas::~Canvas()
 {
   this->ctrl_.detach_from_state(*this);
   this->ctrl_.detach_from_proc(*this);
+  if (this->shared_) {
+    this->ctrl_.share(0);
+  }
   delete this->vertex_buffer_xyz_;
   delete this->vertex_buffer_rgba_;
   delete this->vertex_buffer_quad_;
@@ -273,12 +277,17 @@ Canvas::spawn()
   } else {
     this->next2d();
   }
+  this->share();
 }
 
 
 void
 Canvas::respawn()
 {
+  if (this->shared_) {
+    this->ctrl_.share(0); // before the buffer goes
+    this->shared_ = false;
+  }
   delete this->vertex_buffer_xyz_;
   delete this->vertex_buffer_rgba_;
   delete this->vertex_buffer_quad_;
@@ -368,15 +377,18 @@ Canvas::next2d()
   }
   trail = this->trail_count_;
 
-  // insert updated particle positions and colors (at trail tail)
+  // insert updated particle positions and colors (at trail tail), the
+  // positions being in vb_xyz already if shared with OpenCL
   xyzstride = trail * xyzspan;
   rgbastride = trail * rgbaspan;
   xyzi = 0;
   rgbai = 0;
-  for (int i = 0; i < num; ++i) {
+  for (int i = 0; i < num && !this->shared_; ++i) {
     xyz[xyzstride + xyzi++] = px[i];
     xyz[xyzstride + xyzi++] = py[i];
     xyz[xyzstride + xyzi++] = near;
+  }
+  for (int i = 0; i < num; ++i) {
     rgba[rgbastride + rgbai++] = xr[i];
     rgba[rgbastride + rgbai++] = xg[i];
     rgba[rgbastride + rgbai++] = xb[i];
@@ -386,13 +398,41 @@ Canvas::next2d()
 
   GLfloat* p_xyz = &xyz[0];
   GLfloat* p_rgba = &rgba[0];
-  vb_xyz->update(p_xyz, xyz.size() * sizeof(float));
+  if (!this->shared_) {
+    // (re)specifying the data of a shared buffer would cut it loose
+    vb_xyz->update(p_xyz, xyz.size() * sizeof(float));
+    va->add_buffer(0, *vb_xyz, VertexBufferAttribs::gen<GLfloat>(3, 3, 0));
+  }
   vb_rgba->update(p_rgba, rgba.size() * sizeof(float));
-  va->add_buffer(0, *vb_xyz, VertexBufferAttribs::gen<GLfloat>(3, 3, 0));
   va->add_buffer(1, *vb_rgba, VertexBufferAttribs::gen<GLfloat>(4, 4, 0));
 }
 
 
+void
+Canvas::share()
+{
+  State& state = this->ctrl_.state_;
+  std::vector<GLfloat>& xyz = this->xyz_;
+  bool share = !this->three_ && !this->trail_;
+
+  if (share == this->shared_) {
+    return;
+  }
+  if (!share) {
+    // the positions come back to the host, where the trail or the levels
+    // start off from them
+    this->ctrl_.share(0);
+    this->shared_ = false;
+    for (int i = 0; i < state.num_; ++i) {
+      xyz[3 * i] = state.px_[i];
+      xyz[3 * i + 1] = state.py_[i];
+    }
+    return;
+  }
+  this->shared_ = this->ctrl_.share(this->vertex_buffer_xyz_->id());
+}
+
+
 void
 Canvas::next3d()
 {
@@ -96,6 +96,7 @@ class Canvas : public View, Observer
     this->three_ = yesno;
     this->level_ = 1;
     this->shift_count_ = 0;
+    this->share();
   }
 
   /// trail(): Set trailing.
@@ -106,6 +107,7 @@ class Canvas : public View, Observer
     this->trail_ = yesno;
     this->trail_count_ = 0;
     this->trail_end_ = false;
+    this->share();
   }
 
   /// camera_set(): Apply the current MVP matrices and set the corresponding
@@ -117,6 +119,12 @@ class Canvas : public View, Observer
                                      * this->model_ * this->orth_);
   }
 
+  /// share(): Let OpenCL write the particle positions straight into the
+  ///          position vector buffer, or stop it, as fits the current mode:
+  ///          only the plain 2D render draws nothing but the latest positions.
+  ///          See Control::share().
+  void share();
+
   /// next(): Swap OpenGL buffers and poll for events.
   void next() const;
 
@@ -167,6 +175,8 @@ class Canvas : public View, Observer
   bool      trail_;           // whether trailing is enabled
   unsigned int trail_count_;  // current trail iteration
   bool      trail_end_;       // whether maximum trailing has been reached
+  bool      shared_;          // whether OpenCL writes the positions into
+                              // vertex_buffer_xyz_, see share()
   unsigned int levels_;       // total number of (z-)levels
   unsigned int level_;        // current number of levels
   unsigned int shift_counts_; // number of iterations until level shift
@@ -38,6 +38,14 @@ class VertexBuffer
     DOGL(glDeleteBuffers(1, &this->id_));
   }
 
+  /// id(): OpenGL name of the vertex buffer (eg. for OpenCL to share).
+  /// \returns  buffer name
+  inline GLuint
+  id() const
+  {
+    return this->id_;
+  }
+
   /// bind(): glBindBuffer wrapping.
   inline void
   bind() const
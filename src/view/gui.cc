@@ -70,6 +70,7 @@ Gui::Gui(Log& log, UiState& uistate, Canvas& canvas, GLFWwindow* window,
   this->inspect_particle_ = -1;
   this->inspect_cluster_ = -1;
   this->inspect_cluster_particle_ = -1;
+  this->inspect_listed_ = true;
   this->message_exp_inspect_default_ = "\n\n(Select an item on the left)";
   this->message_exp_inspect_ = this->message_exp_inspect_default_;
 
@@ -97,6 +98,14 @@ Gui::draw()
     this->ago_ = now;
   }
 
+  // the neighbor lists are only filled while a particle is inspected, from
+  // the tick after it was selected on, see gen_message_exp_inspect()
+  if (0 > this->inspect_particle_ && 0 > this->inspect_cluster_particle_) {
+    this->uistate_.ctrl_.keep_lists(false);
+  } else if (!this->inspect_listed_ && this->uistate_.ctrl_.listed()) {
+    this->gen_message_exp_inspect();
+  }
+
   // take picture, expecting Canvas to not process particle movement, and
   // revert to normal processing state
   if (2 == this->capturing_) {
@@ -224,6 +233,23 @@ Gui::draw_brief(bool draw)
     ImGui::TextColored(text_bright, "%s", ctrl.cl_good() ? "on" : "off");
     ImGui::PopFont();
 
+    // opencl timings: the commands taking the most device time, with the
+    // 50th/90th/99th percentiles of their runs
+    if (ctrl.timing_) {
+      std::vector<ClTiming> timings = ctrl.timings();
+      for (size_t i = 0; i < timings.size() && i < 6; ++i) {
+        ClTiming& timing = timings[i];
+        ImGui::TextColored(text_normal, "  %s", timing.name.c_str());
+        ImGui::SameLine();
+        ImGui::PushFont(font_b);
+        ImGui::TextColored(text_bright, "%.0f%%", 100.0f * timing.share);
+        ImGui::PopFont();
+        ImGui::SameLine();
+        ImGui::TextColored(text_normal, "%.0f/%.0f/%.0f us", timing.run[0],
+                           timing.run[1], timing.run[2]);
+      }
+    }
+
     // pid
     ImGui::TextColored(text_normal, "pid");
     ImGui::SameLine();
@@ -1364,21 +1390,27 @@ Gui::gen_message_exp_inspect()
   Control& ctrl = this->uistate_.ctrl_;
   State& state = ctrl.state_;
   Exp& exp = ctrl.exp_;
-  bool no_cl = !ctrl.cl_good();
   std::vector<int>& pls = state.pls_;
   std::vector<int>& prs = state.prs_;
   std::vector<float>& pld = state.pld_;
   std::vector<float>& prd = state.prd_;
-  unsigned int n_stride = state.n_stride_;
+  std::vector<unsigned int>& plo = state.plo_;
+  std::vector<unsigned int>& pro = state.pro_;
+  std::vector<unsigned int>& pid = state.pid_;
+  std::vector<unsigned int>& pidx = state.pidx_;
   std::ostringstream message;
 
+  if (0 <= this->inspect_particle_ || 0 <= this->inspect_cluster_particle_) {
+    ctrl.keep_lists(true); // filled by the next tick if they were not
+  }
+  this->inspect_listed_ = ctrl.listed();
+  ctrl.sync(); // PHI, L and R may still be on the OpenCL device
   message << std::fixed << std::setprecision(3);
 
   if (0 <= this->inspect_cluster_particle_) {
-    std::set<int>& cluster = exp.clusters_[this->inspect_cluster_];
-    unsigned int cp = static_cast<unsigned int>(*cluster.find(
-      this->inspect_cluster_particle_));
-    message << " particle " << cp
+    // particles are inspected by ID, and their data found by index
+    unsigned int cp = pidx[this->inspect_cluster_particle_];
+    message << " particle " << this->inspect_cluster_particle_
             << " of cluster " << this->inspect_cluster_
             << "\n\ntype: " << state.type_name(state.pt_[cp])
             << "\nx: " << state.px_[cp]
@@ -1388,19 +1420,15 @@ Gui::gen_message_exp_inspect()
             << "\nl: " << state.pl_[cp]
             << "\nr: " << state.pr_[cp];
 
-    if (no_cl) {
-      message << "\nnd: ";
-      for (int i = n_stride * cp; i < n_stride * cp + n_stride; ++i) {
-        if (0 > pls[i]) {
-          continue;
-        }
-        message << pls[i] << "(" << pld[i] << ") ";
+    message << "\nnd: ";
+    if (!this->inspect_listed_) {
+      message << "(after the next tick)";
+    } else {
+      for (int i = plo[cp]; i < plo[cp + 1]; ++i) {
+        message << pid[pls[i]] << "(" << pld[i] << ") ";
       }
-      for (int i = n_stride * cp; i < n_stride * cp + n_stride; ++i) {
-        if (0 > prs[i]) {
-          continue;
-        }
-        message << prs[i] << "(" << prd[i] << ") ";
+      for (int i = pro[cp]; i < pro[cp + 1]; ++i) {
+        message << pid[prs[i]] << "(" << prd[i] << ") ";
       }
     }
   }
@@ -1420,8 +1448,8 @@ Gui::gen_message_exp_inspect()
   }
 
   else if (0 <= this->inspect_particle_) {
-    unsigned int p = static_cast<unsigned int>(this->inspect_particle_);
-    message << " particle " << p
+    unsigned int p = pidx[this->inspect_particle_];
+    message << " particle " << this->inspect_particle_
             << "\n\ntype: " << state.type_name(state.pt_[p])
             << "\nx: " << state.px_[p]
             << "\ny: " << state.py_[p]
@@ -1429,19 +1457,15 @@ Gui::gen_message_exp_inspect()
             << "\nn: " << state.pn_[p]
             << "\nl: " << state.pl_[p]
             << "\nr: " << state.pr_[p];
-    if (no_cl) {
-      message << "\nnd: ";
-      for (int i = n_stride * p; i < n_stride * p + n_stride; ++i) {
-        if (0 > pls[i]) {
-          continue;
-        }
-        message << pls[i] << "(" << pld[i] << ") ";
+    message << "\nnd: ";
+    if (!this->inspect_listed_) {
+      message << "(after the next tick)";
+    } else {
+      for (int i = plo[p]; i < plo[p + 1]; ++i) {
+        message << pid[pls[i]] << "(" << pld[i] << ") ";
       }
-      for (int i = n_stride * p; i < n_stride * p + n_stride; ++i) {
-        if (0 > prs[i]) {
-          continue;
-        }
-        message << prs[i] << "(" << prd[i] << ") ";
+      for (int i = pro[p]; i < pro[p + 1]; ++i) {
+        message << pid[prs[i]] << "(" << prd[i] << ") ";
       }
     }
   }
@@ -188,9 +188,10 @@ class Gui
   int          inject_sprite_;  // particle cluster sprite model to be injected
   float        inject_dpe_;     // DPE after injection
   bool         inspect_greater_; // whether clusters include greater nbhds
-  int          inspect_particle_;         // particle index under inspection
+  int          inspect_particle_;         // particle ID under inspection
   int          inspect_cluster_;          // cluster index under inspection
-  int          inspect_cluster_particle_; // cluster particle index under insp
+  int          inspect_cluster_particle_; // cluster particle ID under insp
+  bool         inspect_listed_; // whether the inspection shows neighbor lists
   std::string  message_set_;         // habitat-preset-related message
   std::string  message_exp_color_;   // coloring-related message
   std::string  message_exp_cluster_; // clustering-related message
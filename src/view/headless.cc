@@ -1,5 +1,6 @@
 #include "headless.hh"
 #include "../util/util.hh"
+#include <iomanip>
 #include <signal.h>
 
 
@@ -103,8 +104,23 @@ Headless::report(When when) const
             << " (" << Util::rad_to_deg(state.beta_) << " deg)"
             << "\n  scope:  " << state.scope_
             << "\n  ascope: " << state.ascope_
-            << "\n  speed:  " << state.speed_
-            << std::flush;
+            << "\n  speed:  " << state.speed_;
+  if (ctrl.timing_) {
+    // microseconds, each span as 50th/90th/99th percentiles
+    std::cout << "\n  opencl:" << std::fixed << std::setprecision(1);
+    for (ClTiming& timing : ctrl.timings()) {
+      std::cout << "\n    " << std::left << std::setw(24) << timing.name
+                << std::right << std::setw(5) << 100.0f * timing.share << "%"
+                << "  run " << timing.run[0] << "/" << timing.run[1]
+                << "/" << timing.run[2]
+                << "  wait " << timing.wait[0] << "/" << timing.wait[1]
+                << "/" << timing.wait[2]
+                << "  queue " << timing.queue[0] << "/" << timing.queue[1]
+                << "/" << timing.queue[2];
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+  }
+  std::cout << std::flush;
 }
 
 
@@ -421,6 +437,7 @@ Headless::prompt_inspect()
     if ('P' == key || 'p' == key) {
       State& state = ctrl.state_;
       unsigned int num = uistate.num_;
+      unsigned int p;
       std::ostringstream message;
       message << "\nwhich particle? (0<=x<=" << num - 1 << ")> ";
       this->current_ = message.str();
@@ -430,16 +447,18 @@ Headless::prompt_inspect()
         std::cerr << "Particle inspection canceled." << std::flush;
         continue;
       }
+      ctrl.sync(); // PHI, L and R may still be on the OpenCL device
+      p = state.pidx_[n]; // n is an ID, as in the cluster listing
       message.str("");
       message << std::fixed << std::setprecision(3)
               << "\nparticle: " << n
-              << "\ntype: " << state.type_name(state.pt_[n])
-              << "\nx: " << state.px_[n]
-              << "\ny: " << state.py_[n]
-              << "\nphi: " << Util::rad_to_deg(state.pf_[n])
-              << "\nn: " << state.pn_[n]
-              << "\nl: " << state.pl_[n]
-              << "\nr: " << state.pr_[n];
+              << "\ntype: " << state.type_name(state.pt_[p])
+              << "\nx: " << state.px_[p]
+              << "\ny: " << state.py_[p]
+              << "\nphi: " << Util::rad_to_deg(state.pf_[p])
+              << "\nn: " << state.pn_[p]
+              << "\nl: " << state.pl_[p]
+              << "\nr: " << state.pr_[p];
       std::cout << message.str() << std::flush;
       continue;
     }